@@ -0,0 +1,117 @@
+#pragma once
+/* ---------- C ABI over one match ----------
+ * The moba_sim shared library wraps a DemoServer behind plain C (an opaque handle, fixed-layout
+ * structs, status codes), so tools run the real tick instead of a reimplementation: SimPreview's
+ * headless parity mode, balancing sweeps that step thousands of ticks unpaced.
+ *
+ * State goes out as a struct-of-arrays region: a MobaSimStateHeader, then one array per column,
+ * refreshed at the end of every sim_step(). The engine's columns are copied once per step; a
+ * reader indexes them in place. With MobaSimConfig::shm_name the region is a named shared memory
+ * object another process maps read-only (POSIX shm_open, a named file mapping on Windows);
+ * otherwise it is private memory. sim_read_state() returns its header in-process either way.
+ *
+ * A reader in another process uses the header's seqlock: read `sequence`, copy what it needs,
+ * read `sequence` again; odd, or changed, means a step was publishing and the copy is retried.
+ *
+ * Positions, velocities and radii are fixed-point (pos_scale units per world unit, velocities
+ * per tick), exactly as the server simulates them. Not thread-safe: one thread drives a MobaSim. */
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(MOBA_SIM_BUILD)
+#define MOBA_API __declspec(dllexport)
+#else
+#define MOBA_API __declspec(dllimport)
+#endif
+#else
+#define MOBA_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MOBA_SIM_API_VERSION 1
+#define MOBA_SIM_STATE_MAGIC 0x4D534F41u /* "AOSM" */
+#define MOBA_SIM_NOW 0xFFFFFFFFu         /* MobaSimInput::target_tick: the next tick to simulate */
+#define MOBA_SIM_DEFAULT_ENTITIES 4096u
+
+typedef enum MobaSimStatus {
+    MOBA_SIM_OK = 0,
+    MOBA_SIM_INVALID_ARGUMENT = -1,
+    MOBA_SIM_INPUT_REJECTED = -2 /* duplicate, too old or too far ahead (input_queue.h) */
+} MobaSimStatus;
+
+typedef struct MobaSim MobaSim;
+
+typedef struct MobaSimConfig {
+    uint32_t api_version;  /* MOBA_SIM_API_VERSION */
+    uint32_t max_entities; /* rows per state column, 0 = MOBA_SIM_DEFAULT_ENTITIES */
+    const char* game_dir;  /* game_defs, map_defs.json and scripts/ (ending in '/'); NULL = the server's default (DemoServer) */
+    const char* shm_name;  /* named shared memory for the state region; NULL = private memory */
+    uint32_t quiet;        /* nonzero: the engine only logs warnings and errors */
+} MobaSimConfig;
+
+/* One client input (ClientInput without the sequence number, which the library assigns) */
+typedef struct MobaSimInput {
+    uint32_t client_id;   /* steers entity 1000 + client_id when that is a character, else the first one */
+    uint32_t target_tick; /* MOBA_SIM_NOW or an absolute tick */
+    int8_t move_dx;       /* -127..127, normalized direction * 127 */
+    int8_t move_dy;
+    uint8_t action_flags; /* ActionFlags (client_input.h) */
+    uint8_t reserved;
+    uint16_t ability_id;  /* game_defs ability id for a cast */
+    uint16_t reserved2;
+    int32_t target_x;     /* fixed-point cast target */
+    int32_t target_y;
+} MobaSimInput;
+
+/* Region header; every *_offset is in bytes from the start of the header, each column holds `capacity` rows */
+typedef struct MobaSimStateHeader {
+    uint32_t magic;        /* MOBA_SIM_STATE_MAGIC */
+    uint32_t version;      /* MOBA_SIM_API_VERSION */
+    uint32_t header_bytes;
+    uint32_t total_bytes;  /* the whole region */
+    uint32_t sequence;     /* seqlock: odd while a step publishes */
+    uint32_t tick;         /* the next tick to simulate */
+    uint64_t state_hash;   /* of the last simulated tick (state_hash.h) */
+    uint32_t capacity;
+    uint32_t count;        /* rows filled: every character, then every projectile */
+    uint32_t dropped;      /* live entities beyond capacity, left out */
+    uint32_t pos_scale;
+    uint32_t tick_rate;
+    uint32_t id_offset;        /* uint32_t */
+    uint32_t type_offset;      /* uint8_t, EntityType */
+    uint32_t team_offset;      /* uint8_t */
+    uint32_t pos_x_offset;     /* int32_t */
+    uint32_t pos_y_offset;     /* int32_t */
+    uint32_t vel_x_offset;     /* int32_t, per tick */
+    uint32_t vel_y_offset;     /* int32_t, per tick */
+    uint32_t radius_offset;    /* int32_t */
+    uint32_t lifetime_offset;  /* int32_t ticks, -1 = infinite */
+    uint32_t health_offset;    /* int32_t */
+    uint32_t status_offset;    /* uint16_t, StatusFlags */
+    uint32_t reserved[8];
+} MobaSimStateHeader;
+
+/* NULL config = defaults. NULL when the state region can't be created. */
+MOBA_API MobaSim* sim_create(const MobaSimConfig* config);
+MOBA_API void sim_destroy(MobaSim* sim);
+
+/* A character with the default hero def at a fixed-point position, before or between steps.
+ * Returns its entity id, 0 on failure. The first one (id 1001) exists from sim_create. */
+MOBA_API uint32_t sim_spawn_character(MobaSim* sim, int32_t x, int32_t y, uint8_t team);
+
+/* Queue an input for its tick */
+MOBA_API int sim_push_input(MobaSim* sim, const MobaSimInput* input);
+
+/* Simulate `ticks` ticks unpaced, then publish the state region. Returns the next tick. */
+MOBA_API uint32_t sim_step(MobaSim* sim, uint32_t ticks);
+
+/* The state region as of the last sim_step() (sim_create publishes the initial state) */
+MOBA_API const MobaSimStateHeader* sim_read_state(const MobaSim* sim);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,403 @@
+// core_bench.cpp
+// Microbenchmarks of the engine's hot paths plus a whole-match scenario (Google Benchmark).
+//
+//   core_bench [--benchmark_filter=<regex>] [--benchmark_format=json] [--benchmark_repetitions=N]
+//
+// Run it from the repo root, like the demo, so the server and the Lua benchmarks find game/
+// (map defs included). Gameplay logging is lowered to warnings, a line per hit would
+// otherwise be most of what gets measured. Inputs come from a fixed-seed generator, so two
+// runs (or two commits) measure the same work.
+//
+// BM_ServerTick/<characters>/<projectiles>/<clients> drives DemoServer::tick() end to end:
+// every client sends an input each tick (walking, a cast now and then), every snapshot is built
+// and acked right away. It reports ticks_per_s and bytes_per_snapshot next to the tick time.
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "combat.h"
+#include "engine.h"
+#include "input_queue.h"
+#include "log.h"
+#include "lua_bridge.h"
+#include "net/snapshot_builder.h"
+#include "physics.h"
+#include "snapshot.h"
+
+namespace {
+
+// xorshift32: the same sequence with every standard library
+struct BenchRng {
+    uint32_t s = 0x9E3779B9u;
+    uint32_t next() {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return s;
+    }
+    int32_t range(int32_t lo, int32_t hi) { return lo + static_cast<int32_t>(next() % static_cast<uint32_t>(hi - lo + 1)); }
+};
+
+constexpr int32_t BENCH_MAP = 150 * POS_SCALE; // the demo map: 150 x 150 world units
+
+GridConfig benchGrid() {
+    GridConfig cfg;
+    cfg.cell_size = 1 << COMMON_CELL_SHIFT;
+    cfg.width_cells = (BENCH_MAP + cfg.cell_size - 1) / cfg.cell_size;
+    cfg.height_cells = cfg.width_cells;
+    cfg.levels = 3;
+    return cfg;
+}
+
+struct Body {
+    uint32_t id;
+    int32_t x, y, r;
+};
+
+// mostly characters and projectiles, one in 16 a big area effect
+std::vector<Body> makeBodies(size_t n) {
+    BenchRng rng;
+    std::vector<Body> bodies(n);
+    for (size_t k = 0; k < n; ++k) {
+        int32_t r = k % 16 == 0 ? rng.range(3000, 9000) : rng.range(300, 600);
+        bodies[k] = Body{static_cast<uint32_t>(1001 + k), rng.range(0, BENCH_MAP), rng.range(0, BENCH_MAP), r};
+    }
+    return bodies;
+}
+
+void buildGrid(SpatialGrid& grid, std::vector<Body> const& bodies) {
+    grid.Clear();
+    for (Body const& b : bodies) grid.Insert(b.id, b.x, b.y, b.r);
+    grid.Build();
+}
+
+// n entities sorted by id (what SnapshotRing::capture leaves); `moved` of every 100 changed in `cur`
+void makeFrames(size_t n, uint32_t moved, SnapshotFrame& base, SnapshotFrame& cur) {
+    BenchRng rng;
+    base.server_tick = 100;
+    base.valid = true;
+    base.entities.resize(n);
+    for (size_t k = 0; k < n; ++k) {
+        NetEntity& e = base.entities[k];
+        e.id = static_cast<uint32_t>(1001 + k);
+        e.pos_x = rng.range(0, BENCH_MAP);
+        e.pos_y = rng.range(0, BENCH_MAP);
+        e.vel_x = k % 3 == 0 ? rng.range(-300, 300) : 0;
+        e.vel_y = k % 3 == 0 ? rng.range(-300, 300) : 0;
+        e.health = 650;
+        e.status_flags = 0;
+        e.type = k % 4 == 0 ? EntityType::Projectile : EntityType::Character;
+    }
+    cur = base;
+    cur.server_tick = 101;
+    for (size_t k = 0; k < n; ++k) {
+        if (rng.next() % 100 >= moved) continue;
+        NetEntity& e = cur.entities[k];
+        e.pos_x += rng.range(-400, 400);
+        e.pos_y += rng.range(-400, 400);
+        if (k % 7 == 0) e.health -= rng.range(1, 80);
+    }
+}
+
+// Lua bindings answer from here: the bridge is measured, not a match behind it
+struct BenchHost : ScriptHost {
+    int next_projectile = 2000;
+
+    bool GetPosition(int, float& x, float& y) override {
+        x = 10.0f;
+        y = 20.0f;
+        return true;
+    }
+    bool SetMovement(int, float, float) override { return true; }
+    bool ApplyDamage(int, int, int, const char*) override { return true; }
+    bool ApplyKnockback(int, int, float, float, float, float) override { return true; }
+    int SpawnProjectile(int, float, float, float, float, float, float, float) override { return next_projectile++; }
+    int FindAbilityId(const char*) override { return 0; }
+    bool GetAbilityStat(int, int, float& out) override {
+        out = 10.0f;
+        return true;
+    }
+    int FindBuffId(const char*) override { return 0; }
+    bool ApplyBuff(int, int, int) override { return true; }
+    bool RemoveBuff(int, int) override { return true; }
+};
+
+// ---------- Spatial grid ----------
+
+void BM_GridBuild(benchmark::State& state) {
+    std::vector<Body> bodies = makeBodies(static_cast<size_t>(state.range(0)));
+    SpatialGrid grid(benchGrid());
+    for (auto _ : state) {
+        buildGrid(grid, bodies);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GridBuild)->Arg(100)->Arg(1000)->Arg(10000);
+
+// one query per body around it (a projectile's broad phase, an AoE around a character)
+void BM_GridQueryRadius(benchmark::State& state) {
+    std::vector<Body> bodies = makeBodies(static_cast<size_t>(state.range(0)));
+    SpatialGrid grid(benchGrid());
+    buildGrid(grid, bodies);
+    std::vector<uint32_t> out;
+    size_t k = 0, found = 0;
+    for (auto _ : state) {
+        Body const& b = bodies[k];
+        k = k + 1 < bodies.size() ? k + 1 : 0;
+        grid.QueryRadius(b.x, b.y, 5 * POS_SCALE, out);
+        found += out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["hits_per_query"] = state.iterations() ? static_cast<double>(found) / state.iterations() : 0.0;
+}
+BENCHMARK(BM_GridQueryRadius)->Arg(100)->Arg(1000)->Arg(10000);
+
+// a fast projectile's swept broad phase: 2 world units a tick
+void BM_GridQuerySegment(benchmark::State& state) {
+    std::vector<Body> bodies = makeBodies(static_cast<size_t>(state.range(0)));
+    SpatialGrid grid(benchGrid());
+    buildGrid(grid, bodies);
+    std::vector<uint32_t> out;
+    size_t k = 0;
+    for (auto _ : state) {
+        Body const& b = bodies[k];
+        k = k + 1 < bodies.size() ? k + 1 : 0;
+        grid.QuerySegment(b.x, b.y, b.x + 1600, b.y + 1200, 300, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GridQuerySegment)->Arg(1000)->Arg(10000);
+
+// ---------- Input queue ----------
+
+// a tick's worth of inputs pushed (out of order, like packets arrive) and popped
+void BM_InputQueuePopForTick(benchmark::State& state) {
+    uint32_t per_tick = static_cast<uint32_t>(state.range(0));
+    InputQueue q;
+    ClientInput in;
+    in.client_id = 1;
+    uint32_t tick = 0, seq = 0;
+    for (auto _ : state) {
+        in.target_tick = tick;
+        for (uint32_t k = 0; k < per_tick; ++k) {
+            in.input_seq = seq + (per_tick - k); // reversed: every push is a sorted insert
+            benchmark::DoNotOptimize(q.push(in));
+        }
+        seq += per_tick;
+        InputSpan span = q.popForTick(tick++);
+        benchmark::DoNotOptimize(span.data);
+    }
+    state.SetItemsProcessed(state.iterations() * per_tick);
+}
+BENCHMARK(BM_InputQueuePopForTick)->Arg(1)->Arg(MAX_INPUTS_PER_TICK);
+
+// ---------- Snapshots ----------
+
+void BM_SerializeFull(benchmark::State& state) {
+    size_t n = static_cast<size_t>(state.range(0));
+    Snapshot snap;
+    snap.server_tick = 100;
+    snap.entities.resize(n);
+    BenchRng rng;
+    for (size_t k = 0; k < n; ++k) {
+        snap.entities[k].id = static_cast<uint32_t>(1001 + k);
+        snap.entities[k].pos_x = rng.range(0, BENCH_MAP);
+        snap.entities[k].pos_y = rng.range(0, BENCH_MAP);
+    }
+    size_t bytes = 0;
+    for (auto _ : state) {
+        std::vector<uint8_t> out = serializeFull(snap);
+        bytes = out.size();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_SerializeFull)->Arg(100)->Arg(1000);
+
+// delta against the acked baseline: args = entities, percent of them changed
+void BM_SerializeDelta(benchmark::State& state) {
+    SnapshotFrame base, cur;
+    makeFrames(static_cast<size_t>(state.range(0)), static_cast<uint32_t>(state.range(1)), base, cur);
+    std::vector<uint8_t> out;
+    for (auto _ : state) {
+        serializeDelta(cur, &base, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(state.iterations() * out.size());
+    state.counters["bytes"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_SerializeDelta)->Args({100, 10})->Args({1000, 10})->Args({1000, 100});
+
+// the same delta into pooled MTU-sized fragments, nearest first (what a tick sends per client)
+void BM_SnapshotFragments(benchmark::State& state) {
+    SnapshotFrame base, cur;
+    makeFrames(static_cast<size_t>(state.range(0)), static_cast<uint32_t>(state.range(1)), base, cur);
+    PacketPool pool(1024);
+    SnapshotPacketBuilder builder;
+    SnapshotFocus focus{BENCH_MAP / 2, BENCH_MAP / 2};
+    std::vector<PacketBuffer*> fragments;
+    size_t bytes = 0;
+    for (auto _ : state) {
+        fragments.clear();
+        if (!builder.build(cur, &base, SnapshotQuantization{}, &focus, pool, fragments)) {
+            state.SkipWithError("snapshot needs more fragments than the pool holds");
+            break;
+        }
+        bytes = 0;
+        for (PacketBuffer* f : fragments) {
+            bytes += f->size;
+            pool.release(f);
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * bytes);
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.counters["fragments"] = static_cast<double>(fragments.size());
+}
+BENCHMARK(BM_SnapshotFragments)->Args({100, 10})->Args({1000, 10})->Args({1000, 100});
+
+// ---------- Lua ----------
+
+// one cast: push the arguments, protected call, read the results (fireball_test: a handful
+// of binding calls and one SpawnProjectile)
+void BM_LuaCallCast(benchmark::State& state) {
+    BenchHost host;
+    LuaBridge lua(&host);
+    AbilityHandle h = lua.loadAbility("fireball_test", "game/scripts/abilities/fireball_test.lua");
+    if (h == INVALID_ABILITY) {
+        state.SkipWithError("fireball_test.lua did not load a cast function (scripts are found from the repo root)");
+        return;
+    }
+    int caster = 1001;
+    for (auto _ : state) {
+        CastResult r;
+        lua.callCast(h, caster, 30.0, 40.0, &r);
+        benchmark::DoNotOptimize(r);
+        lua.collectGarbage(20000); // the slack a server tick would leave it
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LuaCallCast);
+
+// a tick's casts of one ability as one batch (the path processEvents() takes)
+void BM_LuaCallCastBatch(benchmark::State& state) {
+    BenchHost host;
+    LuaBridge lua(&host);
+    AbilityHandle h = lua.loadAbility("fireball_test", "game/scripts/abilities/fireball_test.lua");
+    if (h == INVALID_ABILITY) {
+        state.SkipWithError("fireball_test.lua did not load a cast function (scripts are found from the repo root)");
+        return;
+    }
+    std::vector<CastRequest> casts(static_cast<size_t>(state.range(0)));
+    for (size_t k = 0; k < casts.size(); ++k) casts[k] = CastRequest{static_cast<int>(1001 + k), 30.0, 40.0};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(lua.callCastBatch(h, casts.data(), casts.size()));
+        lua.collectGarbage(20000); // the slack a server tick would leave it
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LuaCallCastBatch)->Arg(10)->Arg(100);
+
+// ---------- Combat ----------
+
+void BM_CalculateFinalDamage(benchmark::State& state) {
+    constexpr size_t N = 1024;
+    std::vector<int32_t> raw(N), resist(N);
+    std::vector<DamageType> type(N);
+    BenchRng rng;
+    for (size_t k = 0; k < N; ++k) {
+        raw[k] = rng.range(1, 900);
+        resist[k] = rng.range(-50, 300);
+        type[k] = static_cast<DamageType>(k % 3);
+    }
+    for (auto _ : state) {
+        int64_t total = 0;
+        for (size_t k = 0; k < N; ++k) total += CalculateFinalDamage(raw[k], resist[k], type[k]);
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK(BM_CalculateFinalDamage);
+
+// ---------- Whole match ----------
+
+void BM_ServerTick(benchmark::State& state) {
+    uint32_t characters = static_cast<uint32_t>(state.range(0));
+    uint32_t projectiles = static_cast<uint32_t>(state.range(1));
+    uint32_t clients = static_cast<uint32_t>(state.range(2));
+    BenchRng rng;
+
+    DemoServer server; // spawns character 1001
+    for (uint32_t k = 1; k < characters; ++k) {
+        server.SpawnCharacter(rng.range(0, 150) * 1.0f, rng.range(0, 150) * 1.0f, static_cast<uint8_t>(k % 2));
+    }
+    AbilityId fireball = server.gameDefs().findAbility("fireball_test");
+
+    // keep about `projectiles` in flight: the ones that hit or expire are replaced
+    auto topUp = [&](uint32_t alive) {
+        for (; alive < projectiles; ++alive) {
+            int caster = static_cast<int>(1001 + rng.next() % characters);
+            float dir = static_cast<float>(rng.next() % 628) / 100.0f;
+            server.SpawnProjectile(caster, rng.range(0, 150) * 1.0f, rng.range(0, 150) * 1.0f, std::cos(dir), std::sin(dir), 10.0f, 0.3f,
+                                   3.0f);
+        }
+    };
+    topUp(0);
+
+    std::vector<uint32_t> seq(clients + 1, 0);
+    std::vector<ClientSnapshotRef> outgoing;
+    uint64_t snapshot_bytes = 0, snapshots = 0;
+    for (auto _ : state) {
+        uint32_t tick = server.currentTick();
+        for (uint32_t c = 1; c <= clients; ++c) {
+            ClientInput in;
+            in.client_id = c;
+            in.input_seq = ++seq[c];
+            in.target_tick = tick;
+            in.move_dx = static_cast<int8_t>(rng.range(-127, 127));
+            in.move_dy = static_cast<int8_t>(rng.range(-127, 127));
+            if (fireball != INVALID_DEF_ID && (tick + c) % 15 == 0) { // every client casts twice a second
+                in.action_flags = static_cast<uint8_t>(ActionFlags::CastAbility);
+                in.ability_id = fireball;
+                in.target_x = rng.range(0, BENCH_MAP);
+                in.target_y = rng.range(0, BENCH_MAP);
+            }
+            server.receiveInput(in);
+        }
+
+        TickResult result = server.tick();
+        server.buildClientSnapshots(outgoing);
+        for (ClientSnapshotRef const& r : outgoing) {
+            snapshot_bytes += r.bytes();
+            ++snapshots;
+            server.onSnapshotAck(r.client_id, result.server_tick);
+        }
+
+        EntityStore::Range projectiles = server.entityStore().range(EntityType::Projectile);
+        topUp(projectiles.end - projectiles.begin);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["ticks_per_s"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["bytes_per_snapshot"] = snapshots ? static_cast<double>(snapshot_bytes) / snapshots : 0.0;
+}
+BENCHMARK(BM_ServerTick)
+    ->Args({10, 20, 10})
+    ->Args({100, 200, 10})
+    ->Args({1000, 1000, 10})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Log::setLevel(LogLevel::Warn);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
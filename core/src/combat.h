@@ -1,5 +1,8 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <vector>
 
 enum class DamageType : uint8_t {
     Physical = 1,
@@ -7,14 +10,97 @@ enum class DamageType : uint8_t {
     Absolute = 3
 };
 
+// Script-facing names ("magical"/"Magical", ...); anything else is Absolute.
+// Record time only: commands carry the enum, nothing downstream sees the string.
+inline DamageType ParseDamageType(const char* name) {
+    if (!name) return DamageType::Absolute;
+    switch (name[0]) {
+        case 'm': case 'M': return strcmp(name + 1, "agical") == 0 ? DamageType::Magical : DamageType::Absolute;
+        case 'p': case 'P': return strcmp(name + 1, "hysical") == 0 ? DamageType::Physical : DamageType::Absolute;
+        default: return DamageType::Absolute;
+    }
+}
+
+inline const char* DamageTypeName(DamageType type) {
+    switch (type) {
+        case DamageType::Physical: return "physical";
+        case DamageType::Magical: return "magical";
+        default: return "absolute";
+    }
+}
+
+// ---------- Resist scaling ----------
+// final = raw * 100 / (100 + res), truncated toward zero. Instead of a divide per hit, the
+// tick multiplies by a precomputed reciprocal: RESIST_RECIPROCALS[res] = ceil(100 * 2^32 / (100 + res)).
+// Its rounding error e is below 100 + res, and |raw| * e < 2^32 for every |raw| < DAMAGE_EXACT_LIMIT
+// and res <= MAX_CACHED_RESIST, which keeps (|raw| * m) >> 32 equal to the exact quotient.
+// Hits beyond that (or resists off the table) take the divide, so results never change.
+constexpr int32_t MAX_CACHED_RESIST = 1023;
+constexpr int32_t DAMAGE_EXACT_LIMIT = 1 << 21;
+
+struct ResistReciprocals {
+    uint64_t mul[MAX_CACHED_RESIST + 1] = {};
+    constexpr ResistReciprocals() {
+        for (int32_t r = 0; r <= MAX_CACHED_RESIST; ++r) {
+            uint64_t d = 100u + static_cast<uint64_t>(r);
+            mul[r] = ((100ull << 32) + d - 1) / d;
+        }
+    }
+};
+inline constexpr ResistReciprocals RESIST_RECIPROCALS{};
+
+// resist < 0 counts as 0; 0 also stands for Absolute damage (the multiplier is exactly 1)
+inline int32_t ScaleByResist(int32_t raw_damage, int32_t resistance) {
+    int32_t res = resistance > 0 ? resistance : 0;
+    uint32_t mag = raw_damage < 0 ? 0u - static_cast<uint32_t>(raw_damage) : static_cast<uint32_t>(raw_damage);
+    if (res > MAX_CACHED_RESIST || mag >= static_cast<uint32_t>(DAMAGE_EXACT_LIMIT)) {
+        return static_cast<int32_t>(static_cast<int64_t>(raw_damage) * 100 / (100 + res));
+    }
+    int32_t q = static_cast<int32_t>((static_cast<uint64_t>(mag) * RESIST_RECIPROCALS.mul[res]) >> 32);
+    return raw_damage < 0 ? -q : q;
+}
+
 inline int32_t CalculateFinalDamage(int32_t raw_damage, int32_t resistance, DamageType type) {
     if (type == DamageType::Absolute) return raw_damage;
-    
-    // prevent negative resistance
-    int32_t effective_res = resistance > 0 ? resistance : 0; 
-    
-    int64_t numerator = static_cast<int64_t>(raw_damage) * 100;
-    int32_t denominator = 100 + effective_res;
-    
-    return static_cast<int32_t>(numerator / denominator);
-}
\ No newline at end of file
+    return ScaleByResist(raw_damage, resistance);
+}
+
+// ---------- Per-tick damage pass ----------
+// Every damage instance of a tick is gathered here (struct of arrays, in the command pass's
+// (target, record order)) and resolved in bulk: the caller looks each target's cached resist
+// up once, compute() scales every hit in one loop, and health is clamped once per target.
+// An AoE hitting 20 targets costs 20 multiplies, not 20 trips through the command switch.
+struct DamageBatch {
+    std::vector<uint32_t> target_id;
+    std::vector<uint32_t> source_id;
+    std::vector<int32_t> raw;
+    std::vector<DamageType> type;
+    std::vector<int32_t> resist;       // per hit, filled by the caller (0 for Absolute)
+    std::vector<int32_t> final_damage; // compute() output
+
+    size_t size() const { return raw.size(); }
+    bool empty() const { return raw.empty(); }
+
+    void push(uint32_t source, uint32_t target, int32_t amount, DamageType t) {
+        target_id.push_back(target);
+        source_id.push_back(source);
+        raw.push_back(amount);
+        type.push_back(t);
+    }
+
+    void compute() {
+        size_t n = raw.size();
+        final_damage.resize(n);
+        resist.resize(n);
+        for (size_t k = 0; k < n; ++k) final_damage[k] = ScaleByResist(raw[k], resist[k]);
+    }
+
+    void clear() {
+        target_id.clear();
+        source_id.clear();
+        raw.clear();
+        type.clear();
+        resist.clear();
+        final_damage.clear();
+    }
+};
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "combat.h"
+
+// ---------- Gameplay command buffer ----------
+// Lua bindings and the collision pass never touch EntityStore directly: they record typed
+// commands here, and the tick applies them in one pass after all scripts ran. The pass is
+// sorted by (target entity, record order), so every entity sees its commands in the order
+// they were issued and the result doesn't depend on which system recorded first.
+// Values are already converted to fixed point when recorded, applying is integer-only.
+
+enum class GameCommandType : uint8_t {
+    SetMovement,
+    Knockback,
+    Damage,
+    SpawnProjectile,
+    ApplyBuff,
+    RemoveBuff
+};
+
+struct MoveCommand {
+    int32_t vel_x, vel_y; // fixed-point units per tick, replaces the velocity
+};
+
+struct KnockbackCommand {
+    int32_t dvel_x, dvel_y; // fixed-point units per tick, added to the velocity
+};
+
+struct DamageCommand {
+    int32_t amount; // raw, resist is applied when the command runs
+    DamageType type;
+};
+
+struct SpawnProjectileCommand {
+    int32_t pos_x, pos_y;
+    int32_t vel_x, vel_y;
+    int32_t radius;
+    int32_t lifetime_ticks; // -1 = infinite
+    uint16_t ability_id;    // AbilityId whose on_hit takes the projectile's hits (INVALID_DEF_ID = none)
+};
+
+struct BuffCommand {
+    uint16_t buff_id; // BuffId; RemoveBuff takes every instance of it off the target
+};
+
+struct GameCommand {
+    GameCommandType type;
+    uint32_t seq;       // record order within the buffer (sort tiebreak)
+    uint32_t source_id;
+    uint32_t target_id; // entity the command mutates; SpawnProjectile: the id reserved for it
+    union {
+        MoveCommand move;
+        KnockbackCommand knockback;
+        DamageCommand damage;
+        SpawnProjectileCommand spawn;
+        BuffCommand buff;
+    };
+};
+
+class CommandBuffer {
+public:
+    CommandBuffer() { commands.reserve(256); }
+
+    void setMovement(uint32_t target_id, int32_t vel_x, int32_t vel_y) {
+        GameCommand& c = push(GameCommandType::SetMovement, 0, target_id);
+        c.move = MoveCommand{ vel_x, vel_y };
+    }
+
+    void knockback(uint32_t source_id, uint32_t target_id, int32_t dvel_x, int32_t dvel_y) {
+        GameCommand& c = push(GameCommandType::Knockback, source_id, target_id);
+        c.knockback = KnockbackCommand{ dvel_x, dvel_y };
+    }
+
+    void damage(uint32_t source_id, uint32_t target_id, int32_t amount, DamageType type) {
+        GameCommand& c = push(GameCommandType::Damage, source_id, target_id);
+        c.damage = DamageCommand{ amount, type };
+    }
+
+    // `projectile_id` is allocated by the caller at record time, so scripts get it back immediately
+    void spawnProjectile(uint32_t caster_id, uint32_t projectile_id, SpawnProjectileCommand const& spawn) {
+        GameCommand& c = push(GameCommandType::SpawnProjectile, caster_id, projectile_id);
+        c.spawn = spawn;
+    }
+
+    void applyBuff(uint32_t source_id, uint32_t target_id, uint16_t buff_id) {
+        GameCommand& c = push(GameCommandType::ApplyBuff, source_id, target_id);
+        c.buff = BuffCommand{ buff_id };
+    }
+
+    void removeBuff(uint32_t target_id, uint16_t buff_id) {
+        GameCommand& c = push(GameCommandType::RemoveBuff, 0, target_id);
+        c.buff = BuffCommand{ buff_id };
+    }
+
+    size_t size() const { return commands.size(); }
+    bool empty() const { return commands.empty(); }
+
+    // Recorded but not yet applied, in record order (replay keyframes)
+    std::vector<GameCommand> const& pending() const { return commands; }
+    void restore(GameCommand const* data, size_t count) {
+        commands.assign(data, data + count);
+        next_seq = static_cast<uint32_t>(count);
+    }
+
+    // Sort, hand every command to `fn(GameCommand const&)` and clear. A spawn sorts before any
+    // later command on the new id (it was recorded first), so same-pass follow-ups still land.
+    template <class Fn>
+    void apply(Fn&& fn) {
+        std::sort(commands.begin(), commands.end(), [](GameCommand const& a, GameCommand const& b) {
+            return a.target_id != b.target_id ? a.target_id < b.target_id : a.seq < b.seq;
+        });
+        for (GameCommand const& c : commands) fn(c);
+        commands.clear();
+        next_seq = 0;
+    }
+
+private:
+    GameCommand& push(GameCommandType type, uint32_t source_id, uint32_t target_id) {
+        commands.emplace_back();
+        GameCommand& c = commands.back();
+        c.type = type;
+        c.seq = next_seq++;
+        c.source_id = source_id;
+        c.target_id = target_id;
+        return c;
+    }
+
+    std::vector<GameCommand> commands;
+    uint32_t next_seq = 0;
+};
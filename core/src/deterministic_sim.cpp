@@ -8,623 +8,213 @@
 // This demo shows:
 // - fixed-step tick loop at 30 t/s
 // - fixed-point integer entity state (pos/vel)
-// - InputQueue (max 256) per client
-// - snapshot and simple delta compression (change_mask, only changed fields sent)
+// - InputQueue (tick-indexed ring, max 256) per client
+// - snapshot ring and per-client delta compression against the last acked snapshot (change_mask, only changed fields sent)
+// - with --matches N: many independent matches ticked on a worker pool (match_host.h)
+// - with --verify-sim K: a serial and a K-thread match in lockstep, state hashes compared every tick
+// - with --verify-rollback K: rollback + resimulation of K ticks (SaveState/RestoreState) checked against the first run
+// - with --record <log>: the match's inputs go to a replay log (deterministic_sim_replay runs it)
+// - with --hot-reload S: the demo runs for S seconds, edited scripts and game_defs are swapped in between ticks
 //
+// The match itself (DemoServer) lives in engine.h/.cpp.
 // This is a prototype for local testing. Replace I/O with real network code later.
 
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
-#include <deque>
-#include <unordered_map>
-#include <cstring>
-#include <cassert>
-#include <cmath>
-#include <fstream>
-#include "../../vendor/cpp/nlohmann/json.hpp"
-#include "net/packets.h"
-#include "client_input.h"
-#include "combat.h"
-#include "entity_state.h"
-#include "lua_bridge.h"
-#include "physics.h"
-
-using json = nlohmann::json;
-
-// ---------- Config ----------
-constexpr int SERVER_TICK_RATE = 30; // 30t/s
-constexpr uint64_t TICK_NS = 1000000000ull / SERVER_TICK_RATE; // 33,333,333 ns (approx)
-constexpr int32_t POS_SCALE = 1000; // fixed-point scale: 1.0 world unit = 1000 units
-constexpr size_t MAX_CLIENT_INPUT_QUEUE = 256;
-
-// ---------- Fixed-point helpers ----------
-inline int32_t to_fixed(float world_units) {
-    return static_cast<int32_t>(world_units * POS_SCALE);
-}
-inline float to_world(int32_t fixed) {
-    return static_cast<float>(fixed) / POS_SCALE;
-}
-
-// ---------- InputQueue (circular, max 256) ----------
-class InputQueue {
-public:
-    InputQueue() { }
-    [[nodiscard]] bool push(ClientInput const& in) {
-        if (queue.size() >= MAX_CLIENT_INPUT_QUEUE) return false;
-        queue.push_back(in);
-        return true;
-    }
-
-    std::vector<ClientInput> popForTick(uint32_t tick) {
-        // FIFO order
-        std::vector<ClientInput> res; // target tick (prio)
-        std::deque<ClientInput> remaining; // other tick
-        while (!queue.empty()) {
-            ClientInput c = queue.front();
-            queue.pop_front();
-            if (c.target_tick == tick) res.push_back(c);
-            else remaining.push_back(c);
+#include "engine.h"
+#include "log.h"
+#include "match_host.h"
+#include "replay.h"
+#include "thread_pool.h"
+
+// ---------- Match-host mode ----------
+// Every match gets the same synthetic client (client 1 walking right), so the load is even
+// and the numbers only measure the host.
+static int runMatchHost(uint32_t match_count, uint32_t ticks, unsigned threads) {
+    MatchHost host(threads);
+    for (uint32_t m = 0; m < match_count; ++m) {
+        DemoServer& server = host.match(host.createMatch());
+        for (uint32_t t = 0; t < ticks && t < INPUT_WINDOW_TICKS; ++t) {
+            ClientInput in;
+            in.client_id = 1;
+            in.input_seq = t + 1;
+            in.target_tick = t;
+            in.move_dx = 127;
+            server.receiveInput(in);
         }
-        queue.swap(remaining);
-        return res;
     }
 
-    size_t size() const { return queue.size(); }
-
-private:
-    std::deque<ClientInput> queue; // small, bounded by MAX_CLIENT_INPUT_QUEUE
-};
-
-// ---------- Snapshot / Delta serialization ----------
-// In production we should use proper endian handling.
-
-// change mask bits
-enum ChangeBits : uint8_t {
-    CH_PosX = 1 << 0, // << shifts position to the left n = 0 times
-    CH_PosY = 1 << 1, // << shifts position to the left n = 1 times
-    CH_VelX = 1 << 2, // ...
-    CH_VelY = 1 << 3,
-    CH_Health = 1 << 4,
-    CH_Flags = 1 << 5
-};
-// << changes the bit position
-// all properties are inside a same mask based on their positions
-// 00010101 --> POSX, VELX and HEALTH changed (all are 1, and their positions are respective to the)
-
-struct Snapshot {
-    uint32_t server_tick;
-    std::vector<EntityState> entities;
-};
+    MOBA_LOG(App, Info, "[Host] {} matches on {} threads, {} ticks", match_count, host.threadCount(), ticks);
+    host.run(ticks);
+    Log::stop();
 
-// helper endian functions
-inline void write_u8(std::vector<uint8_t>& buf, uint8_t v) { buf.push_back(v); }
-inline void write_u16(std::vector<uint8_t>& buf, uint16_t v) {
-    buf.push_back(static_cast<uint8_t>(v & 0xFF));
-    buf.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
-}
-inline void write_u32(std::vector<uint8_t>& buf, uint32_t v) {
-    buf.push_back(static_cast<uint8_t>(v & 0xFF));
-    buf.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
-    buf.push_back(static_cast<uint8_t>((v >> 16) & 0xFF));
-    buf.push_back(static_cast<uint8_t>((v >> 24) & 0xFF));
-}
-inline void write_i32(std::vector<uint8_t>& buf, int32_t v) { write_u32(buf, static_cast<uint32_t>(v)); }
-
-// Serialize full snapshot, example
-[[nodiscard]] std::vector<uint8_t> serializeFull(Snapshot const& snap) {
-    std::vector<uint8_t> out;
-    write_u32(out, snap.server_tick);
-    write_u32(out, static_cast<uint32_t>(snap.entities.size()));
-    for (auto const& e : snap.entities) {
-        write_u32(out, e.id);
-        write_i32(out, e.pos_x);
-        write_i32(out, e.pos_y);
-        write_i32(out, e.vel_x);
-        write_i32(out, e.vel_y);
-        write_i32(out, e.health);
-        write_u8(out, e.status_flags);
-    }
-    return out;
+    MatchHostStats const& st = host.stats();
+    std::cout << "[Host] steps=" << st.steps << " late=" << st.late_steps << " skipped=" << st.skipped_steps
+              << " step p50=" << st.step_ns.quantile(0.50) / 1000 << "us p99=" << st.step_ns.quantile(0.99) / 1000
+              << "us max=" << st.step_ns.max() / 1000 << "us steals=" << host.steals() << "\n";
+    return 0;
 }
 
-// Serialize delta relative to previous snapshot (prev states provided in map), example
-[[nodiscard]] std::vector<uint8_t> serializeDelta(Snapshot const& snap, std::unordered_map<uint32_t, EntityState> const& prev_map) {
-    std::vector<uint8_t> out;
-    write_u32(out, snap.server_tick);
-
-    // this line stores the index where entity count will be written:
-    size_t count_pos = out.size();
-    write_u32(out, 0);
-
-    uint32_t entity_count = 0;
-    for (auto const& e : snap.entities) {
-        auto it = prev_map.find(e.id);
-        uint8_t mask = 0;
-        if (it == prev_map.end()) {
-            // new entity -> send everything
-            mask = CH_PosX | CH_PosY | CH_VelX | CH_VelY | CH_Health | CH_Flags;
-        } else {
-            EntityState const& prev = it->second;
-            if (e.pos_x != prev.pos_x) mask |= CH_PosX;
-            if (e.pos_y != prev.pos_y) mask |= CH_PosY;
-            if (e.vel_x != prev.vel_x) mask |= CH_VelX;
-            if (e.vel_y != prev.vel_y) mask |= CH_VelY;
-            if (e.health != prev.health) mask |= CH_Health;
-            if (e.status_flags != prev.status_flags) mask |= CH_Flags;
-            if (mask == 0) continue;
+// ---------- Determinism check ----------
+// Same inputs into a serial reference match and one ticking on `threads` threads; the state
+// hashes must agree every tick. On the first mismatch both sides' first differing entity is dumped.
+static int runVerifySim(uint32_t ticks, unsigned threads) {
+    DemoServer reference, candidate;
+    WorkStealingPool pool(threads);
+    candidate.setSimulationPool(&pool, 1); // smallest chunks: every chunk boundary gets exercised
+
+    for (DemoServer* s : {&reference, &candidate}) {
+        s->SpawnProjectile(1001, 0.0, 0.0, 1.0, 0.0, 10.0, 0.5, 2.0);
+        for (uint32_t t = 0; t < ticks && t < INPUT_WINDOW_TICKS; ++t) {
+            ClientInput in;
+            in.client_id = 1;
+            in.input_seq = t + 1;
+            in.target_tick = t;
+            in.move_dx = static_cast<int8_t>(t % 20 < 10 ? 127 : -127);
+            in.move_dy = static_cast<int8_t>(t % 7 == 0 ? 64 : 0);
+            s->receiveInput(in);
         }
-        write_u32(out, e.id);
-        write_u8(out, mask);
-        if (mask & CH_PosX) write_i32(out, e.pos_x);
-        if (mask & CH_PosY) write_i32(out, e.pos_y);
-        if (mask & CH_VelX) write_i32(out, e.vel_x);
-        if (mask & CH_VelY) write_i32(out, e.vel_y);
-        if (mask & CH_Health) write_i32(out, e.health);
-        if (mask & CH_Flags) write_u8(out, e.status_flags);
-
-        ++entity_count;
     }
 
-    // patch entity_count
-    uint32_t le_count = entity_count;
-    out[count_pos + 0] = static_cast<uint8_t>(le_count & 0xFF);
-    out[count_pos + 1] = static_cast<uint8_t>((le_count >> 8) & 0xFF);
-    out[count_pos + 2] = static_cast<uint8_t>((le_count >> 16) & 0xFF);
-    out[count_pos + 3] = static_cast<uint8_t>((le_count >> 24) & 0xFF);
-
-    return out;
-}
-
-// ---------- Event System ----------
-enum class SimEventType {
-    CastAbility
-};
-
-struct SimEvent {
-    SimEventType type;
-    uint32_t caster_id;
-    uint16_t ability_id;
-    int32_t target_x;
-    int32_t target_y;
-};
-
-// ---------- Simple deterministic "physics" & logic ----------
-// For the demo: movement and simple velocity decay (friction). All integer arithmetic.
-
-// Convert to velocity per tick in fixed-point world units.
-// Suppose max_speed = 5.0 units/sec. We need vel per tick:
-// vel_per_tick_fixed = round(max_speed * (1/TICK_RATE) * POS_SCALE * (normalized_dir / 127))
-// We avoid floats by using integer arithmetic: use constants in fixed integer form.
-constexpr int32_t MAX_SPEED_FIXED_PER_TICK = static_cast<int32_t>( (5.0f * POS_SCALE) / SERVER_TICK_RATE );
-constexpr int32_t FRICTION_PER_TICK = 25; // 0.025 world units per tick drag
-
-void applyInputsToEntity(EntityState &e, std::vector<ClientInput> const& inputs, std::vector<SimEvent>& event_queue) {
-    for (auto const& in : inputs) {
-        if (in.move_dx != 0 || in.move_dy != 0) {
-            int32_t nx = static_cast<int32_t>(in.move_dx); // -127..127
-            int32_t ny = static_cast<int32_t>(in.move_dy);
-            int32_t new_vx = (MAX_SPEED_FIXED_PER_TICK * nx) / 127;
-            int32_t new_vy = (MAX_SPEED_FIXED_PER_TICK * ny) / 127;
-            e.vel_x = new_vx;
-            e.vel_y = new_vy;
-        }
-        if (in.action_flags != 0) {
-            SimEvent ev;
-            ev.type = SimEventType::CastAbility;
-            ev.caster_id = e.id;
-            ev.ability_id = in.ability_id;
-            ev.target_x = in.target_x;
-            ev.target_y = in.target_y;
-
-            event_queue.push_back(ev);
-        }
+    for (uint32_t t = 0; t < ticks; ++t) {
+        TickResult a = reference.tick();
+        TickResult b = candidate.tick();
+        if (a.state_hash == b.state_hash) continue;
+
+        StateDigest da, db;
+        reference.captureStateDigest(da);
+        candidate.captureStateDigest(db);
+        uint32_t id = firstDivergence(da, db);
+        Log::stop();
+        std::cout << "[Desync] tick " << a.server_tick << ": serial " << std::hex << a.state_hash << " vs " << threads
+                  << " threads " << b.state_hash << std::dec << ", first differing entity " << id << "\n";
+        EntityState ea, eb;
+        std::cout << "  serial:   ";
+        if (reference.getEntityState(id, ea)) dumpEntityState(std::cout, ea); else std::cout << "(missing)";
+        std::cout << "\n  parallel: ";
+        if (candidate.getEntityState(id, eb)) dumpEntityState(std::cout, eb); else std::cout << "(missing)";
+        std::cout << "\n";
+        return 1;
     }
-}
-
-inline int32_t approach_zero(int32_t current_val, int32_t amount) {
-    if (current_val > amount) return current_val - amount;
-    if (current_val < -amount) return current_val + amount;
+    Log::stop();
+    std::cout << "[Desync] " << ticks << " ticks, serial and " << pool.size() << "-thread hashes match (last "
+              << std::hex << reference.stateHash() << std::dec << ")\n";
     return 0;
 }
 
-void simulateCharacterTick(EntityState &e) {
-    e.pos_x += e.vel_x;
-    e.pos_y += e.vel_y;
-
-    e.vel_x = approach_zero(e.vel_x, FRICTION_PER_TICK);
-    e.vel_y = approach_zero(e.vel_y, FRICTION_PER_TICK);
-
-    if (e.lifetime_ticks > 0) {
-        e.lifetime_ticks--;
-    }
-}
-
-void simulateProjectileTick(EntityState &e) {
-    e.pos_x += e.vel_x;
-    e.pos_y += e.vel_y;
-
-    if (e.lifetime_ticks > 0) {
-        e.lifetime_ticks--;
-    }
-}
-
-// ---------- Demo server class ----------
-class DemoServer {
-private:
-    static DemoServer* s_instance;
-    LuaBridge luaBridge;
-    using TickFn = void(*)(EntityState&);
-
-    uint32_t server_tick;
-    uint32_t next_entity_id; // ID Generator
-    std::unordered_map<uint32_t, EntityState> entities;
-    std::unordered_map<EntityType, TickFn> entity_tick_table;
-    std::unordered_map<uint32_t, InputQueue> input_queues;
-    std::vector<SimEvent> event_queue;
-    std::unordered_map<uint32_t, EntityState> prev_snapshot_map; // For delta calc
-    std::unordered_map<uint32_t, EntityState> prev_snapshot_map_before_tick;
-    std::unordered_map<std::string, std::unordered_map<std::string, float>> ability_stats;
-    std::unordered_map<std::string, std::unordered_map<std::string, float>> character_stats;
-    SpatialGrid grid;
-
-public:
-    DemoServer() : server_tick(0), next_entity_id(1001) {
-        s_instance = this;
-        luaBridge.doFile("../../../game/scripts/abilities/fireball_test.lua");
-
-        LoadGameDefs();
-
-        // First char
-        EntityState e;
-        e.id = next_entity_id++;
-        e.type = EntityType::Character;
-        e.pos_x = to_fixed(0.0f);
-        e.pos_y = to_fixed(0.0f);
-        e.vel_x = 0;
-        e.vel_y = 0;
-        e.health = character_stats.count("hero_test") ? static_cast<int32_t>(character_stats["hero_test"]["hp"]) : 650;
-        e.status_flags = 0;
-        e.radius = to_fixed(0.5f);
-        entities[e.id] = e;
-        prev_snapshot_map.clear();
-
-        entity_tick_table[EntityType::Character] = simulateCharacterTick;
-        entity_tick_table[EntityType::Projectile] = simulateProjectileTick;
-    }
-
-    void LoadGameDefs() {
-        std::string filepath = "game/game_defs.json";
-        std::ifstream f(filepath);
-
-        if (!f.is_open()) {
-            filepath = "../../../game/game_defs.json";
-            f.open(filepath);
-        }
-
-        if (!f.is_open()) {
-            std::cerr << "[Error] Could not open " << filepath << "\n";
-            return;
-        }
-
-        json data = json::parse(f);
-
-        for (auto& [ability_key, ability_data] : data["abilities"].items()) {
-            
-            if (ability_data.contains("stats")) {
-                auto stats = ability_data["stats"];
-                
-                if (stats.contains("damage")) ability_stats[ability_key]["damage"] = stats["damage"];
-                if (stats.contains("speed")) ability_stats[ability_key]["speed"] = stats["speed"];
-                if (stats.contains("radius")) ability_stats[ability_key]["radius"] = stats["radius"];
-                if (stats.contains("lifetime")) ability_stats[ability_key]["lifetime"] = stats["lifetime"];
-                
-                std::cout << "[Gameplay] Loaded stats for ability: " << ability_key << "\n";
-            }
-
-            if (data.contains("characters")) {
-                for (auto& [char_key, char_data] : data["characters"].items()) {
-                    if (char_data.contains("baseStats")) {
-                        auto stats = char_data["baseStats"];
-                        if (stats.contains("hp")) character_stats[char_key]["hp"] = stats["hp"];
-                        if (stats.contains("armor")) character_stats[char_key]["armor"] = stats["armor"];
-                        if (stats.contains("magicResist")) character_stats[char_key]["magicResist"] = stats["magicResist"];
-                        std::cout << "[Gameplay] Loaded stats for character: " << char_key << "\n";
-                    }
-                }
-            }
-        }
-    }
-
-    ~DemoServer() {
-        if (s_instance == this) s_instance = nullptr;
-    }
-
-    void processEvents() {
-        for (auto &ev : event_queue) {
-            if (ev.type == SimEventType::CastAbility) {
-                // call Lua
-                luaBridge.callCastFunction(
-                    "cast",
-                    ev.caster_id,
-                    (double)ev.target_x,
-                    (double)ev.target_y
-                );
-            }
-        }
-
-        event_queue.clear();
-    }
-
-    void SimInit() {
-        // nothing for now (constructor already initializes)
-    }
-
-    // In a real engine, this would probably be connected to a UDP socket listener
-    // Singleton Accessor
-    static DemoServer* GetInstance() { return s_instance; }
-    bool receiveInput(ClientInput const& in) {
-        // ensure a queue exists for this client
-        auto &q = input_queues[in.client_id];
-        return q.push(in);
-    }
-
-    void handleClientInputPacket(const ClientInputPacket& pkt) {
-        for (uint8_t i = 0; i < pkt.inputCount; i++) {
-            const ClientInput& input = pkt.inputs[i];
-            if (!input_queues[input.client_id].push(input)) {
-                printf("Warning: Input queue for client %u is full!\n", input.client_id);
-            }
-        }
-    }
-
-    // Gameplay API
-
-    float GetAbilityStat(const char* ability_id, const char* stat_name) {
-        return ability_stats[ability_id][stat_name]; 
-    }
-
-    // it = entities.find(id) which is key
-    // second... = specific value
-    // map has KEY -> VALUE
-
-    bool GetPosition(int id, float &x, float &y) {
-        auto it = entities.find(id);
-        if (it == entities.end()) return false;
-        x = to_world(it->second.pos_x);
-        y = to_world(it->second.pos_y);
-        return true;
-    }
-
-    bool SetMovement(int id, float vx, float vy) {
-        auto it = entities.find(id);
-        if (it == entities.end()) return false;
-        // world-units/sec to fixed-units/tick
-        float ticks_per_sec = (float)SERVER_TICK_RATE;
-        it->second.vel_x = to_fixed(vx / ticks_per_sec);
-        it->second.vel_y = to_fixed(vy / ticks_per_sec);
-        return true;
-    }
-
-    bool ApplyDamage(int source_id, int target_id, int amount, const char* damage_type_str) {
-        auto it = entities.find(target_id);
-        if (it == entities.end()) return false;
-        
-        DamageType dt = DamageType::Absolute;
-        if (strcmp(damage_type_str, "magical") == 0 || strcmp(damage_type_str, "Magical") == 0) dt = DamageType::Magical;
-        else if (strcmp(damage_type_str, "physical") == 0 || strcmp(damage_type_str, "Physical") == 0) dt = DamageType::Physical;
-
-        // Fetch armor/mr directly from our loaded JSON stats
-        int32_t resist = 0;
-        if (dt == DamageType::Magical) resist = character_stats["hero_test"]["magicResist"];
-        else if (dt == DamageType::Physical) resist = character_stats["hero_test"]["armor"];
-
-        int32_t final_damage = CalculateFinalDamage(amount, resist, dt);
-
-        it->second.health -= final_damage;
-        if (it->second.health < 0) it->second.health = 0;
-        
-        std::cout << "[Combat] Entity " << target_id << " took " << final_damage 
-                  << " final dmg (Raw: " << amount << ", Type: " << damage_type_str 
-                  << ") from Entity " << source_id << "\n";
-        return true;
-    }
-
-    bool ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration) {
-        auto it = entities.find(target_id);
-        if (it == entities.end()) return false;
-
-        float ticks_per_sec = (float)SERVER_TICK_RATE;
-        
-        float len = std::sqrt(dir_x*dir_x + dir_y*dir_y);
-        if(len > 0) { dir_x /= len; dir_y /= len; }
-
-        int32_t fx = to_fixed((dir_x * force) / ticks_per_sec);
-        int32_t fy = to_fixed((dir_y * force) / ticks_per_sec);
-
-        it->second.vel_x += fx;
-        it->second.vel_y += fy;
-
-        std::cout << "[Gameplay] Knockback applied to " << target_id << " by " << source_id 
-                  << " | Force: " << force << " | Duration: " << duration << "s\n";
-        return true;
-    }
-
-    int SpawnProjectile(int caster_id, float x, float y, float dx, float dy, float speed, float radius, float life_time) {
-        EntityState proj;
-        proj.id = next_entity_id++;
-        proj.type = EntityType::Projectile;
-        proj.pos_x = to_fixed(x);
-        proj.pos_y = to_fixed(y);
-        
-        // Speed is units/sec
-        float ticks_per_sec = (float)SERVER_TICK_RATE;
-        float vel_per_tick = speed / ticks_per_sec;
-        
-        proj.vel_x = to_fixed(dx * vel_per_tick);
-        proj.vel_y = to_fixed(dy * vel_per_tick);
-        
-        proj.radius = to_fixed(radius);
-        
-        if (life_time > 0) {
-            proj.lifetime_ticks = static_cast<int32_t>(life_time * ticks_per_sec);
-        }
-
-        entities[proj.id] = proj;
-        
-        std::cout << "[Gameplay] Spawned Projectile " << proj.id << " at " << x << "," << y << "\n";
-        return (int)proj.id;
+// ---------- Rollback check ----------
+// One match saving its state every tick. Every `depth` ticks it rolls back `depth` ticks and
+// resimulates them, the way a predicting client does per received snapshot; the replayed ticks
+// must hash exactly like the first time. Also times the rollbacks and a lag-compensated query.
+static int runVerifyRollback(uint32_t ticks, uint32_t depth) {
+    using Clock = std::chrono::steady_clock;
+    if (depth > STATE_HISTORY_TICKS) depth = STATE_HISTORY_TICKS;
+
+    DemoServer server;
+    server.setStateHistory(true);
+    server.SpawnProjectile(1001, 0.0, 0.0, 1.0, 0.0, 10.0, 0.5, 2.0);
+    for (uint32_t t = 0; t < ticks && t < INPUT_WINDOW_TICKS; ++t) {
+        ClientInput in;
+        in.client_id = 1;
+        in.input_seq = t + 1;
+        in.target_tick = t;
+        in.move_dx = static_cast<int8_t>(t % 20 < 10 ? 127 : -127);
+        in.move_dy = static_cast<int8_t>(t % 7 == 0 ? 64 : 0);
+        server.receiveInput(in);
     }
 
-    // Run single tick
-    Snapshot tick() {
-        // 1) clear-build spatial grid
-        grid.Clear();
-        for (auto const& kv : entities) {
-            grid.Insert(kv.second);
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> hits;
+    uint32_t rollbacks = 0;
+    double worst_ms = 0.0, total_ms = 0.0;
+    size_t hit_total = 0;
+    for (uint32_t t = 0; t < ticks; ++t) {
+        hashes.push_back(server.tick().state_hash);
+        uint32_t now = server.currentTick();
+        if (now < depth || now % depth != 0) continue;
+
+        auto start = Clock::now();
+        uint32_t from = now - depth;
+        if (!server.RestoreState(from)) {
+            Log::stop();
+            std::cout << "[Rollback] no saved state for tick " << from << "\n";
+            return 1;
         }
-        // 2) gather all inputs for current tick for all clients and apply
-        for (auto &kv : input_queues) { // kv = key-value || kv.first is key, kv.second is value
-            uint32_t client = kv.first;
-            InputQueue &q = kv.second;
-            auto inputs = q.popForTick(server_tick);
-            // For demo: map client_id to entity_id directly (hardcode)
-            // Hardcoded client 1 controls entity 1001
-            uint32_t ent_id = 1001;
-            auto it = entities.find(ent_id);
-            if (it != entities.end() && !inputs.empty()) {
-                applyInputsToEntity(it->second, inputs, event_queue);
-            }
+        for (uint32_t r = from; r < now; ++r) {
+            uint64_t h = server.tick().state_hash;
+            if (h == hashes[r]) continue;
+            Log::stop();
+            std::cout << "[Rollback] tick " << r << " resimulated from " << from << " hashes " << std::hex << h
+                      << ", first run " << hashes[r] << std::dec << "\n";
+            return 1;
         }
-
-        // 3) simulate physics & logic for all entities
-        std::vector<uint32_t> to_remove;
-        for (auto &kv : entities) {
-            auto it_fn = entity_tick_table.find(kv.second.type);
-            if (it_fn != entity_tick_table.end()) {
-                it_fn->second(kv.second);
-            }
-
-            // Projectile Collision Logic using Spatial Grid
-            if (kv.second.type == EntityType::Projectile) {
-                std::vector<uint32_t> nearby = grid.QueryRadius(kv.second.pos_x, kv.second.pos_y, kv.second.radius);
-                for (uint32_t other_id : nearby) {
-                    if (other_id == kv.first) continue; // Skip self
-                    
-                    auto other_it = entities.find(other_id);
-                    if (other_it != entities.end() && other_it->second.type == EntityType::Character) {
-                        if (SpatialGrid::CheckCollision(kv.second, other_it->second)) {
-                            std::cout << "[Physics] Grid detected collision between Proj " << kv.first << " and Char " << other_id << "\n";
-                            
-                            // Trigger Damage directly (simulating OnHit since Lua Bridge isn't fully wired)
-                            float dmg = GetAbilityStat("fireball_test", "damage");
-                            ApplyDamage(kv.first, other_id, static_cast<int>(dmg), "magical");
-                            
-                            kv.second.lifetime_ticks = 0; // Destroy projectile
-                            break; // Hit only one target
-                        }
-                    }
-                }
-
-                if (kv.second.lifetime_ticks <= 0) {
-                    to_remove.push_back(kv.first);
-                }
-            }
-        }
-
-        for(auto id : to_remove) entities.erase(id);
-        processEvents();
-
-        // 4) produce snapshot
-
-        Snapshot snap;
-        snap.server_tick = server_tick;
-        for (auto const& kv : entities) snap.entities.push_back(kv.second);
-
-        // 5) update prev_snapshot_map for delta next time
-        prev_snapshot_map.clear();
-        for (auto const& kv : entities) prev_snapshot_map[kv.first] = kv.second;
-
-        server_tick++;
-        return snap;
+        hit_total += server.LagCompensatedQuery(from, 0, 0, 5 * POS_SCALE, 0, hits) != NO_BASELINE ? hits.size() : 0;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        total_ms += ms;
+        if (ms > worst_ms) worst_ms = ms;
+        ++rollbacks;
     }
-
-    // Serialize snapshots on two versions (full and delta) for demo and return sizes for comparison of their bytes.
-    void serializeSnapshots(Snapshot const& snap) {
-        auto full = serializeFull(snap);
-        auto delta = serializeDelta(snap, prev_snapshot_map_before_tick); // compare with snapshot BEFORE this tick
-        std::cout << "[Serialize] tick=" << snap.server_tick
-                  << " full=" << full.size() << " bytes"
-                  << " delta=" << delta.size() << " bytes"
-                  << " (entities=" << snap.entities.size() << ")\n";
-    }
-
-    // helper to get last-sent snapshot
-    std::unordered_map<uint32_t, EntityState> const& getPrevBefore() const { return prev_snapshot_map_before_tick; }
-    
-    // For demo: we keep prev_snapshot_map_before_tick as last-sent snapshot map (so delta is computed vs last)
-    void updatePrevBeforeFromSnapshot(Snapshot const& s) {
-        prev_snapshot_map_before_tick.clear();
-        for (auto const& e : s.entities) prev_snapshot_map_before_tick[e.id] = e;
-    }
-
-};
-DemoServer* DemoServer::s_instance = nullptr;
-
-// ---------- Extern engine functions ----------
-// These act as the bridge between Lua (C-style) and DemoServer (C++ Class)
-
-extern "C" { // Use C linkage if Lua library was compiled as C, usually C++ is fine but this is safer
-
-bool Engine_GetPosition(int entity_id, float &out_x, float &out_y) {
-    if (!DemoServer::GetInstance()) return false;
-    return DemoServer::GetInstance()->GetPosition(entity_id, out_x, out_y);
-}
-
-bool Engine_SetMovement(int entity_id, float vx, float vy) {
-    if (!DemoServer::GetInstance()) return false;
-    return DemoServer::GetInstance()->SetMovement(entity_id, vx, vy);
-}
-
-bool Engine_ApplyDamage(int source_id, int target_id, int amount, const char* damage_type) {
-    if (!DemoServer::GetInstance()) return false;
-    return DemoServer::GetInstance()->ApplyDamage(source_id, target_id, amount, damage_type);
-}
-
-bool Engine_ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration) {
-    if (!DemoServer::GetInstance()) return false;
-    return DemoServer::GetInstance()->ApplyKnockback(source_id, target_id, dir_x, dir_y, force, duration);
-}
-
-int Engine_SpawnProjectile(int caster_id, float spawn_x, float spawn_y, float dir_x, float dir_y, float speed, float radius, float life_time, const char* on_hit_cb) {
-    if (!DemoServer::GetInstance()) return -1;
-    return DemoServer::GetInstance()->SpawnProjectile(caster_id, spawn_x, spawn_y, dir_x, dir_y, speed, radius, life_time);
-}
-
-float Engine_GetAbilityStat(const char* ability_id, const char* stat_name) {
-        if (!DemoServer::GetInstance()) return 0.0f;
-        return DemoServer::GetInstance()->GetAbilityStat(ability_id, stat_name);
-}
-
+    Log::stop();
+    std::cout << "[Rollback] " << ticks << " ticks, " << rollbacks << " rollbacks of " << depth << " ticks match the first run ("
+              << (rollbacks ? total_ms / rollbacks : 0.0) << " ms avg, " << worst_ms << " ms worst, " << hit_total
+              << " lag-compensated hits)\n";
+    return 0;
 }
 
 // ---------- Demo main: simulate a few ticks with synthetic inputs ----------
 // EXPECTED RESULTS
-// Tick 0 = full and delta are the same
+// Tick 0 = delta carries everything (no baseline yet)
 // Ticks 1-9 = delta is way smaller than full
 // Ticks 10-39 = delta is even smaller as there is nothing changing
-int main() {
+int main(int argc, char** argv) {
     using namespace std::chrono;
-    DemoServer server; // This constructor sets s_instance
 
-    std::cout << "Server started.\n";
+    // --matches N [--ticks T] [--threads K]: match-host mode instead of the single-match demo
+    // --sim-threads K: single match, parallel tick on K threads (same output as without)
+    // --verify-sim K [--ticks T]: check that the K-thread tick hashes the same as the serial one
+    // --verify-rollback K [--ticks T]: roll back and resimulate K ticks every K ticks, hashes must match
+    // --record <log>: record the single-match demo for deterministic_sim_replay
+    // --hot-reload S: keep the single-match demo running S seconds, reloading scripts and defs on save
+    uint32_t host_matches = 0, host_ticks = 90, rollback_depth = 0, hot_reload_s = 0;
+    unsigned host_threads = 0, sim_threads = 0, verify_threads = 0;
+    const char* record_path = nullptr;
+    for (int a = 1; a + 1 < argc; a += 2) {
+        if (strcmp(argv[a], "--matches") == 0) host_matches = static_cast<uint32_t>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--ticks") == 0) host_ticks = static_cast<uint32_t>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--threads") == 0) host_threads = static_cast<unsigned>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--sim-threads") == 0) sim_threads = static_cast<unsigned>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--verify-sim") == 0) verify_threads = static_cast<unsigned>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--verify-rollback") == 0) rollback_depth = static_cast<uint32_t>(atoi(argv[a + 1]));
+        else if (strcmp(argv[a], "--record") == 0) record_path = argv[a + 1];
+        else if (strcmp(argv[a], "--hot-reload") == 0) hot_reload_s = static_cast<uint32_t>(atoi(argv[a + 1]));
+    }
+    // gameplay logging goes through the writer thread from here on; every mode stops it
+    // before printing its own report straight to std::cout
+    Log::start();
+    if (host_matches > 0) return runMatchHost(host_matches, host_ticks, host_threads);
+    if (verify_threads > 0) return runVerifySim(host_ticks, verify_threads);
+    if (rollback_depth > 0) return runVerifyRollback(host_ticks, rollback_depth);
+
+    DemoServer server;
+    std::unique_ptr<WorkStealingPool> sim_pool;
+    if (sim_threads > 1) {
+        sim_pool.reset(new WorkStealingPool(sim_threads));
+        server.setSimulationPool(sim_pool.get());
+    }
+    if (hot_reload_s > 0) server.enableHotReload();
+
+    MOBA_LOG(App, Info, "Server started.");
 
     // Lua/Engine API Test
-    std::cout << "--- API Test: Spawning Projectile ---\n";
-    int proj_id = Engine_SpawnProjectile(1001, 0.0, 0.0, 1.0, 0.0, 10.0, 0.5, 2.0, "explode");
-    Engine_ApplyKnockback(proj_id, 1001, -1.0, 0.0, 5.0, 0.2);
+    MOBA_LOG(App, Info, "--- API Test: Spawning Projectile ---");
+    int proj_id = server.SpawnProjectile(1001, 0.0, 0.0, 1.0, 0.0, 10.0, 0.5, 2.0);
+    server.ApplyKnockback(proj_id, 1001, -1.0, 0.0, 5.0, 0.2);
 
     // create synthetic client input sequence for client 1 to move right for 10 ticks
     // after tick 10, it does not move anymore
@@ -643,38 +233,65 @@ int main() {
         server.receiveInput(in);
     }
 
-    // We'll run 40 ticks and show snapshots
-    Snapshot last_sent_snap; // empty for tick 0
-    bool has_last = false;
+    // attached after the setup above: its keyframe carries the queued spawn/knockback commands
+    ReplayRecorder recorder;
+    if (record_path) {
+        if (recorder.open(record_path)) server.setReplayRecorder(&recorder);
+        else MOBA_LOG(Replay, Error, "cannot write {}", record_path);
+    }
+
+    // We'll run 40 ticks (or --hot-reload's seconds) and show snapshots
+    uint32_t demo_ticks = hot_reload_s > 0 ? hot_reload_s * SERVER_TICK_RATE : 40;
+    std::vector<ClientSnapshotRef> outgoing;
+    Snapshot snap; // the printout's view, captured after each tick
 
     // run sim
     uint64_t tick_ns = TICK_NS;
     auto next_tick_time = steady_clock::now();
 
-    for (uint32_t i = 0; i < 40; ++i) {
+    for (uint32_t i = 0; i < demo_ticks; ++i) {
         next_tick_time += nanoseconds(tick_ns);
         std::this_thread::sleep_until(next_tick_time);
 
-        // fails only on tick 0
-        if (has_last) server.updatePrevBeforeFromSnapshot(last_sent_snap);
-
-        Snapshot snap = server.tick();
+        server.tick();
+        server.buildClientSnapshots(outgoing);
+        server.captureSnapshot(snap);
 
         // Print status
         for (auto const& e : snap.entities) {
-            std::cout << "[Tick " << snap.server_tick << "] Entity ID " << e.id
-                      << " Type: " << (e.type == EntityType::Character ? "CHR" : "PRJ")
-                      << " pos=(" << to_world(e.pos_x) << "," << to_world(e.pos_y) << ")"
-                      << " vel=(" << to_world(e.vel_x) << "," << to_world(e.vel_y) << ")\n";
+            MOBA_LOG(App, Info, "[Tick {}] Entity ID {} Type: {} pos=({},{}) vel=({},{})", snap.server_tick, e.id,
+                     e.type == EntityType::Character ? "CHR" : "PRJ", to_world(e.pos_x), to_world(e.pos_y), to_world(e.vel_x),
+                     to_world(e.vel_y));
+        }
 
         auto full = serializeFull(snap);
-        auto delta = serializeDelta(snap, server.getPrevBefore());
-        std::cout << "  Serialized: full=" << full.size() << " bytes, delta=" << delta.size() << " bytes\n";
-
-        last_sent_snap = snap;
-        has_last = true;
+        for (auto const& pkt : outgoing) {
+            MOBA_LOG(App, Info, "  Serialized: full={} bytes, delta={} bytes in {} packet(s) (client {})", full.size(), pkt.bytes(),
+                     pkt.fragment_count, pkt.client_id);
+            // demo: pretend the client received it and acked right away
+            server.onSnapshotAck(pkt.client_id, snap.server_tick);
         }
+
+        server.runIdleWork(next_tick_time + nanoseconds(tick_ns));
+    }
+    Log::stop();
+
+    if (recorder.isOpen()) {
+        server.setReplayRecorder(nullptr);
+        recorder.close();
+        std::cout << "[Replay] recorded " << recorder.stats().inputs << " inputs, " << recorder.stats().keyframes << " keyframes, "
+                  << recorder.stats().bytes << " bytes to " << record_path << "\n";
     }
+    std::cout << "[State] hash after " << demo_ticks << " ticks: " << std::hex << server.stateHash() << std::dec << "\n";
+    LuaVmStats lua = server.getLuaStats();
+    std::cout << "[Lua] VM memory: " << lua.memory.bytes_in_use / 1024 << " KB in use, peak " << lua.memory.peak_bytes / 1024
+              << " KB, " << lua.memory.reserved_bytes / 1024 << " KB pooled (" << lua.memory.pooled_allocs << " pooled / "
+              << lua.memory.large_allocs << " large allocs); GC " << lua.gc_steps << " steps (" << lua.gc_skipped
+              << " skipped, " << lua.gc_forced << " forced), max " << lua.gc_ns_max / 1000 << " us\n";
+#if MOBA_TICK_PROFILER
+    server.getProfiler().flush();
+    server.getProfiler().dump(std::cout);
+#endif
     std::cout << "Demo finished.\n";
     return 0;
 }
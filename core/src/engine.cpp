@@ -0,0 +1,1304 @@
+#include "engine.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "../../vendor/cpp/nlohmann/json.hpp"
+#include "combat.h"
+#include "entity_state.h"
+#include "hot_reload.h"
+#include "log.h"
+#include "replay.h"
+#include "thread_pool.h"
+#include "tick.h"
+
+using json = nlohmann::json;
+
+// ---------- Simple deterministic "physics" & logic ----------
+// For the demo: movement and simple velocity decay (friction). All integer arithmetic.
+
+// Convert to velocity per tick in fixed-point world units.
+// Suppose max_speed = 5.0 units/sec. We need vel per tick:
+// vel_per_tick_fixed = round(max_speed * (1/TICK_RATE) * POS_SCALE * (normalized_dir / 127))
+// We avoid floats by using integer arithmetic: use constants in fixed integer form.
+constexpr int32_t MAX_SPEED_FIXED_PER_TICK = static_cast<int32_t>( (5.0f * POS_SCALE) / SERVER_TICK_RATE );
+constexpr int32_t FRICTION_PER_TICK = 25; // 0.025 world units per tick drag
+
+// Inputs the entity's statuses forbid are dropped: a rooted character's velocity is left alone,
+// a stunned one doesn't cast either
+void applyInputsToEntity(EntityStore &s, uint32_t i, InputSpan inputs, std::vector<SimEvent>& event_queue) {
+    uint16_t status = s.cold[i].status_flags;
+    bool can_move = (status & STATUS_BLOCKS_MOVES) == 0;
+    bool can_cast = (status & STATUS_BLOCKS_CASTS) == 0;
+    for (auto const& in : inputs) {
+        if (can_move && (in.move_dx != 0 || in.move_dy != 0)) {
+            int32_t nx = static_cast<int32_t>(in.move_dx); // -127..127
+            int32_t ny = static_cast<int32_t>(in.move_dy);
+            int32_t new_vx = (MAX_SPEED_FIXED_PER_TICK * nx) / 127;
+            int32_t new_vy = (MAX_SPEED_FIXED_PER_TICK * ny) / 127;
+            s.vel_x[i] = new_vx;
+            s.vel_y[i] = new_vy;
+        }
+        if (can_cast && in.action_flags != 0) {
+            SimEvent ev;
+            ev.type = SimEventType::CastAbility;
+            ev.caster_id = s.id[i];
+            ev.ability_id = in.ability_id;
+            ev.target_x = in.target_x;
+            ev.target_y = in.target_y;
+
+            event_queue.push_back(ev);
+        }
+    }
+}
+
+// Per-type tick functions run one batched kernel over the whole type partition (see tick.h)
+void simulateCharacterTick(EntityStore &s, EntityStore::Range r) {
+    integrateCharacters(motionColumns(s, r.begin, r.end), FRICTION_PER_TICK);
+}
+
+void simulateProjectileTick(EntityStore &s, EntityStore::Range r) {
+    integrateProjectiles(motionColumns(s, r.begin, r.end));
+}
+
+// ---------- Demo server class ----------
+
+// ---------- DemoServer ----------
+
+DemoServer::DemoServer(std::string dir) : server_tick(0), game_dir(std::move(dir)) {
+    luaBridge.setGcBudget(LUA_GC_BUDGET_NS);
+    luaBridge.setMemoryLimit(LUA_VM_LIMIT_BYTES);
+
+    resolveDataDir();
+    LoadGameDefs();
+    LoadMapDefs();
+
+    // First char
+    SpawnCharacter(0.0f, 0.0f);
+
+    entity_tick_table[static_cast<uint32_t>(EntityType::Character)] = simulateCharacterTick;
+    entity_tick_table[static_cast<uint32_t>(EntityType::Projectile)] = simulateProjectileTick;
+
+    // never holds more than the pool, so pointers handed out in ClientSnapshotRef stay put
+    outgoing_fragments.reserve(send_pool.capacity());
+}
+
+void DemoServer::resolveDataDir() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    // one data dir for defs, map and scripts: the given one, else the source tree's game/ the
+    // build was configured with (so what runs and hot-reloads is what gets edited there), else
+    // the first candidate holding either form of the defs
+    std::string dir = game_dir;
+    defs_blob.clear();
+#ifdef MOBA_GAME_DIR
+    if (dir.empty() && fs::exists(MOBA_GAME_DIR "game_defs.json", ec)) {
+        dir = MOBA_GAME_DIR;
+        defs_blob = MOBA_GAME_DEFS_BLOB; // compiled from that JSON into the build tree
+    }
+#endif
+    if (dir.empty()) {
+        dir = "game/";
+        for (const char* candidate : {"game/", "../../../game/"}) {
+            if (fs::exists(std::string(candidate) + "game_defs.bin", ec) || fs::exists(std::string(candidate) + "game_defs.json", ec)) {
+                dir = candidate;
+                break;
+            }
+        }
+    }
+    if (defs_blob.empty()) defs_blob = dir + "game_defs.bin";
+    defs_dir = dir;
+    // scripts live next to the defs file: <dir>/scripts/<ability script>
+    scripts_root = dir + "scripts/";
+}
+
+void DemoServer::LoadGameDefs() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    std::string const& blob_path = defs_blob;
+    std::string json_path = defs_dir + "game_defs.json";
+
+    // the compiled blob (moba_defs_compiler) is mapped and used in place; the JSON is only
+    // parsed when there is no blob, or it is stale or was built for other units
+    std::string error;
+    bool have_blob = fs::exists(blob_path, ec);
+    if (have_blob && fs::exists(json_path, ec) && fs::last_write_time(json_path, ec) > fs::last_write_time(blob_path, ec)) {
+        MOBA_LOG(Gameplay, Warn, "{} is older than {}, compiling the JSON instead", blob_path, json_path);
+        have_blob = false;
+    }
+    if (have_blob && defs.mapFile(blob_path, error)) {
+        DefsUnits u = defs.units();
+        if (u.pos_scale != static_cast<uint32_t>(POS_SCALE) || u.tick_rate != static_cast<uint32_t>(SERVER_TICK_RATE)) {
+            MOBA_LOG(Gameplay, Warn, "{} was compiled for other units, compiling the JSON instead", blob_path);
+            defs.clear();
+        }
+    } else if (have_blob) {
+        MOBA_LOG(Gameplay, Error, "Error: {}", error);
+    }
+
+    if (!defs.loaded()) {
+        std::ifstream f(json_path, std::ios::binary);
+        if (!f.is_open()) {
+            MOBA_LOG(Gameplay, Error, "Error: could not open {}", json_path);
+            return;
+        }
+        std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        std::vector<uint8_t> blob;
+        if (!CompileGameDefs(text, DefsUnits{POS_SCALE, SERVER_TICK_RATE}, blob, error) || !defs.adopt(std::move(blob), error)) {
+            MOBA_LOG(Gameplay, Error, "Error: {}: {}", json_path, error);
+            return;
+        }
+    }
+    MOBA_LOG(Gameplay, Info, "Game defs: {} abilities, {} characters, {} buffs ({})", defs.abilityCount(), defs.characterCount(),
+             defs.buffCount(), defs.mapped() ? "mapped " + blob_path : "compiled from " + json_path);
+
+    // compiled chunks are cached as <hash>.luac, so a restart only reparses edited scripts
+    luaBridge.setBytecodeCacheDir(scripts_root + ".cache");
+    bindDefScripts();
+
+    // scripts nobody references in the defs yet (and ScriptPusher's imports) still get a
+    // handle; the defs ones above keep theirs since already-loaded names are skipped
+    luaBridge.loadAbilityDirectory(scripts_root + "abilities", "abilities/");
+    luaBridge.loadAbilityDirectory(scripts_root + "imported", "imported/");
+    auto const& ls = luaBridge.loadStats();
+    MOBA_LOG(Lua, Info, "Ability scripts: {} compiled, {} from bytecode cache, {} reused", ls.compiled, ls.disk_hits, ls.memory_hits);
+}
+
+void DemoServer::bindDefScripts() {
+    // every ability has its id before the first script runs (FindAbility at load); the Lua
+    // entry points are resolved once, casts then go by handle (SimEvent::ability_id)
+    ability_scripts.assign(defs.abilityCount(), INVALID_ABILITY);
+    for (AbilityId id = 0; id < defs.abilityCount(); ++id) {
+        std::string script = defs.abilityScript(id);
+        if (script.empty()) continue;
+        std::string script_path = scripts_root + script;
+        AbilityHandle h = luaBridge.findAbility(script);
+        if (h == INVALID_ABILITY && std::ifstream(script_path).good()) h = luaBridge.loadAbility(script, script_path);
+        ability_scripts[id] = h;
+    }
+
+    // a buff's hooks live in an ability script, normally already loaded for its ability above
+    buff_scripts.assign(defs.buffCount(), INVALID_ABILITY);
+    for (BuffId id = 0; id < defs.buffCount(); ++id) {
+        std::string script = defs.buffScript(id);
+        if (script.empty()) continue;
+        AbilityHandle h = luaBridge.findAbility(script);
+        if (h == INVALID_ABILITY && std::ifstream(scripts_root + script).good()) h = luaBridge.loadAbility(script, scripts_root + script);
+        buff_scripts[id] = h;
+    }
+
+    default_character = defs.findCharacter("hero_test");
+}
+
+void DemoServer::enableHotReload(bool on) {
+    if (!on) {
+        hot_reload.reset();
+        return;
+    }
+    if (hot_reload || scripts_root.empty()) return;
+    hot_reload.reset(new HotReloadWatcher(defs_dir, scripts_root, DefsUnits{POS_SCALE, SERVER_TICK_RATE}));
+    hot_reload->start();
+}
+
+void DemoServer::applyHotReload() {
+    HotReloadBatch batch;
+    if (!hot_reload->take(batch)) return;
+
+    if (batch.defs) {
+        defs.swap(*batch.defs); // the old tables go with the batch
+        MOBA_LOG(Gameplay, Info, "Hot reload: game defs from {} ({} abilities, {} characters, {} buffs)", batch.defs_source,
+                 defs.abilityCount(), defs.characterCount(), defs.buffCount());
+        for (uint32_t i = 0; i < entities.size(); ++i) cacheResists(i);
+        // scripts resolve ids at load time: rerun them all from their files (this batch's edits included)
+        MOBA_LOG(Lua, Info, "Hot reload: {} ability scripts rerun", luaBridge.reloadAbilities());
+    }
+    for (ScriptReload const& s : batch.scripts) {
+        bool known = luaBridge.findAbility(s.name) != INVALID_ABILITY;
+        if (known && batch.defs) continue; // rerun above
+        if (luaBridge.reloadAbility(s.name, s.path, s.bytecode) == INVALID_ABILITY) {
+            MOBA_LOG(Lua, Error, "Hot reload: {} failed, {}", s.name, known ? "the loaded version stays" : "not loaded");
+        } else {
+            MOBA_LOG(Lua, Info, "Hot reload: {} {}", s.name, known ? "reloaded" : "loaded");
+        }
+    }
+    // new defs, or a script the defs name that wasn't there at load time
+    bindDefScripts();
+}
+
+void DemoServer::LoadMapDefs(const std::string& map_id) {
+    std::string filepath = defs_dir + "map_defs.json"; // next to the defs (resolveDataDir)
+    std::ifstream f(filepath);
+    if (!f.is_open()) {
+        MOBA_LOG(Gameplay, Error, "Error: could not open {}, using default grid", filepath);
+        return;
+    }
+
+    json data = json::parse(f, nullptr, false);
+    if (data.is_discarded()) {
+        MOBA_LOG(Gameplay, Error, "Error: {} is not valid JSON, using default grid", filepath);
+        return;
+    }
+    std::string key = map_id.empty() ? data.value("defaultMap", std::string()) : map_id;
+    if (!data.contains("maps") || !data["maps"].contains(key)) {
+        MOBA_LOG(Gameplay, Error, "Error: map '{}' not found in {}, using default grid", key, filepath);
+        return;
+    }
+
+    auto const& map = data["maps"][key];
+    // round (not truncate) so e.g. 4.096 becomes exactly 4096 and keeps the shift fast path
+    auto fixed = [](double world) { return static_cast<int32_t>(std::llround(world * POS_SCALE)); };
+
+    GridConfig cfg;
+    if (map.contains("grid")) {
+        cfg.cell_size = fixed(map["grid"].value("cellSize", to_world(DEFAULT_CELL_SIZE)));
+        cfg.levels = map["grid"].value("levels", 1);
+    }
+    if (map.contains("origin")) {
+        cfg.origin_x = fixed(map["origin"].value("x", 0.0));
+        cfg.origin_y = fixed(map["origin"].value("y", 0.0));
+    }
+    interest = InterestConfig{};
+    if (map.contains("vision")) interest.vision_radius = fixed(map["vision"].value("radius", 0.0));
+    if (map.contains("size") && cfg.cell_size > 0) {
+        int64_t w = fixed(map["size"].value("width", 0.0));
+        int64_t h = fixed(map["size"].value("height", 0.0));
+        cfg.width_cells = static_cast<int32_t>((w + cfg.cell_size - 1) / cfg.cell_size);
+        cfg.height_cells = static_cast<int32_t>((h + cfg.cell_size - 1) / cfg.cell_size);
+    }
+
+    grid.Configure(cfg);
+    rewind_grid.Configure(cfg);
+    rewind_grid_tick = NO_BASELINE;
+    grid_dirty = true;
+    MOBA_LOG(Gameplay, Info, "Loaded map: {} ({}x{} cells, cell={}, levels={})", key, cfg.width_cells, cfg.height_cells, cfg.cell_size,
+             cfg.levels);
+}
+
+DemoServer::~DemoServer() = default;
+
+void DemoServer::processEvents() {
+    // inputs name game_defs ids; the script behind one is whatever bindDefScripts() found for it
+    auto script = [this](AbilityId id) { return id < ability_scripts.size() ? ability_scripts[id] : INVALID_ABILITY; };
+
+    // hits batched per ability like the casts below (stable: (projectile, target) order within a
+    // batch); what on_hit spawns belongs to the same ability
+    std::stable_sort(hit_events.begin(), hit_events.end(), [&](HitEvent const& a, HitEvent const& b) {
+        AbilityHandle ha = script(a.ability_id), hb = script(b.ability_id);
+        return ha != hb ? ha < hb : a.ability_id < b.ability_id;
+    });
+    for (size_t first = 0; first < hit_events.size();) {
+        AbilityId id = hit_events[first].ability_id;
+        size_t last = first;
+        while (last < hit_events.size() && hit_events[last].ability_id == id) ++last;
+        AbilityHandle h = script(id);
+        AbilityScript const* s = luaBridge.ability(h);
+        if (s && s->on_hit != LUA_NOREF) {
+            hit_batch.clear();
+            for (size_t k = first; k < last; ++k) {
+                HitEvent const& hit = hit_events[k];
+                hit_batch.push_back(HitRequest{ (int)hit.projectile_id, (int)hit.target_id, (int)hit.caster_id });
+            }
+            MOBA_PROFILE_LUA(profiler);
+            casting_ability = id;
+            luaBridge.callOnHitBatch(h, hit_batch.data(), hit_batch.size());
+        } else if (AbilityStats const* a = defs.ability(id)) { // no on_hit: the ability's own damage stat
+            for (size_t k = first; k < last; ++k) {
+                commands.damage(hit_events[k].caster_id, hit_events[k].target_id, a->damage, a->damage_type);
+            }
+        }
+        first = last;
+    }
+    hit_events.clear();
+
+    // one batch per ability, those sharing a script back to back
+    std::stable_sort(event_queue.begin(), event_queue.end(), [&](SimEvent const& a, SimEvent const& b) {
+        AbilityHandle ha = script(a.ability_id), hb = script(b.ability_id);
+        return ha != hb ? ha < hb : a.ability_id < b.ability_id;
+    });
+
+    for (size_t first = 0; first < event_queue.size();) {
+        AbilityId id = event_queue[first].ability_id;
+        size_t last = first;
+        cast_batch.clear();
+        while (last < event_queue.size() && event_queue[last].ability_id == id) {
+            SimEvent const& ev = event_queue[last++];
+            if (ev.type != SimEventType::CastAbility) continue;
+            cast_batch.push_back(CastRequest{ (int)ev.caster_id, (lua_Number)ev.target_x, (lua_Number)ev.target_y });
+        }
+        AbilityHandle h = script(id);
+        if (h != INVALID_ABILITY && !cast_batch.empty()) { // no script for the id (missing, failed to load): nothing to cast
+            MOBA_PROFILE_LUA(profiler);
+            casting_ability = id;
+            luaBridge.callCastBatch(h, cast_batch.data(), cast_batch.size());
+        }
+        first = last;
+    }
+    casting_ability = INVALID_DEF_ID;
+
+    event_queue.clear();
+}
+
+void DemoServer::applyCommands() {
+    commands.apply([this](GameCommand const& c) {
+        if (c.type == GameCommandType::SpawnProjectile) {
+            EntityState proj;
+            proj.id = c.target_id;
+            proj.type = EntityType::Projectile;
+            proj.pos_x = c.spawn.pos_x;
+            proj.pos_y = c.spawn.pos_y;
+            proj.vel_x = c.spawn.vel_x;
+            proj.vel_y = c.spawn.vel_y;
+            proj.radius = c.spawn.radius;
+            proj.lifetime_ticks = c.spawn.lifetime_ticks;
+            proj.ability_id = c.spawn.ability_id;
+            proj.caster_id = c.source_id;
+            uint32_t caster = entities.find(c.source_id);
+            proj.team = caster != EntityStore::INVALID_INDEX ? entities.team[caster] : TEAM_NEUTRAL;
+            entities.create(proj);
+            MOBA_LOG(Gameplay, Info, "Spawned Projectile {} at {},{}", proj.id, to_world(proj.pos_x), to_world(proj.pos_y));
+            return;
+        }
+
+        uint32_t i = entities.find(c.target_id);
+        if (i == EntityStore::INVALID_INDEX) return; // died/despawned earlier in the pass
+
+        switch (c.type) {
+            case GameCommandType::SetMovement:
+                entities.vel_x[i] = c.move.vel_x;
+                entities.vel_y[i] = c.move.vel_y;
+                break;
+            case GameCommandType::Knockback:
+                entities.vel_x[i] += c.knockback.dvel_x;
+                entities.vel_y[i] += c.knockback.dvel_y;
+                MOBA_LOG(Gameplay, Info, "Knockback applied to {} by {}", c.target_id, c.source_id);
+                break;
+            case GameCommandType::Damage:
+                damage_batch.push(c.source_id, c.target_id, c.damage.amount, c.damage.type); // resolveDamage()
+                break;
+            case GameCommandType::ApplyBuff:
+                applyBuff(i, c.source_id, c.buff.buff_id);
+                break;
+            case GameCommandType::RemoveBuff: {
+                EntityCold const& cold = entities.cold[i];
+                for (uint32_t b = cold.active_buff_count; b-- > 0;) {
+                    if (cold.buffs[b].buff_id == c.buff.buff_id) removeBuff(i, b);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    });
+    resolveDamage();
+}
+
+void DemoServer::resolveDamage() {
+    size_t n = damage_batch.size();
+    if (n == 0) return;
+    damage_batch.resist.resize(n);
+
+    // hits arrive grouped by target (the pass is sorted by target): one lookup per target
+    for (size_t first = 0; first < n;) {
+        uint32_t target = damage_batch.target_id[first];
+        size_t last = first;
+        while (last < n && damage_batch.target_id[last] == target) ++last;
+        uint32_t i = entities.find(target);
+        EntityCold const* c = i != EntityStore::INVALID_INDEX ? &entities.cold[i] : nullptr;
+        for (size_t k = first; k < last; ++k) {
+            DamageType t = damage_batch.type[k];
+            damage_batch.resist[k] = !c ? 0 : t == DamageType::Magical ? c->magic_resist : t == DamageType::Physical ? c->armor : 0;
+        }
+        first = last;
+    }
+
+    damage_batch.compute();
+
+    for (size_t first = 0; first < n;) {
+        uint32_t target = damage_batch.target_id[first];
+        size_t last = first;
+        int64_t total = 0;
+        for (; last < n && damage_batch.target_id[last] == target; ++last) total += damage_batch.final_damage[last];
+        uint32_t i = entities.find(target);
+        if (i != EntityStore::INVALID_INDEX) {
+            int32_t& health = entities.cold[i].health;
+            int64_t left = static_cast<int64_t>(health) - total;
+            health = left < 0 ? 0 : left > INT32_MAX ? INT32_MAX : static_cast<int32_t>(left);
+
+            // one line per target and tick, however many hits it took
+            if (last - first == 1) {
+                MOBA_LOG(Combat, Info, "Entity {} took {} final dmg (Raw: {}, Type: {}) from Entity {}", target, damage_batch.final_damage[first],
+                         damage_batch.raw[first], DamageTypeName(damage_batch.type[first]), damage_batch.source_id[first]);
+            } else {
+                MOBA_LOG(Combat, Info, "Entity {} took {} final dmg from {} hits", target, total, last - first);
+            }
+        }
+        first = last;
+    }
+    damage_batch.clear();
+}
+
+void DemoServer::cacheResists(uint32_t i) {
+    EntityCold& c = entities.cold[i];
+    CharacterStats const* cs = entities.type[i] == EntityType::Character ? defs.character(default_character) : nullptr;
+    c.armor = cs ? cs->armor : 0;
+    c.magic_resist = cs ? cs->magic_resist : 0;
+}
+
+void DemoServer::applyBuff(uint32_t i, uint32_t source_id, BuffId buff_id) {
+    BuffStats const* bs = defs.buff(buff_id);
+    if (!bs) return;
+    EntityCold& c = entities.cold[i];
+    // a buff lasts at least one tick, so its expiry is always still ahead of the wheel
+    uint32_t expire = bs->duration_ticks < 0 ? BUFF_PERMANENT : server_tick + static_cast<uint32_t>(bs->duration_ticks > 0 ? bs->duration_ticks : 1);
+
+    for (uint32_t b = 0; b < c.active_buff_count; ++b) {
+        ActiveBuff& active = c.buffs[b];
+        if (active.buff_id != buff_id || active.source_entity_id != source_id) continue;
+        active.expire_tick = expire; // refresh: periods keep their cadence, no second on_apply
+        scheduleBuff(entities.id[i], active, server_tick + 1);
+        return;
+    }
+    if (c.active_buff_count >= 8) {
+        MOBA_LOG(Gameplay, Info, "Entity {} has no free buff slot for {}", entities.id[i], defs.buffName(buff_id));
+        return;
+    }
+
+    ActiveBuff& added = c.buffs[c.active_buff_count++];
+    added.source_entity_id = source_id;
+    added.buff_id = buff_id;
+    added.applied_tick = server_tick;
+    added.expire_tick = expire;
+    c.status_flags |= bs->status_flags;
+    scheduleBuff(entities.id[i], added, server_tick + 1);
+    buff_hooks.push_back(BuffHookCall{ buff_scripts[buff_id], BuffHook::Apply,
+                                       BuffHookRequest{ (int)entities.id[i], (int)source_id, (int)buff_id } });
+}
+
+void DemoServer::removeBuff(uint32_t i, uint32_t slot) {
+    EntityCold& c = entities.cold[i];
+    ActiveBuff gone = c.buffs[slot];
+    // slot order is part of the hashed state: shift, don't swap
+    for (uint32_t b = slot + 1; b < c.active_buff_count; ++b) c.buffs[b - 1] = c.buffs[b];
+    c.buffs[--c.active_buff_count] = ActiveBuff{};
+    recomputeStatus(i);
+    AbilityHandle script = gone.buff_id < buff_scripts.size() ? buff_scripts[gone.buff_id] : INVALID_ABILITY; // keyframes may carry unknown ids
+    buff_hooks.push_back(BuffHookCall{ script, BuffHook::Expire,
+                                       BuffHookRequest{ (int)entities.id[i], (int)gone.source_entity_id, (int)gone.buff_id } });
+}
+
+void DemoServer::recomputeStatus(uint32_t i) {
+    EntityCold& c = entities.cold[i];
+    uint16_t flags = 0;
+    for (uint32_t b = 0; b < c.active_buff_count; ++b) {
+        if (BuffStats const* bs = defs.buff(c.buffs[b].buff_id)) flags |= bs->status_flags;
+    }
+    c.status_flags = flags;
+}
+
+void DemoServer::scheduleBuff(uint32_t entity_id, ActiveBuff const& b, uint32_t from) {
+    BuffStats const* bs = defs.buff(b.buff_id);
+    if (!bs) return;
+    BuffTimer timer{ entity_id, b.source_entity_id, b.applied_tick, b.buff_id, BuffTimerKind::Expire };
+    if (b.expire_tick != BUFF_PERMANENT && b.expire_tick >= from) buff_wheel.schedule(b.expire_tick, timer);
+    if (bs->period_ticks > 0) {
+        // next tick on the cadence applied + k * period (k >= 1) at or after `from`
+        uint32_t period = static_cast<uint32_t>(bs->period_ticks);
+        uint32_t k = from > b.applied_tick ? (from - b.applied_tick + period - 1) / period : 1;
+        uint64_t next = uint64_t(b.applied_tick) + uint64_t(k) * period;
+        timer.kind = BuffTimerKind::Period;
+        if (next <= b.expire_tick) buff_wheel.schedule(static_cast<uint32_t>(next), timer);
+    }
+}
+
+void DemoServer::rebuildBuffTimers() {
+    buff_wheel.reset(server_tick);
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        EntityCold const& c = entities.cold[i];
+        for (uint32_t b = 0; b < c.active_buff_count; ++b) scheduleBuff(entities.id[i], c.buffs[b], server_tick);
+    }
+}
+
+void DemoServer::processBuffs() {
+    if (buff_wheel.now() != server_tick) rebuildBuffTimers(); // the tick counter was moved under the wheel
+    buff_due.clear();
+    buff_wheel.advance(buff_due);
+    if (buff_due.empty()) return;
+
+    // a refresh can leave a second timer for the same period: fire each once, in a fixed order
+    std::sort(buff_due.begin(), buff_due.end(), [](BuffTimer const& a, BuffTimer const& b) {
+        if (a.entity_id != b.entity_id) return a.entity_id < b.entity_id;
+        if (a.buff_id != b.buff_id) return a.buff_id < b.buff_id;
+        if (a.source_id != b.source_id) return a.source_id < b.source_id;
+        if (a.applied_tick != b.applied_tick) return a.applied_tick < b.applied_tick;
+        return a.kind < b.kind;
+    });
+    buff_due.erase(std::unique(buff_due.begin(), buff_due.end(), [](BuffTimer const& a, BuffTimer const& b) {
+        return a.entity_id == b.entity_id && a.buff_id == b.buff_id && a.source_id == b.source_id &&
+               a.applied_tick == b.applied_tick && a.kind == b.kind;
+    }), buff_due.end());
+
+    for (BuffTimer const& t : buff_due) {
+        uint32_t i = entities.find(t.entity_id);
+        if (i == EntityStore::INVALID_INDEX) continue;
+        EntityCold const& c = entities.cold[i];
+        uint32_t slot = 0;
+        while (slot < c.active_buff_count && (c.buffs[slot].buff_id != t.buff_id || c.buffs[slot].source_entity_id != t.source_id ||
+                                              c.buffs[slot].applied_tick != t.applied_tick)) {
+            ++slot;
+        }
+        if (slot == c.active_buff_count) continue; // removed since (or removed and applied again)
+        ActiveBuff const& b = c.buffs[slot];
+        BuffStats const* bs = defs.buff(b.buff_id);
+        if (!bs) continue;
+
+        if (t.kind == BuffTimerKind::Expire) {
+            if (b.expire_tick == server_tick) removeBuff(i, slot); // otherwise refreshed since
+            continue;
+        }
+        if (bs->tick_damage != 0) commands.damage(b.source_entity_id, t.entity_id, bs->tick_damage, bs->damage_type);
+        uint64_t next = uint64_t(server_tick) + static_cast<uint32_t>(bs->period_ticks);
+        if (next <= b.expire_tick) buff_wheel.schedule(static_cast<uint32_t>(next), t);
+    }
+}
+
+void DemoServer::flushBuffHooks() {
+    if (buff_hooks.empty()) return;
+    std::stable_sort(buff_hooks.begin(), buff_hooks.end(), [](BuffHookCall const& a, BuffHookCall const& b) {
+        return a.script != b.script ? a.script < b.script : a.hook < b.hook;
+    });
+    for (size_t first = 0; first < buff_hooks.size();) {
+        size_t last = first;
+        buff_hook_batch.clear();
+        while (last < buff_hooks.size() && buff_hooks[last].script == buff_hooks[first].script &&
+               buff_hooks[last].hook == buff_hooks[first].hook) {
+            buff_hook_batch.push_back(buff_hooks[last++].request);
+        }
+        if (buff_hooks[first].script != INVALID_ABILITY) {
+            MOBA_PROFILE_LUA(profiler);
+            luaBridge.callBuffHooks(buff_hooks[first].script, buff_hooks[first].hook, buff_hook_batch.data(), buff_hook_batch.size());
+        }
+        first = last;
+    }
+    buff_hooks.clear();
+}
+
+void DemoServer::SimInit() {
+    // nothing for now (constructor already initializes)
+}
+
+bool DemoServer::enqueueClientInputPacket(const ClientInputPacket& pkt) {
+    if (!inbound_packets.try_push(pkt)) {
+        ingest.packets_dropped_full.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ingest.packets_queued.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DemoServer::runIdleWork(std::chrono::steady_clock::time_point deadline) {
+    if (hot_reload && hot_reload->pending()) applyHotReload();
+    MOBA_PROFILE_PHASE(profiler, TickPhase::LuaGc);
+    auto now = std::chrono::steady_clock::now();
+    uint64_t slack = deadline > now ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count()) : 0;
+    luaBridge.collectGarbage(slack);
+}
+
+IngestStats DemoServer::getIngestStats() const {
+    IngestStats st;
+    st.packets_queued = ingest.packets_queued.load(std::memory_order_relaxed);
+    st.packets_dropped_full = ingest.packets_dropped_full.load(std::memory_order_relaxed);
+    st.inputs_accepted = ingest.inputs_accepted.load(std::memory_order_relaxed);
+    st.inputs_duplicate = ingest.inputs_duplicate.load(std::memory_order_relaxed);
+    st.inputs_stale = ingest.inputs_stale.load(std::memory_order_relaxed);
+    st.inputs_dropped_full = ingest.inputs_dropped_full.load(std::memory_order_relaxed);
+    return st;
+}
+
+InputQueue& DemoServer::queueFor(uint32_t client_id) {
+    return input_queues.try_emplace(client_id, server_tick).first->second;
+}
+
+void DemoServer::recordAccepted(ClientInput const& in) {
+    if (replay) replay->recordInput(in);
+}
+
+bool DemoServer::receiveInput(ClientInput const& in) {
+    // ensure a queue exists for this client
+    auto &q = queueFor(in.client_id);
+    client_net.try_emplace(in.client_id);
+    if (q.push(in) != InputPushResult::Accepted) return false;
+    recordAccepted(in);
+    return true;
+}
+
+void DemoServer::handleClientInputPacket(const ClientInputPacket& pkt) {
+    onSnapshotAck(pkt.clientId, pkt.ackedTick);
+    if (pkt.hashTick != NO_BASELINE) checkClientStateHash(pkt.clientId, pkt.hashTick, pkt.stateHash);
+    uint8_t count = pkt.inputCount < 32 ? pkt.inputCount : 32;
+    for (uint8_t i = 0; i < count; i++) {
+        const ClientInput& input = pkt.inputs[i];
+        // every packet resends recent inputs, so Duplicate/Stale are the normal case
+        switch (queueFor(input.client_id).push(input)) {
+            case InputPushResult::Accepted:
+                ingest.inputs_accepted.fetch_add(1, std::memory_order_relaxed);
+                recordAccepted(input);
+                break;
+            case InputPushResult::Duplicate: ingest.inputs_duplicate.fetch_add(1, std::memory_order_relaxed); break;
+            case InputPushResult::Stale:     ingest.inputs_stale.fetch_add(1, std::memory_order_relaxed); break;
+            case InputPushResult::TooFar:
+            case InputPushResult::Full:      ingest.inputs_dropped_full.fetch_add(1, std::memory_order_relaxed); break;
+        }
+    }
+}
+
+bool DemoServer::checkClientStateHash(uint32_t client_id, uint32_t tick, uint32_t client_hash) {
+    ++desync.reports;
+    SnapshotFrame const* f = snapshot_ring.find(tick);
+    if (!f) {
+        ++desync.unverified;
+        return true;
+    }
+    uint32_t ours = static_cast<uint32_t>(f->state_hash);
+    if (ours == client_hash) return true;
+
+    ++desync.mismatches;
+    if (desync.first_mismatch_tick == NO_BASELINE) {
+        desync.first_mismatch_tick = tick;
+        desync.first_mismatch_client = client_id;
+    }
+    ClientNetState& c = client_net[client_id];
+    if (c.desync_tick == NO_BASELINE) {
+        c.desync_tick = tick;
+        MOBA_LOG(Desync, Warn, "client {} diverged at tick {} (client hash {}, server {})", client_id, tick, LogHex{client_hash},
+                 LogHex{ours});
+    }
+    return false;
+}
+
+void DemoServer::setReplayRecorder(ReplayRecorder* recorder) {
+    replay = recorder;
+    if (!replay) return;
+    saveKeyframe(keyframe_scratch);
+    replay->recordKeyframe(keyframe_scratch);
+    keyframe_tick = server_tick;
+    for (auto const& kv : input_queues) {
+        kv.second.forEachQueued([this](ClientInput const& in) { replay->recordInput(in); });
+    }
+}
+
+template <class T>
+static void appendRaw(std::vector<uint8_t>& out, T const* data, size_t count) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    out.insert(out.end(), p, p + count * sizeof(T));
+}
+
+void DemoServer::saveKeyframe(std::vector<uint8_t>& out) const {
+    std::vector<GameCommand> const& pending = commands.pending();
+    ReplayKeyframeHeader h;
+    h.tick = server_tick;
+    h.next_entity_serial = entity_ids.nextSerial();
+    h.state_hash = computeStateHash(entities, server_tick);
+    h.entity_count = static_cast<uint32_t>(entities.size());
+    h.command_count = static_cast<uint32_t>(pending.size());
+    h.event_count = static_cast<uint32_t>(event_queue.size());
+    size_t free_ids = 0;
+    for (uint32_t t = 0; t < ENTITY_TYPE_COUNT; ++t) {
+        h.free_id_count[t] = static_cast<uint32_t>(entity_ids.freeCount(static_cast<EntityType>(t)));
+        free_ids += h.free_id_count[t];
+    }
+
+    out.clear();
+    out.reserve(sizeof(h) + h.entity_count * sizeof(EntityState) + pending.size() * sizeof(GameCommand) +
+                event_queue.size() * sizeof(SimEvent) + free_ids * sizeof(uint32_t));
+    appendRaw(out, &h, 1);
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        EntityState e = entities.get(i);
+        appendRaw(out, &e, 1);
+    }
+    appendRaw(out, pending.data(), pending.size());
+    appendRaw(out, event_queue.data(), event_queue.size());
+    for (uint32_t t = 0; t < ENTITY_TYPE_COUNT; ++t) appendRaw(out, entity_ids.freeIds(static_cast<EntityType>(t)), h.free_id_count[t]);
+}
+
+bool DemoServer::loadKeyframe(const uint8_t* data, size_t size) {
+    if (size < sizeof(ReplayKeyframeHeader)) return false;
+    ReplayKeyframeHeader h;
+    memcpy(&h, data, sizeof(h));
+    uint64_t free_ids = 0;
+    for (uint32_t t = 0; t < ENTITY_TYPE_COUNT; ++t) free_ids += h.free_id_count[t];
+    size_t expect = sizeof(h) + uint64_t(h.entity_count) * sizeof(EntityState) + uint64_t(h.command_count) * sizeof(GameCommand) +
+                    uint64_t(h.event_count) * sizeof(SimEvent) + free_ids * sizeof(uint32_t);
+    if (size != expect) return false;
+
+    const uint8_t* at = data + sizeof(h);
+    entities.clear();
+    for (uint32_t k = 0; k < h.entity_count; ++k, at += sizeof(EntityState)) {
+        EntityState e;
+        memcpy(&e, at, sizeof(e));
+        entities.create(e);
+        cacheResists(entities.find(e.id));
+    }
+    std::vector<GameCommand> pending(h.command_count);
+    if (h.command_count) memcpy(pending.data(), at, h.command_count * sizeof(GameCommand));
+    at += h.command_count * sizeof(GameCommand);
+    commands.restore(pending.data(), pending.size());
+    event_queue.resize(h.event_count);
+    if (h.event_count) memcpy(event_queue.data(), at, h.event_count * sizeof(SimEvent));
+    at += h.event_count * sizeof(SimEvent);
+    entity_ids.reset(h.next_entity_serial);
+    for (uint32_t t = 0; t < ENTITY_TYPE_COUNT; ++t) {
+        for (uint32_t k = 0; k < h.free_id_count[t]; ++k, at += sizeof(uint32_t)) {
+            uint32_t id;
+            memcpy(&id, at, sizeof(id));
+            entity_ids.pushFree(static_cast<EntityType>(t), id);
+        }
+    }
+
+    server_tick = h.tick;
+    input_queues.clear(); // recreated at server_tick by queueFor()
+    rebuildBuffTimers();
+    for (SavedState& saved : history) saved.tick = NO_BASELINE;
+    rewind_grid_tick = NO_BASELINE;
+    grid_dirty = true;
+    for (auto& kv : client_net) kv.second.acked_tick = NO_BASELINE; // ring frames are from the old timeline
+
+    // creating in saved order restores the dense layout too, so every later pass runs in the same order
+    return computeStateHash(entities, server_tick) == h.state_hash;
+}
+
+SavedState* DemoServer::savedState(uint32_t tick) {
+    if (history.empty() || tick == NO_BASELINE) return nullptr;
+    SavedState& saved = history[tick % STATE_HISTORY_TICKS];
+    return saved.tick == tick ? &saved : nullptr;
+}
+
+void DemoServer::setStateHistory(bool every_tick) {
+    history_every_tick = every_tick;
+    if (history.empty()) history.resize(STATE_HISTORY_TICKS);
+}
+
+void DemoServer::SaveState() {
+    if (history.empty()) history.resize(STATE_HISTORY_TICKS);
+    SavedState& saved = history[server_tick % STATE_HISTORY_TICKS];
+    saved.tick = server_tick;
+    saved.entity_ids = entity_ids;
+    saved.state_hash = state_hash;
+    saved.entities = entities; // column by column into the slot's existing capacity
+    saved.commands = commands.pending();
+    saved.events = event_queue;
+    if (rewind_grid_tick == server_tick) rewind_grid_tick = NO_BASELINE; // re-saved after a rollback
+}
+
+bool DemoServer::RestoreState(uint32_t tick) {
+    SavedState* saved = savedState(tick);
+    if (!saved || replay) return false;
+
+    entities = saved->entities; // same dense order, so the resimulated passes run in the same order
+    entity_ids = saved->entity_ids;
+    commands.restore(saved->commands.data(), saved->commands.size());
+    event_queue = saved->events;
+    state_hash = saved->state_hash;
+    server_tick = tick;
+    grid_dirty = true;
+    rebuildBuffTimers();
+
+    // STATE_HISTORY_TICKS <= INPUT_WINDOW_TICKS: every queue can rewind this far
+    for (auto& kv : input_queues) kv.second.rewind(tick);
+
+    // everything newer belongs to the timeline being replaced
+    for (SavedState& h : history) {
+        if (h.tick != NO_BASELINE && h.tick > tick) h.tick = NO_BASELINE;
+    }
+    if (rewind_grid_tick != NO_BASELINE && rewind_grid_tick > tick) rewind_grid_tick = NO_BASELINE;
+    for (auto& kv : client_net) {
+        if (kv.second.acked_tick != NO_BASELINE && kv.second.acked_tick >= tick) kv.second.acked_tick = NO_BASELINE;
+    }
+    return true;
+}
+
+uint32_t DemoServer::LagCompensatedQuery(uint32_t view_tick, int32_t x, int32_t y, int32_t radius, uint32_t ignore_id,
+                                         std::vector<uint32_t>& out) {
+    out.clear();
+    if (history.empty()) return NO_BASELINE;
+
+    // snapshot V is the state at the start of tick V + 1; the live store is the start of server_tick
+    uint32_t oldest = server_tick > STATE_HISTORY_TICKS ? server_tick - STATE_HISTORY_TICKS : 0;
+    uint32_t tick = view_tick == NO_BASELINE || view_tick >= server_tick ? server_tick : view_tick + 1;
+    if (tick < oldest) tick = oldest;
+    EntityStore const* store = nullptr;
+    for (;; ++tick) { // the oldest ticks may not have been saved
+        if (tick == server_tick) {
+            store = &entities;
+            break;
+        }
+        if (SavedState* saved = savedState(tick)) {
+            store = &saved->entities;
+            break;
+        }
+    }
+
+    // the live grid is from the start of the last tick, so even "now" gets its own build
+    if (rewind_grid_tick != tick || store == &entities) {
+        rewind_grid.Clear();
+        for (uint32_t i = 0; i < store->size(); ++i) {
+            rewind_grid.Insert(store->id[i], store->pos_x[i], store->pos_y[i], store->radius[i]);
+        }
+        rewind_grid.Build();
+        rewind_grid_tick = store == &entities ? NO_BASELINE : tick;
+    }
+
+    rewind_grid.QueryRadius(x, y, radius, out);
+    size_t n = 0;
+    for (uint32_t id : out) {
+        uint32_t j = store->find(id);
+        if (id == ignore_id || j == EntityStore::INVALID_INDEX || store->type[j] != EntityType::Character) continue;
+        if (!SpatialGrid::CheckCollision(x, y, radius, store->pos_x[j], store->pos_y[j], store->radius[j])) continue;
+        out[n++] = id;
+    }
+    out.resize(n);
+    return tick - 1;
+}
+
+void DemoServer::captureStateDigest(StateDigest& out) const {
+    out.capture(entities, server_tick > 0 ? server_tick - 1 : 0);
+}
+
+bool DemoServer::getEntityState(uint32_t entity_id, EntityState& out) const {
+    uint32_t i = entities.find(entity_id);
+    if (i == EntityStore::INVALID_INDEX) return false;
+    out = entities.get(i);
+    return true;
+}
+
+void DemoServer::drainInboundPackets() {
+    while (inbound_packets.try_pop(inbound_scratch)) {
+        handleClientInputPacket(inbound_scratch);
+    }
+    inbound_packets.publish();
+}
+
+int DemoServer::FindAbilityId(const char* name) {
+    AbilityId id = defs.findAbility(name);
+    return id == INVALID_DEF_ID ? -1 : id;
+}
+
+// script units: world units, seconds, raw damage / mana
+bool DemoServer::GetAbilityStat(int ability_id, int stat, float& out) {
+    if (ability_id < 0 || ability_id >= INVALID_DEF_ID) return false;
+    AbilityStats const* as = defs.ability(static_cast<AbilityId>(ability_id));
+    if (!as) return false;
+    switch (static_cast<AbilityStat>(stat)) {
+        case AbilityStat::Damage: out = static_cast<float>(as->damage); return true;
+        case AbilityStat::Speed: out = to_world(as->speed); return true;
+        case AbilityStat::Radius: out = to_world(as->radius); return true;
+        case AbilityStat::Lifetime:
+            out = as->lifetime_ticks < 0 ? -1.0f : static_cast<float>(as->lifetime_ticks) / SERVER_TICK_RATE;
+            return true;
+        case AbilityStat::Cooldown: out = static_cast<float>(as->cooldown_ticks) / SERVER_TICK_RATE; return true;
+        case AbilityStat::ManaCost: out = static_cast<float>(as->mana_cost); return true;
+        default: return false;
+    }
+}
+
+int DemoServer::FindBuffId(const char* name) {
+    BuffId id = defs.findBuff(name);
+    return id == INVALID_DEF_ID ? -1 : id;
+}
+
+// it = entities.find(id) which is key
+// second... = specific value
+// map has KEY -> VALUE
+
+bool DemoServer::GetPosition(int id, float &x, float &y) {
+    uint32_t i = entities.find(id);
+    if (i == EntityStore::INVALID_INDEX) return false;
+    x = to_world(entities.pos_x[i]);
+    y = to_world(entities.pos_y[i]);
+    return true;
+}
+
+bool DemoServer::SetMovement(int id, float vx, float vy) {
+    if (entities.find(id) == EntityStore::INVALID_INDEX) return false;
+    // world-units/sec to fixed-units/tick
+    float ticks_per_sec = (float)SERVER_TICK_RATE;
+    commands.setMovement(id, to_fixed(vx / ticks_per_sec), to_fixed(vy / ticks_per_sec));
+    return true;
+}
+
+bool DemoServer::ApplyDamage(int source_id, int target_id, int amount, const char* damage_type_str) {
+    if (entities.find(target_id) == EntityStore::INVALID_INDEX) return false;
+    commands.damage(source_id, target_id, amount, ParseDamageType(damage_type_str));
+    return true;
+}
+
+bool DemoServer::ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration) {
+    if (entities.find(target_id) == EntityStore::INVALID_INDEX) return false;
+
+    float ticks_per_sec = (float)SERVER_TICK_RATE;
+    
+    float len = std::sqrt(dir_x*dir_x + dir_y*dir_y);
+    if(len > 0) { dir_x /= len; dir_y /= len; }
+
+    int32_t fx = to_fixed((dir_x * force) / ticks_per_sec);
+    int32_t fy = to_fixed((dir_y * force) / ticks_per_sec);
+    (void)duration; // instant velocity change for now
+
+    commands.knockback(source_id, target_id, fx, fy);
+    return true;
+}
+
+uint32_t DemoServer::SpawnCharacter(float x, float y, uint8_t team) {
+    EntityState e;
+    e.id = entity_ids.allocate(EntityType::Character);
+    if (e.id == INVALID_ENTITY_ID) {
+        MOBA_LOG(Gameplay, Error, "Error: out of entity ids, character not spawned");
+        return INVALID_ENTITY_ID;
+    }
+    e.type = EntityType::Character;
+    e.pos_x = to_fixed(x);
+    e.pos_y = to_fixed(y);
+    e.vel_x = 0;
+    e.vel_y = 0;
+    CharacterStats const* hero = defs.character(default_character);
+    e.health = hero ? hero->hp : 650;
+    e.status_flags = 0;
+    e.radius = to_fixed(0.5f);
+    e.team = team;
+    entities.create(e);
+    cacheResists(entities.find(e.id));
+    grid_dirty = true;
+    return e.id;
+}
+
+int DemoServer::SpawnProjectile(int caster_id, float x, float y, float dx, float dy, float speed, float radius, float life_time) {
+    SpawnProjectileCommand proj;
+    proj.pos_x = to_fixed(x);
+    proj.pos_y = to_fixed(y);
+    
+    // Speed is units/sec
+    float ticks_per_sec = (float)SERVER_TICK_RATE;
+    float vel_per_tick = speed / ticks_per_sec;
+    
+    proj.vel_x = to_fixed(dx * vel_per_tick);
+    proj.vel_y = to_fixed(dy * vel_per_tick);
+    
+    proj.radius = to_fixed(radius);
+    proj.lifetime_ticks = life_time > 0 ? static_cast<int32_t>(life_time * ticks_per_sec) : -1;
+    proj.ability_id = casting_ability;
+
+    uint32_t id = entity_ids.allocate(EntityType::Projectile);
+    if (id == INVALID_ENTITY_ID) return -1;
+    commands.spawnProjectile(caster_id, id, proj);
+    return (int)id;
+}
+
+bool DemoServer::ApplyBuff(int source_id, int target_id, int buff_id) {
+    if (entities.find(target_id) == EntityStore::INVALID_INDEX || buff_id < 0 || buff_id >= INVALID_DEF_ID ||
+        !defs.buff(static_cast<BuffId>(buff_id))) {
+        return false;
+    }
+    commands.applyBuff(source_id, target_id, static_cast<BuffId>(buff_id));
+    return true;
+}
+
+bool DemoServer::RemoveBuff(int target_id, int buff_id) {
+    if (entities.find(target_id) == EntityStore::INVALID_INDEX || buff_id < 0 || buff_id >= INVALID_DEF_ID) return false;
+    commands.removeBuff(target_id, static_cast<BuffId>(buff_id));
+    return true;
+}
+
+void DemoServer::setSimulationPool(WorkStealingPool* pool, uint32_t min_chunk) {
+    sim_pool = pool;
+    sim_chunk = min_chunk > 0 ? min_chunk : 1;
+}
+
+template <class Fn>
+void DemoServer::forEachChunk(EntityStore::Range r, Fn&& fn) {
+    uint32_t n = r.end - r.begin;
+    size_t chunks = (n + sim_chunk - 1) / sim_chunk;
+    if (!sim_pool || chunks < 2) chunks = 1;
+    if (sim_scratch.size() < chunks) sim_scratch.resize(chunks);
+    for (auto& sc : sim_scratch) sc.hits.clear();
+
+    if (chunks == 1) {
+        fn(size_t(0), r);
+        return;
+    }
+    // which thread runs which chunk doesn't matter: every chunk writes only its own slice/scratch
+    sim_pool->parallelFor(chunks, [&](size_t c) {
+        uint32_t b = r.begin + static_cast<uint32_t>(c * n / chunks);
+        uint32_t e = r.begin + static_cast<uint32_t>((c + 1) * n / chunks);
+        fn(c, EntityStore::Range{ b, e });
+    });
+}
+
+void DemoServer::collectProjectileHits(uint32_t begin, uint32_t end, SimChunkScratch& scratch) const {
+    // Swept: a projectile covers the whole segment it moved this tick (integrate already ran,
+    // so it started at pos - vel), so a fast one can't tunnel through a character between two
+    // ticks. Characters are tested where they are now. The first one the projectile touches
+    // along the segment is hit; equal entry points go to the lowest ID.
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t proj_id = entities.id[i];
+        int32_t x1 = entities.pos_x[i], y1 = entities.pos_y[i];
+        int32_t x0 = x1 - entities.vel_x[i], y0 = y1 - entities.vel_y[i];
+        int32_t r = entities.radius[i];
+        grid.QuerySegment(x0, y0, x1, y1, r, scratch.query);
+
+        uint32_t hit_id = 0, hit_t = 0;
+        bool hit = false;
+        for (uint32_t other_id : scratch.query) {
+            if (other_id == proj_id) continue; // Skip self
+
+            uint32_t j = entities.find(other_id);
+            if (j == EntityStore::INVALID_INDEX || entities.type[j] != EntityType::Character) continue;
+            uint32_t t;
+            if (SpatialGrid::SweepCollision(x0, y0, x1, y1, r, entities.pos_x[j], entities.pos_y[j], entities.radius[j], t) &&
+                (!hit || t < hit_t)) { // ascending IDs: a tie keeps the lower one
+                hit = true;
+                hit_id = other_id;
+                hit_t = t;
+            }
+        }
+        if (hit) scratch.hits.push_back(ProjectileHit{ proj_id, hit_id, i }); // Hit only one target
+    }
+}
+
+TickResult DemoServer::tick() {
+    MOBA_PROFILE_BEGIN_TICK(profiler, server_tick);
+
+    // periodic keyframe: a replay can start here instead of at the beginning of the log
+    if (replay && server_tick % replay->keyframeInterval() == 0 && server_tick != keyframe_tick) {
+        saveKeyframe(keyframe_scratch);
+        replay->recordKeyframe(keyframe_scratch);
+        keyframe_tick = server_tick;
+    }
+    if (history_every_tick) SaveState();
+
+    // 1) spatial grid of the tick's starting positions: normally left by the previous tick
+    if (grid_dirty) {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Grid);
+        rebuildGrid();
+    }
+    // 2) gather all inputs for current tick for all clients and apply
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Input);
+        drainInboundPackets();
+        for (auto &kv : input_queues) { // kv = key-value || kv.first is key, kv.second is value
+            uint32_t client = kv.first;
+            InputQueue &q = kv.second;
+            InputSpan inputs = q.popForTick(server_tick);
+            // For demo: map client_id to entity_id directly (hardcode)
+            // client c controls entity 1000 + c when that is a character, else entity 1001
+            uint32_t ent_id = 1000 + client;
+            uint32_t i = entities.find(ent_id);
+            if (i == EntityStore::INVALID_INDEX || entities.type[i] != EntityType::Character) {
+                ent_id = 1001;
+                i = entities.find(ent_id);
+            }
+            client_net[client].controlled_entity = ent_id;
+            if (i != EntityStore::INVALID_INDEX && !inputs.empty()) {
+                applyInputsToEntity(entities, i, inputs, event_queue);
+            }
+        }
+    }
+
+    // 3) simulate physics & logic for all entities (per-entity independent: chunks can run in parallel)
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Simulate);
+        for (uint32_t t = 0; t < ENTITY_TYPE_COUNT; ++t) {
+            TickFn fn = entity_tick_table[t];
+            if (!fn) continue;
+            forEachChunk(entities.range(static_cast<EntityType>(t)), [this, fn](size_t, EntityStore::Range chunk) {
+                fn(entities, chunk);
+            });
+        }
+    }
+
+    // Projectile Collision Logic using Spatial Grid
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Collision);
+        // read-only gather (parallel when enabled), then one merge in a fixed order
+        EntityStore::Range projectiles = entities.range(EntityType::Projectile);
+        forEachChunk(projectiles, [this](size_t c, EntityStore::Range chunk) {
+            collectProjectileHits(chunk.begin, chunk.end, sim_scratch[c]);
+        });
+
+        hit_merge.clear();
+        for (auto const& sc : sim_scratch) hit_merge.insert(hit_merge.end(), sc.hits.begin(), sc.hits.end());
+        std::sort(hit_merge.begin(), hit_merge.end(), [](ProjectileHit const& a, ProjectileHit const& b) {
+            return a.projectile_id != b.projectile_id ? a.projectile_id < b.projectile_id : a.target_id < b.target_id;
+        });
+        for (ProjectileHit const& h : hit_merge) {
+            MOBA_LOG(Physics, Info, "Grid detected collision between Proj {} and Char {}", h.projectile_id, h.target_id);
+
+            // its ability's on_hit runs with the casts (processEvents)
+            EntityCold const& pc = entities.cold[h.projectile_index];
+            hit_events.push_back(HitEvent{ h.projectile_id, h.target_id, pc.caster_id, pc.ability_id });
+
+            entities.lifetime_ticks[h.projectile_index] = 0; // Destroy projectile
+        }
+
+        // destroyed in one batch at the end of the pass; their serials are free from the next spawn on
+        to_remove.clear();
+        for (uint32_t i = projectiles.begin; i < projectiles.end; ++i) {
+            if (entities.lifetime_ticks[i] <= 0) to_remove.push_back(entities.id[i]);
+        }
+        for (uint32_t id : to_remove) {
+            entities.destroy(id);
+            entity_ids.release(id, EntityType::Projectile);
+        }
+    }
+
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Buffs);
+        processBuffs();
+    }
+
+    // queued ability casts -> Lua, then every recorded command in one sorted pass, then the
+    // buff hooks of what that pass (and the expiries above) changed
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Events);
+        processEvents();
+        applyCommands();
+        flushBuffHooks();
+    }
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Grid);
+        rebuildGrid();
+    }
+
+    // 4) produce snapshot
+    TickResult result;
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Snapshot);
+
+        // one pass over the dense columns, goes out with every snapshot fragment of this tick
+        state_hash = computeStateHash(entities, server_tick);
+        result.server_tick = server_tick;
+        result.state_hash = state_hash;
+
+        // 5) keep the compact snapshot as a future delta baseline
+        snapshot_ring.capture(server_tick, entities, state_hash);
+        if (replay) replay->recordTickHash(server_tick, state_hash);
+    }
+    {
+        MOBA_PROFILE_PHASE(profiler, TickPhase::Interest);
+        updateInterest();
+    }
+
+    server_tick++;
+    return result;
+}
+
+void DemoServer::captureSnapshot(Snapshot& out) const {
+    out.server_tick = server_tick - 1;
+    out.state_hash = state_hash;
+    out.entities.resize(entities.size());
+    for (uint32_t i = 0; i < entities.size(); ++i) out.entities[i] = entities.get(i);
+}
+
+void DemoServer::rebuildGrid() {
+    grid.Clear();
+    for (uint32_t i = 0; i < entities.size(); ++i) {
+        grid.Insert(entities.id[i], entities.pos_x[i], entities.pos_y[i], entities.radius[i]);
+    }
+    grid.Build();
+    grid_dirty = false;
+}
+
+void DemoServer::updateInterest() {
+    if (interest.vision_radius <= 0) return;
+
+    uint32_t watched = 0;
+    for (auto& kv : client_net) {
+        ClientNetState& c = kv.second;
+        uint32_t i = c.controlled_entity ? entities.find(c.controlled_entity) : EntityStore::INVALID_INDEX;
+        uint8_t team = i != EntityStore::INVALID_INDEX ? entities.team[i] : TEAM_NEUTRAL;
+        if (team >= MAX_INTEREST_TEAMS) team = TEAM_NEUTRAL;
+        if (team != c.team) {
+            c.team = team;
+            c.acked_tick = NO_BASELINE; // its baseline was cut for another view
+        }
+        if (team != TEAM_NEUTRAL) watched |= 1u << team;
+    }
+    for (uint32_t t = 0; t < MAX_INTEREST_TEAMS; ++t) {
+        if (watched & (1u << t)) {
+            team_interest[t].update(server_tick, static_cast<uint8_t>(t), entities, grid, interest.vision_radius, interest_query);
+        }
+    }
+}
+
+void DemoServer::onSnapshotAck(uint32_t client_id, uint32_t tick) {
+    ClientNetState& c = client_net[client_id];
+    if (tick == NO_BASELINE) return;
+    if (c.acked_tick == NO_BASELINE || tick > c.acked_tick) c.acked_tick = tick;
+}
+
+void DemoServer::buildClientSnapshots(std::vector<ClientSnapshotRef>& out) {
+    MOBA_PROFILE_PHASE(profiler, TickPhase::Serialize);
+    out.clear();
+    for (PacketBuffer* b : outgoing_fragments) send_pool.release(b);
+    outgoing_fragments.clear();
+    shared_snapshots.clear();
+
+    SnapshotFrame const* cur = snapshot_ring.find(snapshot_ring.latest());
+    if (!cur) return;
+
+    for (auto const& kv : client_net) {
+        SnapshotFrame const* base = nullptr;
+        if (kv.second.acked_tick != NO_BASELINE) base = snapshot_ring.find(kv.second.acked_tick);
+
+        // a filtered client only ever gets its team's view, never the whole frame
+        SnapshotView view;
+        uint8_t team = interest.vision_radius > 0 ? kv.second.team : TEAM_NEUTRAL;
+        if (team != TEAM_NEUTRAL) {
+            view.cur = team_interest[team].visibleAt(cur->server_tick);
+            if (!view.cur) continue;
+            if (base) view.base = team_interest[team].visibleAt(base->server_tick);
+            if (!view.base) base = nullptr;
+        }
+        uint32_t base_tick = base ? base->server_tick : NO_BASELINE;
+
+        PacketBuffer* const* shared = nullptr;
+        for (auto const& sh : shared_snapshots) {
+            if (sh.baseline_tick == base_tick && sh.team == team) { shared = sh.fragment; break; }
+        }
+        if (shared) {
+            out.push_back(ClientSnapshotRef{ kv.first, base_tick, shared, 1 });
+            continue;
+        }
+
+        SnapshotFocus focus;
+        SnapshotFocus const* focus_ptr = nullptr;
+        uint32_t i = kv.second.controlled_entity ? entities.find(kv.second.controlled_entity) : EntityStore::INVALID_INDEX;
+        if (i != EntityStore::INVALID_INDEX) {
+            focus.x = entities.pos_x[i];
+            focus.y = entities.pos_y[i];
+            focus_ptr = &focus;
+        }
+
+        size_t first = outgoing_fragments.size();
+        if (!snapshot_builder.build(*cur, base, snapshot_quant, focus_ptr, send_pool, outgoing_fragments, view)) continue;
+
+        uint32_t count = static_cast<uint32_t>(outgoing_fragments.size() - first);
+        PacketBuffer* const* frags = outgoing_fragments.data() + first;
+        if (count == 1) shared_snapshots.push_back(SharedSnapshot{ base_tick, team, frags });
+        out.push_back(ClientSnapshotRef{ kv.first, base_tick, frags, count });
+    }
+}
+
+size_t DemoServer::sendClientSnapshots(UdpSocket& socket, std::vector<ClientSnapshotRef> const& refs) {
+    send_scratch.clear();
+    for (auto const& r : refs) {
+        auto it = client_net.find(r.client_id);
+        if (it == client_net.end() || it->second.endpoint.port == 0) continue;
+        for (uint32_t k = 0; k < r.fragment_count; ++k) {
+            send_scratch.push_back(OutgoingDatagram{ r.fragments[k], it->second.endpoint });
+        }
+    }
+    return socket.sendBatch(send_scratch.data(), send_scratch.size());
+}
@@ -0,0 +1,459 @@
+#pragma once
+// DemoServer: one self-contained match (entities, grid, Lua VM, snapshots, client state).
+// Nothing in here is process-global, so a process can run many of them side by side
+// (see match_host.h); each one must only be ticked by one thread at a time.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "net/packets.h"
+#include "net/packet_pool.h"
+#include "net/snapshot_builder.h"
+#include "net/socket_udp.h"
+#include "client_input.h"
+#include "command_buffer.h"
+#include "entity.h"
+#include "game_defs.h"
+#include "input_queue.h"
+#include "interest.h"
+#include "lua_bridge.h"
+#include "mpsc_queue.h"
+#include "physics.h"
+#include "snapshot.h"
+#include "state_hash.h"
+#include "tick_profiler.h"
+#include "timer_wheel.h"
+
+// ---------- Config ----------
+constexpr int SERVER_TICK_RATE = 30; // 30t/s
+constexpr uint64_t TICK_NS = 1000000000ull / SERVER_TICK_RATE; // 33,333,333 ns (approx)
+constexpr int32_t POS_SCALE = 1000; // fixed-point scale: 1.0 world unit = 1000 units
+
+// ---------- Fixed-point helpers ----------
+inline int32_t to_fixed(float world_units) {
+    return static_cast<int32_t>(world_units * POS_SCALE);
+}
+inline float to_world(int32_t fixed) {
+    return static_cast<float>(fixed) / POS_SCALE;
+}
+
+// ---------- Input ingestion ----------
+// Network threads hand ClientInputPackets to the tick thread through a bounded lock-free queue.
+// Counters are plain snapshots of the atomics in DemoServer, safe to read from any thread.
+constexpr size_t INBOUND_PACKET_QUEUE = 256; // packets buffered between socket receive and tick()
+constexpr size_t SEND_POOL_PACKETS = 512;   // MTU-sized send buffers shared by all clients
+
+// ---------- Lua VM ----------
+constexpr uint64_t LUA_GC_BUDGET_NS = 2000000;   // slack a tick must leave before a GC step runs (2 ms)
+constexpr size_t LUA_VM_LIMIT_BYTES = 64u << 20; // per match
+
+struct IngestStats {
+    uint64_t packets_queued = 0;
+    uint64_t packets_dropped_full = 0; // inbound packet queue was full
+    uint64_t inputs_accepted = 0;
+    uint64_t inputs_duplicate = 0;     // redundant resends (normal)
+    uint64_t inputs_stale = 0;         // arrived after their tick was simulated
+    uint64_t inputs_dropped_full = 0;  // per-client InputQueue slot full or too far ahead
+};
+
+// Client-reported state hashes (ClientInputPacket::hashTick/stateHash) checked against ours
+struct DesyncStats {
+    uint64_t reports = 0;
+    uint64_t mismatches = 0;
+    uint64_t unverified = 0;           // reported tick already left the snapshot ring
+    uint32_t first_mismatch_tick = NO_BASELINE;
+    uint32_t first_mismatch_client = 0;
+};
+
+// ---------- Per-client snapshot state ----------
+struct ClientNetState {
+    uint32_t acked_tick = NO_BASELINE; // newest snapshot tick the client confirmed
+    uint32_t controlled_entity = 0;    // snapshot priority is centred on it (0 = none)
+    UdpEndpoint endpoint;              // port 0 = no remote address (in-process client)
+    uint32_t desync_tick = NO_BASELINE; // first tick this client reported a different state hash
+    uint8_t team = TEAM_NEUTRAL;        // controlled_entity's team, whose view it gets (neutral: everything)
+};
+
+// One encoded snapshot for one client: `fragment_count` MTU-sized datagrams in pooled buffers.
+// A single-fragment snapshot is shared by every client on the same baseline.
+// Buffers stay valid until the next buildClientSnapshots() call.
+struct ClientSnapshotRef {
+    uint32_t client_id;
+    uint32_t baseline_tick; // NO_BASELINE when encoded against nothing
+    PacketBuffer* const* fragments;
+    uint32_t fragment_count;
+
+    size_t bytes() const {
+        size_t n = 0;
+        for (uint32_t k = 0; k < fragment_count; ++k) n += fragments[k]->size;
+        return n;
+    }
+};
+
+// ---------- Parallel tick ----------
+constexpr uint32_t SIM_CHUNK_ENTITIES = 1024; // smallest slice of a partition one worker gets
+
+// Narrow-phase result, gathered per chunk and merged in (projectile_id, target_id) order
+struct ProjectileHit {
+    uint32_t projectile_id;
+    uint32_t target_id;
+    uint32_t projectile_index; // dense index at gather time (no entity is created/destroyed before the merge)
+};
+
+// A merged hit waiting for processEvents(): the projectile is gone by then, so its ability comes along
+struct HitEvent {
+    uint32_t projectile_id;
+    uint32_t target_id;
+    uint32_t caster_id;  // the damage source, whichever path applies it
+    uint16_t ability_id; // AbilityId that spawned the projectile (INVALID_DEF_ID = none)
+};
+
+class WorkStealingPool;
+class ReplayRecorder;
+class HotReloadWatcher;
+
+// What tick() returns
+struct TickResult {
+    uint32_t server_tick = 0; // the tick just simulated
+    uint64_t state_hash = 0;  // computeStateHash() after it (state_hash.h)
+};
+
+// ---------- Event System ----------
+enum class SimEventType {
+    CastAbility
+};
+
+struct SimEvent {
+    SimEventType type;
+    uint32_t caster_id;
+    uint16_t ability_id; // game_defs AbilityId; processEvents() maps it to its script (ability_scripts)
+    int32_t target_x;
+    int32_t target_y;
+};
+
+// ---------- Buffs ----------
+// Every live buff has its timers (expiry, next periodic effect) in a timer wheel, so a tick
+// only looks at the buffs due on it. Timers are never cancelled: one fires only if its buff
+// is still on the entity as scheduled (same source and applied tick, an expiry also the same
+// expire_tick), so a refresh or removal just leaves a stale timer behind. That also makes the
+// wheel derivable from the entities alone: rollback and keyframes rebuild it instead of saving it.
+enum class BuffTimerKind : uint8_t {
+    Period, // sorts first: a period due on the expiry tick still runs
+    Expire
+};
+
+struct BuffTimer {
+    uint32_t entity_id;
+    uint32_t source_id;
+    uint32_t applied_tick;
+    BuffId buff_id;
+    BuffTimerKind kind;
+};
+
+// An on_apply/on_expire call collected during the tick (flushed once per script and hook)
+struct BuffHookCall {
+    AbilityHandle script;
+    BuffHook hook;
+    BuffHookRequest request;
+};
+
+// ---------- Rollback ----------
+// The state between two ticks, as SaveState() keeps it for RestoreState() and lag compensation.
+// Saving copy-assigns the SoA columns into vectors that already have the capacity, so once the
+// ring is warm a save is a memcpy of every column and never allocates. Input queues aren't
+// copied: restoring rewinds them (InputQueue::rewind), which keeps inputs that arrived later.
+constexpr uint32_t STATE_HISTORY_TICKS = 16; // ~0.5 s at 30 t/s: rewind and resimulate window
+static_assert(STATE_HISTORY_TICKS <= INPUT_WINDOW_TICKS, "a rollback must not outrun the input rings");
+
+struct SavedState {
+    uint32_t tick = NO_BASELINE; // the next tick to simulate (NO_BASELINE = empty slot)
+    EntityIdAllocator entity_ids;
+    uint64_t state_hash = 0;     // of the tick before, what stateHash() returned
+    EntityStore entities;
+    std::vector<GameCommand> commands;
+    std::vector<SimEvent> events;
+};
+
+class DemoServer : public ScriptHost {
+private:
+    LuaBridge luaBridge{this}; // this match's VM, bindings call back into this DemoServer
+    using TickFn = void(*)(EntityStore&, EntityStore::Range);
+
+    uint32_t server_tick;
+    EntityIdAllocator entity_ids{1001}; // serials from 1001, recycled per type once their entity is gone
+    EntityStore entities; // dense SoA columns, O(1) lookup by ID
+    TickFn entity_tick_table[ENTITY_TYPE_COUNT] = {}; // indexed by EntityType
+    std::unordered_map<uint32_t, InputQueue> input_queues; // tick thread only (can rehash)
+    BoundedMpscQueue<ClientInputPacket, INBOUND_PACKET_QUEUE> inbound_packets; // any thread -> tick thread
+    struct {
+        std::atomic<uint64_t> packets_queued{0};
+        std::atomic<uint64_t> packets_dropped_full{0};
+        std::atomic<uint64_t> inputs_accepted{0};
+        std::atomic<uint64_t> inputs_duplicate{0};
+        std::atomic<uint64_t> inputs_stale{0};
+        std::atomic<uint64_t> inputs_dropped_full{0};
+    } ingest;
+    std::vector<SimEvent> event_queue;
+    CommandBuffer commands; // gameplay mutations from Lua/collision, applied once per tick (applyCommands)
+    DamageBatch damage_batch; // the pass's damage instances, resolved in bulk after it (resolveDamage)
+    std::vector<CastRequest> cast_batch; // processEvents scratch
+    std::vector<HitEvent> hit_events;    // this tick's projectile hits, dispatched by processEvents
+    std::vector<HitRequest> hit_batch;   // processEvents scratch
+    AbilityId casting_ability = INVALID_DEF_ID; // whose cast/on_hit runs now: projectiles it spawns belong to it
+    SnapshotRing snapshot_ring; // last SNAPSHOT_RING_SIZE authoritative snapshots (delta baselines)
+    SnapshotQuantization snapshot_quant; // per-field wire precision for deltas
+    std::unordered_map<uint32_t, ClientNetState> client_net;
+    PacketPool send_pool{SEND_POOL_PACKETS};
+    SnapshotPacketBuilder snapshot_builder;
+    std::vector<PacketBuffer*> outgoing_fragments; // in flight until the next buildClientSnapshots()
+    struct SharedSnapshot {
+        uint32_t baseline_tick;
+        uint8_t team; // whose view (TEAM_NEUTRAL: unfiltered)
+        PacketBuffer* const* fragment;
+    };
+    std::vector<SharedSnapshot> shared_snapshots; // single-fragment encodes, one per distinct baseline and view
+    std::vector<OutgoingDatagram> send_scratch;
+    GameDefs defs;                                   // compiled game_defs (blob), see LoadGameDefs()
+    std::string game_dir;                            // from the constructor, empty = search
+    std::string defs_dir;                            // the data dir, see resolveDataDir()
+    std::string defs_blob;                           // compiled game_defs (<defs_dir>/game_defs.bin or the build tree's)
+    std::string scripts_root;                        // <defs_dir>/scripts/
+    std::unique_ptr<HotReloadWatcher> hot_reload;    // see enableHotReload()
+    std::vector<AbilityHandle> ability_scripts;      // Lua script per AbilityId (INVALID_ABILITY = none)
+    std::vector<AbilityHandle> buff_scripts;         // on_apply/on_expire owner per BuffId
+    TimerWheel<BuffTimer> buff_wheel;                // expiries and periods of every live buff
+    std::vector<BuffTimer> buff_due;                 // processBuffs scratch
+    std::vector<BuffHookCall> buff_hooks;            // this tick's hook calls, see flushBuffHooks()
+    std::vector<BuffHookRequest> buff_hook_batch;
+    CharacterId default_character = INVALID_DEF_ID;   // stats behind the spawned character (hero_test)
+    SpatialGrid grid;      // built at the end of every tick: interest now, collision next tick
+    bool grid_dirty = true; // entities changed outside tick() (setup, keyframe, rollback)
+    InterestConfig interest; // from map data, see LoadMapDefs()
+    TeamInterest team_interest[MAX_INTEREST_TEAMS];
+    std::vector<uint32_t> interest_query;
+    WorkStealingPool* sim_pool = nullptr; // opt-in parallel tick, see setSimulationPool()
+    uint32_t sim_chunk = SIM_CHUNK_ENTITIES;
+    struct SimChunkScratch {
+        std::vector<uint32_t> query;      // broad-phase result buffer
+        std::vector<ProjectileHit> hits;
+    };
+    std::vector<SimChunkScratch> sim_scratch; // one per chunk, reused every tick
+    std::vector<ProjectileHit> hit_merge;
+    std::vector<uint32_t> to_remove;
+    uint64_t state_hash = 0;              // of the last completed tick, see state_hash.h
+    ReplayRecorder* replay = nullptr;     // optional input log, see setReplayRecorder()
+    std::vector<uint8_t> keyframe_scratch;
+    uint32_t keyframe_tick = NO_BASELINE; // tick of the last keyframe written
+    std::vector<SavedState> history; // STATE_HISTORY_TICKS slots by tick (empty = not saving)
+    bool history_every_tick = false; // SaveState() at the start of every tick()
+    SpatialGrid rewind_grid;         // built from a saved state by LagCompensatedQuery()
+    uint32_t rewind_grid_tick = NO_BASELINE;
+    DesyncStats desync;
+    ClientInputPacket inbound_scratch;  // drain target for inbound_packets
+    TickProfiler profiler{TICK_NS};     // per-phase timings, see tick_profiler.h
+
+public:
+    // `game_dir` holds game_defs.*, map_defs.json and scripts/ (ending in '/'); empty = the
+    // source tree's game/ (CMake MOBA_GAME_DIR), else game/ or ../../../game/ next to the binary
+    explicit DemoServer(std::string game_dir = "");
+    ~DemoServer() override;
+
+    DemoServer(DemoServer const&) = delete;
+    DemoServer& operator=(DemoServer const&) = delete;
+
+    // Maps the data dir's game_defs.bin (falls back to compiling game_defs.json) before any script
+    // loads, so scripts can resolve their ability names at load time
+    void LoadGameDefs();
+
+    // Grid geometry comes from map data (<data dir>/map_defs.json), not from compile-time constants
+    void LoadMapDefs(const std::string& map_id = "");
+
+    // The tick's projectile hits go to the on_hit of the ability that spawned each projectile
+    // (its damage stat when the script has none), then casts are grouped by ability (stable,
+    // so input order is kept within a group) and every ability's handler runs once per tick
+    // over its whole batch. Scripts only record commands.
+    void processEvents();
+
+    // Apply everything recorded this tick (Lua bindings, collision hits, calls between ticks)
+    void applyCommands();
+
+    // Buff timers due this tick: periodic effects record their damage, expiries take the buff
+    // off and recompute status_flags from what is left. Runs before processEvents().
+    void processBuffs();
+    // The tick's on_apply/on_expire hooks, one Lua call per script and hook; what they record
+    // is applied next tick
+    void flushBuffHooks();
+
+    void SimInit();
+
+    // Thread-safe entry point for the UDP receive thread(s). Never blocks; the packet is
+    // applied at the start of the next tick(). Returns false (and counts a drop) when the queue is full.
+    bool enqueueClientInputPacket(const ClientInputPacket& pkt);
+
+    // Tick thread only. Call flush() first to include the tick in progress.
+    TickProfiler& getProfiler() { return profiler; }
+
+    // Tick thread, after the tick's snapshots went out: housekeeping that must not run inside
+    // tick() (Lua GC) gets the time left until `deadline`, the start of the next tick.
+    void runIdleWork(std::chrono::steady_clock::time_point deadline);
+
+    // Development: watch the scripts and game_defs for edits (hot_reload.h) and swap them in
+    // from runIdleWork(), between ticks. Off by default; a replay log doesn't capture reloads.
+    void enableHotReload(bool on = true);
+
+    LuaVmStats getLuaStats() const { return luaBridge.vmStats(); }
+
+    IngestStats getIngestStats() const;
+
+    // Tick thread only (touches input_queues directly)
+    bool receiveInput(ClientInput const& in);
+
+    // Tick thread only
+    void handleClientInputPacket(const ClientInputPacket& pkt);
+
+    // Tick thread: compare a client's hash for `tick` with ours (low 32 bits). Returns false on a
+    // mismatch; the first one per client is logged and kept in ClientNetState::desync_tick.
+    bool checkClientStateHash(uint32_t client_id, uint32_t tick, uint32_t client_hash);
+    DesyncStats const& getDesyncStats() const { return desync; }
+
+    // Tick thread, between ticks. Every accepted input, every tick's state hash and a keyframe
+    // every keyframeInterval() ticks go to `recorder` (nullptr stops recording). Not owned.
+    // Attaching writes a keyframe and the inputs already queued, so the log replays from here.
+    void setReplayRecorder(ReplayRecorder* recorder);
+
+    // Full match state between ticks (entities, next id, pending commands and casts) as one
+    // opaque blob (replay.h ReplayKeyframeHeader). Loading drops queued inputs: the caller
+    // re-feeds them from its log. Lua globals aren't included: scripts keep no state between
+    // calls, everything they do goes through commands. False on a malformed or mismatching blob.
+    void saveKeyframe(std::vector<uint8_t>& out) const;
+    bool loadKeyframe(const uint8_t* data, size_t size);
+    uint32_t currentTick() const { return server_tick; }
+    // Tick thread, between ticks: the live columns, read-only (engine_api.h publishes them)
+    EntityStore const& entityStore() const { return entities; }
+
+    // Rollback (tick thread, between ticks). SaveState() keeps the state at currentTick() in a
+    // ring of the last STATE_HISTORY_TICKS ticks; RestoreState(t) puts the match back to the
+    // start of tick t so tick() can resimulate from there, e.g. after a late input for t or,
+    // client side, an authoritative snapshot that disagrees with the prediction. Queued inputs
+    // for t and later are kept. Lua has no per-entity state to save (see saveKeyframe()).
+    // RestoreState is false when t isn't in the ring or a replay is being recorded.
+    void SaveState();
+    bool RestoreState(uint32_t tick);
+    // Save at the start of every tick (what rollback and lag compensation need)
+    void setStateHistory(bool every_tick);
+
+    // Lag compensation: the characters a hit circle overlaps in the world the shooter saw,
+    // i.e. after snapshot `view_tick`, clamped to the oldest saved tick. Ascending ids into
+    // `out` (reused). The grid is rebuilt only when the rewound tick changes. Returns the
+    // snapshot tick the query ran against (NO_BASELINE: nothing saved).
+    uint32_t LagCompensatedQuery(uint32_t view_tick, int32_t x, int32_t y, int32_t radius, uint32_t ignore_id,
+                                 std::vector<uint32_t>& out);
+
+    // State hash of the last completed tick (the one tick() just returned)
+    uint64_t stateHash() const { return state_hash; }
+    // Per-entity hashes of the current state, for finding the first differing entity
+    void captureStateDigest(StateDigest& out) const;
+    bool getEntityState(uint32_t entity_id, EntityState& out) const;
+
+    // Tick thread: move everything the network threads queued into the per-client InputQueues
+    void drainInboundPackets();
+
+    // Gameplay API (ScriptHost: what this match's Lua bindings call)
+
+    GameDefs const& gameDefs() const { return defs; }
+
+    int FindAbilityId(const char* name) override;
+    bool GetAbilityStat(int ability_id, int stat, float& out) override;
+    int FindBuffId(const char* name) override;
+
+    bool GetPosition(int id, float &x, float &y) override;
+
+    // Tick thread, between ticks (match setup, benchmarks): a character with the default hero
+    // def, created right away rather than recorded. Client c steers entity 1000 + c.
+    uint32_t SpawnCharacter(float x, float y, uint8_t team = 0);
+
+    // The mutating calls below only record commands (applied by applyCommands() at the end
+    // of the tick), so they are safe from inside any loop over `entities`.
+    bool SetMovement(int id, float vx, float vy) override;
+    bool ApplyDamage(int source_id, int target_id, int amount, const char* damage_type_str) override;
+    bool ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration) override;
+    // The id is reserved now (deterministic: record order), the entity exists after applyCommands()
+    int SpawnProjectile(int caster_id, float x, float y, float dx, float dy, float speed, float radius, float life_time) override;
+    bool ApplyBuff(int source_id, int target_id, int buff_id) override;
+    bool RemoveBuff(int target_id, int buff_id) override;
+
+    // Run single tick. Only the tick and its hash come back: the networked view is the
+    // snapshot ring (buildClientSnapshots), an AoS copy is captureSnapshot()'s, on request.
+    TickResult tick();
+    // Every entity as of the last completed tick, in dense order (demo printout, serializeFull).
+    // Reuses `out`'s capacity.
+    void captureSnapshot(Snapshot& out) const;
+
+    // Client confirmed it received snapshot `tick`. Older/unknown acks are ignored.
+    void onSnapshotAck(uint32_t client_id, uint32_t tick);
+
+    // Encode the latest snapshot for every client against its own acked baseline, straight into
+    // pooled MTU-sized datagrams (nearest entities first when it takes more than one).
+    // A baseline that fell out of the ring (or was never acked) degrades to a full send.
+    // With interest management a client only gets its team's view (enters go out in full,
+    // leaves as removals). Clients on the same baseline and view share a single-fragment encode. A client whose snapshot
+    // can't get buffers this tick is skipped and stays on its older baseline.
+    void buildClientSnapshots(std::vector<ClientSnapshotRef>& out);
+
+    // Interest management (interest.h): with a vision radius > 0 every client with a controlled
+    // entity only gets its team's view. The map's "vision" entry sets it at load.
+    void setInterest(InterestConfig const& cfg) { interest = cfg; }
+    InterestConfig const& getInterest() const { return interest; }
+    // `team`'s visible set after the last tick plus what entered/left it (nullptr: not tracked)
+    TeamInterest const* teamInterest(uint8_t team) const {
+        return team < MAX_INTEREST_TEAMS ? &team_interest[team] : nullptr;
+    }
+
+    // Opt-in parallel tick: integration and the projectile narrow phase run in chunks of at least
+    // `min_chunk` entities on `pool` (nullptr = everything on the calling thread). Hits are merged
+    // in (projectile, target) order either way, so the result is bit-identical to one thread.
+    // `pool` must not be the pool this match is ticked on (parallelFor doesn't nest).
+    void setSimulationPool(WorkStealingPool* pool, uint32_t min_chunk = SIM_CHUNK_ENTITIES);
+
+    // Hand every built fragment to the socket in one batch (the kernel reads the pooled buffers
+    // directly). Clients without a remote endpoint are skipped. Returns datagrams accepted.
+    size_t sendClientSnapshots(UdpSocket& socket, std::vector<ClientSnapshotRef> const& refs);
+
+
+private:
+    InputQueue& queueFor(uint32_t client_id);
+    void recordAccepted(ClientInput const& in);
+    SavedState* savedState(uint32_t tick);
+    void rebuildGrid();
+    // script handles per ability/buff and the ids the engine uses itself, from the current defs
+    void bindDefScripts();
+    // game_dir, or where the defs are found (constructor): defs_dir, defs_blob, scripts_root
+    void resolveDataDir();
+    // the watcher's waiting batch: defs first (scripts rerun so their load time lookups see the
+    // new ids), then the edited scripts
+    void applyHotReload();
+    // every damage instance the command pass gathered: resist-scaled in one loop, one clamp per target
+    void resolveDamage();
+    // armor/MR from the entity's character def into its cold column (spawn, keyframe load)
+    void cacheResists(uint32_t i);
+    // buff commands (applyCommands), entity at dense index i
+    void applyBuff(uint32_t i, uint32_t source_id, BuffId buff_id);
+    void removeBuff(uint32_t i, uint32_t slot);
+    void recomputeStatus(uint32_t i);
+    // timers for `b` on `entity_id` that are due at `from` or later
+    void scheduleBuff(uint32_t entity_id, ActiveBuff const& b, uint32_t from);
+    // the wheel from scratch, for timers due from server_tick on (keyframe load, rollback)
+    void rebuildBuffTimers();
+    // visible sets for every team a client plays on (after the tick, before snapshots go out)
+    void updateInterest();
+
+    // fn(chunk, range) for every chunk of `r`, on sim_pool when there is more than one
+    template <class Fn> void forEachChunk(EntityStore::Range r, Fn&& fn);
+    // read-only narrow phase for projectiles [begin, end): first character each one touches
+    void collectProjectileHits(uint32_t begin, uint32_t end, SimChunkScratch& scratch) const;
+};
@@ -0,0 +1,266 @@
+#include "engine_api.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "engine.h"
+#include "log.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(MobaSimStateHeader) == 128, "MobaSimStateHeader is part of the ABI");
+static_assert(sizeof(MobaSimInput) == 24, "MobaSimInput is part of the ABI");
+static_assert(sizeof(EntityType) == 1, "the type column is uint8_t");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the seqlock is a plain uint32_t in the header");
+
+namespace {
+
+constexpr size_t COLUMN_ALIGN = 64;                      // every column starts on its own cache line
+constexpr uint32_t MAX_ENTITIES = ENTITY_SERIAL_MASK + 1; // more rows than IDs can't fill, and total_bytes stays 32-bit
+
+size_t alignColumn(size_t at) { return (at + COLUMN_ALIGN - 1) & ~(COLUMN_ALIGN - 1); }
+
+// The state region: a named shared memory object or private memory
+struct StateRegion {
+    void* base = nullptr;
+    size_t bytes = 0;
+    std::string name; // empty = private
+#if defined(_WIN32)
+    HANDLE mapping = nullptr;
+#endif
+
+    bool create(std::string const& shm_name, size_t size) {
+        bytes = size;
+        name = shm_name;
+        if (name.empty()) {
+            base = std::calloc(1, bytes);
+            return base != nullptr;
+        }
+#if defined(_WIN32)
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(bytes), name.c_str());
+        if (!mapping) return false;
+        base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if (!base) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+#else
+        if (name[0] != '/') name.insert(name.begin(), '/'); // shm_open wants "/name"
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd); // the mapping keeps the object
+        if (p == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return false;
+        }
+        base = p;
+#endif
+        std::memset(base, 0, bytes); // an object left by an earlier run
+        return true;
+    }
+
+    void destroy() {
+        if (!base) return;
+        if (name.empty()) {
+            std::free(base);
+        } else {
+#if defined(_WIN32)
+            UnmapViewOfFile(base);
+            CloseHandle(mapping);
+            mapping = nullptr;
+#else
+            munmap(base, bytes);
+            shm_unlink(name.c_str()); // readers that still map it keep their pages
+#endif
+        }
+        base = nullptr;
+    }
+};
+
+} // namespace
+
+struct MobaSim {
+    DemoServer server;
+    std::unordered_map<uint32_t, uint32_t> input_seq; // per client, the last sequence number handed out
+    StateRegion region;
+
+    explicit MobaSim(std::string game_dir) : server(std::move(game_dir)) {}
+    ~MobaSim() { region.destroy(); }
+
+    MobaSimStateHeader* header() { return static_cast<MobaSimStateHeader*>(region.base); }
+
+    template <typename T>
+    T* column(uint32_t offset) { return reinterpret_cast<T*>(static_cast<uint8_t*>(region.base) + offset); }
+
+    bool createRegion(std::string const& shm_name, uint32_t capacity) {
+        MobaSimStateHeader h = {};
+        h.magic = MOBA_SIM_STATE_MAGIC;
+        h.version = MOBA_SIM_API_VERSION;
+        h.header_bytes = sizeof(MobaSimStateHeader);
+        h.capacity = capacity;
+        h.pos_scale = static_cast<uint32_t>(POS_SCALE);
+        h.tick_rate = static_cast<uint32_t>(SERVER_TICK_RATE);
+
+        size_t at = alignColumn(sizeof(MobaSimStateHeader));
+        auto place = [&](uint32_t& offset, size_t element_bytes) {
+            offset = static_cast<uint32_t>(at);
+            at = alignColumn(at + element_bytes * capacity);
+        };
+        place(h.id_offset, sizeof(uint32_t));
+        place(h.type_offset, sizeof(uint8_t));
+        place(h.team_offset, sizeof(uint8_t));
+        place(h.pos_x_offset, sizeof(int32_t));
+        place(h.pos_y_offset, sizeof(int32_t));
+        place(h.vel_x_offset, sizeof(int32_t));
+        place(h.vel_y_offset, sizeof(int32_t));
+        place(h.radius_offset, sizeof(int32_t));
+        place(h.lifetime_offset, sizeof(int32_t));
+        place(h.health_offset, sizeof(int32_t));
+        place(h.status_offset, sizeof(uint16_t));
+        h.total_bytes = static_cast<uint32_t>(at);
+
+        if (!region.create(shm_name, at)) return false;
+        std::memcpy(region.base, &h, sizeof(h));
+        return true;
+    }
+
+    // The engine's columns into the region, under the seqlock
+    void publish() {
+        MobaSimStateHeader* h = header();
+        auto* sequence = reinterpret_cast<std::atomic<uint32_t>*>(&h->sequence);
+        sequence->store(sequence->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); // odd: writing
+        std::atomic_thread_fence(std::memory_order_release);
+
+        EntityStore const& es = server.entityStore();
+        uint32_t n = static_cast<uint32_t>(std::min<size_t>(es.size(), h->capacity)); // dense order is already characters, then projectiles
+        std::memcpy(column<uint32_t>(h->id_offset), es.id.data(), n * sizeof(uint32_t));
+        std::memcpy(column<uint8_t>(h->type_offset), es.type.data(), n * sizeof(uint8_t));
+        std::memcpy(column<uint8_t>(h->team_offset), es.team.data(), n * sizeof(uint8_t));
+        std::memcpy(column<int32_t>(h->pos_x_offset), es.pos_x.data(), n * sizeof(int32_t));
+        std::memcpy(column<int32_t>(h->pos_y_offset), es.pos_y.data(), n * sizeof(int32_t));
+        std::memcpy(column<int32_t>(h->vel_x_offset), es.vel_x.data(), n * sizeof(int32_t));
+        std::memcpy(column<int32_t>(h->vel_y_offset), es.vel_y.data(), n * sizeof(int32_t));
+        std::memcpy(column<int32_t>(h->radius_offset), es.radius.data(), n * sizeof(int32_t));
+        std::memcpy(column<int32_t>(h->lifetime_offset), es.lifetime_ticks.data(), n * sizeof(int32_t));
+        int32_t* health = column<int32_t>(h->health_offset);
+        uint16_t* status = column<uint16_t>(h->status_offset);
+        for (uint32_t i = 0; i < n; ++i) {
+            health[i] = es.cold[i].health;
+            status[i] = es.cold[i].status_flags;
+        }
+        h->count = n;
+        h->dropped = static_cast<uint32_t>(es.size() - n);
+        h->tick = server.currentTick();
+        h->state_hash = server.stateHash();
+
+        std::atomic_thread_fence(std::memory_order_release);
+        sequence->store(sequence->load(std::memory_order_relaxed) + 1, std::memory_order_release); // even: done
+    }
+};
+
+extern "C" {
+
+MOBA_API MobaSim* sim_create(const MobaSimConfig* config) {
+    MobaSimConfig defaults = {};
+    defaults.api_version = MOBA_SIM_API_VERSION;
+    MobaSimConfig const& c = config ? *config : defaults;
+    if (c.api_version != MOBA_SIM_API_VERSION) {
+        MOBA_LOG(App, Error, "sim_create: api_version {} (this library is {})", c.api_version, MOBA_SIM_API_VERSION);
+        return nullptr;
+    }
+    uint32_t capacity = c.max_entities ? std::min(c.max_entities, MAX_ENTITIES) : MOBA_SIM_DEFAULT_ENTITIES;
+    if (c.quiet) Log::setLevel(LogLevel::Warn);
+
+    try {
+        auto sim = std::make_unique<MobaSim>(c.game_dir ? c.game_dir : "");
+        if (!sim->createRegion(c.shm_name ? c.shm_name : "", capacity)) {
+            MOBA_LOG(App, Error, "sim_create: cannot create the state region '{}'", c.shm_name ? c.shm_name : "");
+            return nullptr;
+        }
+        sim->publish();
+        return sim.release();
+    } catch (std::exception const& e) {
+        MOBA_LOG(App, Error, "sim_create: {}", e.what());
+    } catch (...) {
+        MOBA_LOG(App, Error, "sim_create: unknown exception");
+    }
+    return nullptr;
+}
+
+MOBA_API void sim_destroy(MobaSim* sim) {
+    delete sim;
+}
+
+MOBA_API uint32_t sim_spawn_character(MobaSim* sim, int32_t x, int32_t y, uint8_t team) {
+    if (!sim) return INVALID_ENTITY_ID;
+    try {
+        uint32_t id = sim->server.SpawnCharacter(static_cast<float>(x) / POS_SCALE, static_cast<float>(y) / POS_SCALE, team);
+        sim->publish();
+        return id;
+    } catch (...) {
+        return INVALID_ENTITY_ID;
+    }
+}
+
+MOBA_API int sim_push_input(MobaSim* sim, const MobaSimInput* input) {
+    if (!sim || !input) return MOBA_SIM_INVALID_ARGUMENT;
+    ClientInput in;
+    in.client_id = input->client_id;
+    in.input_seq = ++sim->input_seq[input->client_id];
+    in.target_tick = input->target_tick == MOBA_SIM_NOW ? sim->server.currentTick() : input->target_tick;
+    in.move_dx = input->move_dx;
+    in.move_dy = input->move_dy;
+    in.action_flags = input->action_flags;
+    in.ability_id = input->ability_id;
+    in.target_x = input->target_x;
+    in.target_y = input->target_y;
+    try {
+        return sim->server.receiveInput(in) ? MOBA_SIM_OK : MOBA_SIM_INPUT_REJECTED;
+    } catch (...) {
+        return MOBA_SIM_INPUT_REJECTED;
+    }
+}
+
+MOBA_API uint32_t sim_step(MobaSim* sim, uint32_t ticks) {
+    if (!sim) return 0;
+    try {
+        for (uint32_t i = 0; i < ticks; ++i) {
+            sim->server.tick();
+            // unpaced, so no slack: only the collection the Lua heap forces
+            sim->server.runIdleWork(std::chrono::steady_clock::now());
+        }
+    } catch (std::exception const& e) {
+        MOBA_LOG(App, Error, "sim_step: {}", e.what());
+    } catch (...) {
+        MOBA_LOG(App, Error, "sim_step: unknown exception");
+    }
+    sim->publish();
+    return sim->server.currentTick();
+}
+
+MOBA_API const MobaSimStateHeader* sim_read_state(const MobaSim* sim) {
+    return sim ? static_cast<const MobaSimStateHeader*>(sim->region.base) : nullptr;
+}
+
+} // extern "C"
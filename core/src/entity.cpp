@@ -0,0 +1,197 @@
+#include "entity.h"
+#include <cstring>
+
+EntityHandle EntityStore::create(EntityState const& e) {
+    uint32_t slot;
+    if (!free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots.size());
+        slots.push_back(Slot{});
+    }
+
+    // grow every column by one, the hole starts at the very end
+    uint32_t dense = static_cast<uint32_t>(id.size());
+    id.push_back(0);
+    type.push_back(e.type);
+    pos_x.push_back(0);
+    pos_y.push_back(0);
+    vel_x.push_back(0);
+    vel_y.push_back(0);
+    radius.push_back(0);
+    lifetime_ticks.push_back(0);
+    team.push_back(0);
+    cold.emplace_back();
+    dense_to_slot.push_back(slot);
+
+    // walk the hole down to the end of the entity's type partition:
+    // the first element of every later partition moves to that partition's end
+    uint32_t t = static_cast<uint32_t>(e.type);
+    for (uint32_t p = ENTITY_TYPE_COUNT - 1; p > t; --p) {
+        uint32_t first = partition_begin[p];
+        if (first != dense) {
+            moveDense(first, dense);
+            dense = first;
+        }
+        partition_begin[p]++;
+    }
+    partition_begin[ENTITY_TYPE_COUNT] = static_cast<uint32_t>(id.size());
+
+    slots[slot].dense = dense;
+    dense_to_slot[dense] = slot;
+    id[dense] = e.id;
+    set(dense, e);
+
+    uint32_t serial = entitySerial(e.id);
+    if (serial >= id_to_slot.size()) id_to_slot.resize(static_cast<size_t>(serial) + 1, INVALID_INDEX);
+    id_to_slot[serial] = slot;
+
+    EntityHandle h;
+    h.index = slot;
+    h.generation = slots[slot].generation;
+    return h;
+}
+
+bool EntityStore::destroy(uint32_t entity_id) {
+    uint32_t dense = find(entity_id);
+    if (dense == INVALID_INDEX) return false;
+
+    uint32_t slot = dense_to_slot[dense];
+    uint32_t t = static_cast<uint32_t>(type[dense]);
+
+    // swap-with-last inside the partition, then let every later partition
+    // shift its last element into the hole so the columns stay packed
+    uint32_t hole = dense;
+    uint32_t last_in_type = partition_begin[t + 1] - 1;
+    if (hole != last_in_type) moveDense(last_in_type, hole);
+    hole = last_in_type;
+    for (uint32_t p = t + 1; p < ENTITY_TYPE_COUNT; ++p) {
+        uint32_t last_in_p = partition_begin[p + 1] - 1;
+        if (partition_begin[p] <= last_in_p) {
+            moveDense(last_in_p, hole);
+            hole = last_in_p;
+        }
+        partition_begin[p]--;
+    }
+
+    id.pop_back();
+    type.pop_back();
+    pos_x.pop_back();
+    pos_y.pop_back();
+    vel_x.pop_back();
+    vel_y.pop_back();
+    radius.pop_back();
+    lifetime_ticks.pop_back();
+    team.pop_back();
+    cold.pop_back();
+    dense_to_slot.pop_back();
+    partition_begin[ENTITY_TYPE_COUNT] = static_cast<uint32_t>(id.size());
+
+    // bump the generation so outstanding handles to this slot go stale
+    slots[slot].dense = INVALID_INDEX;
+    slots[slot].generation++;
+    free_slots.push_back(slot);
+    id_to_slot[entitySerial(entity_id)] = INVALID_INDEX;
+    return true;
+}
+
+void EntityStore::clear() {
+    while (!id.empty()) destroy(id.back());
+}
+
+void EntityStore::moveDense(uint32_t from, uint32_t to) {
+    id[to] = id[from];
+    type[to] = type[from];
+    pos_x[to] = pos_x[from];
+    pos_y[to] = pos_y[from];
+    vel_x[to] = vel_x[from];
+    vel_y[to] = vel_y[from];
+    radius[to] = radius[from];
+    lifetime_ticks[to] = lifetime_ticks[from];
+    team[to] = team[from];
+    cold[to] = cold[from];
+    dense_to_slot[to] = dense_to_slot[from];
+    slots[dense_to_slot[to]].dense = to;
+}
+
+EntityHandle EntityStore::handleOf(uint32_t entity_id) const {
+    EntityHandle h;
+    if (find(entity_id) == INVALID_INDEX) return h;
+    uint32_t slot = id_to_slot[entitySerial(entity_id)];
+    h.index = slot;
+    h.generation = slots[slot].generation;
+    return h;
+}
+
+EntityState EntityStore::get(uint32_t dense) const {
+    EntityState e;
+    e.id = id[dense];
+    e.type = type[dense];
+    e.pos_x = pos_x[dense];
+    e.pos_y = pos_y[dense];
+    e.vel_x = vel_x[dense];
+    e.vel_y = vel_y[dense];
+    e.radius = radius[dense];
+    e.lifetime_ticks = lifetime_ticks[dense];
+    e.team = team[dense];
+    EntityCold const& c = cold[dense];
+    e.health = c.health;
+    e.status_flags = c.status_flags;
+    e.active_buff_count = c.active_buff_count;
+    std::memcpy(e.buffs, c.buffs, sizeof(e.buffs));
+    e.ability_id = c.ability_id;
+    e.caster_id = c.caster_id;
+    return e;
+}
+
+void EntityStore::set(uint32_t dense, EntityState const& e) {
+    type[dense] = e.type;
+    pos_x[dense] = e.pos_x;
+    pos_y[dense] = e.pos_y;
+    vel_x[dense] = e.vel_x;
+    vel_y[dense] = e.vel_y;
+    radius[dense] = e.radius;
+    lifetime_ticks[dense] = e.lifetime_ticks;
+    team[dense] = e.team;
+    EntityCold& c = cold[dense];
+    c.health = e.health;
+    c.status_flags = e.status_flags;
+    c.active_buff_count = e.active_buff_count;
+    std::memcpy(c.buffs, e.buffs, sizeof(c.buffs));
+    c.ability_id = e.ability_id;
+    c.caster_id = e.caster_id;
+}
+
+// ---- EntityIdAllocator ----
+
+void EntityIdAllocator::reset(uint32_t first_serial) {
+    next_serial = first_serial;
+    for (FreeList& f : free) {
+        f.ids.clear();
+        f.head = 0;
+    }
+}
+
+uint32_t EntityIdAllocator::allocate(EntityType t) {
+    FreeList& f = free[static_cast<uint32_t>(t)];
+    if (f.head < f.ids.size()) {
+        uint32_t id = f.ids[f.head++];
+        if (f.head == f.ids.size()) {
+            f.ids.clear();
+            f.head = 0;
+        } else if (f.head >= 64 && f.head * 2 >= f.ids.size()) {
+            f.ids.erase(f.ids.begin(), f.ids.begin() + static_cast<std::ptrdiff_t>(f.head));
+            f.head = 0;
+        }
+        return id;
+    }
+    if (next_serial > ENTITY_SERIAL_MASK) return INVALID_ENTITY_ID;
+    return next_serial++;
+}
+
+void EntityIdAllocator::release(uint32_t id, EntityType t) {
+    uint32_t generation = entityGeneration(id);
+    if (generation >= ENTITY_GENERATION_MAX) return; // retired: a next generation could collide with a stale ID
+    free[static_cast<uint32_t>(t)].ids.push_back(entitySerial(id) | ((generation + 1) << ENTITY_SERIAL_BITS));
+}
@@ -0,0 +1,157 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "entity_state.h"
+
+constexpr uint32_t ENTITY_TYPE_COUNT = 2; // keep in sync with EntityType
+
+// ---------- Entity IDs ----------
+// The low ENTITY_SERIAL_BITS of an ID are its serial, what EntityStore indexes by; the bits
+// above count how often that serial was reused. A destroyed entity's serial goes back to its
+// type's free list and comes out again with the next generation, so the serial space (and
+// every table indexed by it) stays as big as the peak entity count, while an ID kept past its
+// entity's death (a Lua local, a client baseline, a lag-compensated hit) never names the
+// newcomer. First issues are generation 0, so IDs read as plain counters until churn starts.
+constexpr uint32_t ENTITY_SERIAL_BITS = 20;
+constexpr uint32_t ENTITY_SERIAL_MASK = (1u << ENTITY_SERIAL_BITS) - 1;
+constexpr uint32_t ENTITY_GENERATION_MAX = (1u << 11) - 1; // IDs stay below 2^31: Lua and the bindings pass them as int
+constexpr uint32_t INVALID_ENTITY_ID = 0;
+
+inline uint32_t entitySerial(uint32_t id) { return id & ENTITY_SERIAL_MASK; }
+inline uint32_t entityGeneration(uint32_t id) { return id >> ENTITY_SERIAL_BITS; }
+
+// Hands out entity IDs: a free serial of the type (oldest freed first, so a serial rests as
+// long as possible), else a fresh one. A serial whose generation ran out is retired.
+// Plain data, so a SavedState copies it with the rest of the match.
+class EntityIdAllocator {
+public:
+    explicit EntityIdAllocator(uint32_t first_serial = 1) { reset(first_serial); }
+
+    // INVALID_ENTITY_ID when every serial is in use
+    uint32_t allocate(EntityType t);
+    // `id` died (end of tick, after its entity left the store)
+    void release(uint32_t id, EntityType t);
+
+    // Keyframes: the next fresh serial and each type's free list in hand-out order
+    uint32_t nextSerial() const { return next_serial; }
+    size_t freeCount(EntityType t) const { return free[static_cast<uint32_t>(t)].ids.size() - free[static_cast<uint32_t>(t)].head; }
+    uint32_t const* freeIds(EntityType t) const { return free[static_cast<uint32_t>(t)].ids.data() + free[static_cast<uint32_t>(t)].head; }
+    void reset(uint32_t first_serial);
+    void pushFree(EntityType t, uint32_t next_id) { free[static_cast<uint32_t>(t)].ids.push_back(next_id); }
+
+private:
+    // FIFO: popped from `head`, the consumed front is dropped once it is half the vector
+    struct FreeList {
+        std::vector<uint32_t> ids; // the ID each serial is handed out as next
+        size_t head = 0;
+    };
+
+    uint32_t next_serial = 1;
+    FreeList free[ENTITY_TYPE_COUNT];
+};
+
+// Generational handle into the EntityStore slot table.
+// A handle goes stale as soon as its entity is destroyed (generation mismatch),
+// so it is safe to keep one across ticks and re-resolve it.
+struct EntityHandle {
+    uint32_t index = 0xFFFFFFFFu;
+    uint32_t generation = 0;
+};
+
+// Cold per-entity data. Only touched by damage, status and snapshot code.
+struct EntityCold {
+    int32_t health = 0;
+    // from the character def at spawn (DemoServer::cacheResists), read by the damage pass.
+    // Derived, so not part of EntityState: keyframe loads re-derive it.
+    int32_t armor = 0;
+    int32_t magic_resist = 0;
+    uint16_t status_flags = 0;
+    uint8_t active_buff_count = 0;
+    ActiveBuff buffs[8];
+    uint16_t ability_id = 0xFFFF; // EntityState::ability_id, read when a projectile hits
+    uint32_t caster_id = 0;       // EntityState::caster_id, likewise
+};
+
+// Dense struct-of-arrays entity registry.
+// - hot columns (pos/vel/radius/lifetime/type/team) are separate contiguous arrays so the tick
+//   passes only pull in the bytes they actually use
+// - live entities are always packed in [0, size()) and partitioned by EntityType
+//   (all characters, then all projectiles), so per-type systems run over one contiguous range
+// - removal is swap-with-last inside the partition (at most one extra move per later partition)
+// - entity ID -> dense index is O(1) through the serial table + slot table (no hashing); the
+//   stored ID must match too, so a dead entity's ID never resolves to its serial's next owner
+class EntityStore {
+public:
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFFu;
+
+    // ---- hot columns (dense, indexed by dense index) ----
+    std::vector<uint32_t> id;
+    std::vector<EntityType> type;
+    std::vector<int32_t> pos_x;
+    std::vector<int32_t> pos_y;
+    std::vector<int32_t> vel_x; // fixed-point units PER SIMULATION TICK
+    std::vector<int32_t> vel_y;
+    std::vector<int32_t> radius;
+    std::vector<int32_t> lifetime_ticks; // -1 = infinite
+    std::vector<uint8_t> team;           // read every tick by interest management
+
+    // ---- cold column ----
+    std::vector<EntityCold> cold;
+
+    // Adds an entity (e.id must be unique and already assigned by the caller, EntityIdAllocator).
+    EntityHandle create(EntityState const& e);
+    // Removes by ID. Returns false if the ID is not alive.
+    bool destroy(uint32_t entity_id);
+    void clear();
+
+    size_t size() const { return id.size(); }
+    bool empty() const { return id.empty(); }
+
+    // [begin, end) dense range holding every entity of type t
+    struct Range { uint32_t begin; uint32_t end; };
+    Range range(EntityType t) const {
+        uint32_t p = static_cast<uint32_t>(t);
+        return Range{ partition_begin[p], partition_begin[p + 1] };
+    }
+
+    // O(1): entity ID -> dense index (INVALID_INDEX when not alive)
+    uint32_t find(uint32_t entity_id) const {
+        uint32_t serial = entitySerial(entity_id);
+        if (serial >= id_to_slot.size()) return INVALID_INDEX;
+        uint32_t slot = id_to_slot[serial];
+        if (slot == INVALID_INDEX) return INVALID_INDEX;
+        uint32_t dense = slots[slot].dense;
+        return id[dense] == entity_id ? dense : INVALID_INDEX; // another generation of the serial
+    }
+
+    EntityHandle handleOf(uint32_t entity_id) const;
+    // handle -> dense index (INVALID_INDEX when stale)
+    uint32_t resolve(EntityHandle h) const {
+        if (h.index >= slots.size()) return INVALID_INDEX;
+        Slot const& s = slots[h.index];
+        if (s.generation != h.generation) return INVALID_INDEX;
+        return s.dense;
+    }
+    bool valid(EntityHandle h) const { return resolve(h) != INVALID_INDEX; }
+
+    // AoS gather/scatter for the snapshot path and other code that still wants an EntityState
+    EntityState get(uint32_t dense) const;
+    void set(uint32_t dense, EntityState const& e);
+
+private:
+    struct Slot {
+        uint32_t dense = INVALID_INDEX; // INVALID_INDEX while the slot is free
+        uint32_t generation = 0;
+    };
+
+    // move every column of dense index `from` into `to` and repoint its slot
+    void moveDense(uint32_t from, uint32_t to);
+
+    uint32_t partition_begin[ENTITY_TYPE_COUNT + 1] = {};
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> free_slots;
+    std::vector<uint32_t> dense_to_slot;
+    std::vector<uint32_t> id_to_slot; // indexed by entitySerial(ID)
+};
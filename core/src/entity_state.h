@@ -19,11 +19,25 @@ enum class StatusFlags : uint16_t {
     Hypnosis    = 1 << 8
 };
 
+// Statuses applyInputsToEntity enforces: hard crowd control takes both moves and casts, Root
+// only moves. The rest are for scripts to read.
+constexpr uint16_t STATUS_BLOCKS_CASTS = static_cast<uint16_t>(StatusFlags::Stun) | static_cast<uint16_t>(StatusFlags::KnockUp) | static_cast<uint16_t>(StatusFlags::Suppression) | static_cast<uint16_t>(StatusFlags::Freeze) | static_cast<uint16_t>(StatusFlags::Paralysis);
+constexpr uint16_t STATUS_BLOCKS_MOVES = STATUS_BLOCKS_CASTS | static_cast<uint16_t>(StatusFlags::Root);
+
+// Match sides. Interest management (interest.h) shows a team its own entities plus what its
+// characters see; neutral entities belong to nobody.
+constexpr uint8_t TEAM_NEUTRAL = 0xFF;
+
+// Absolute ticks, so nothing counts down per tick: the timer wheel fires expiries and
+// periodic effects when due (DemoServer::processBuffs).
+constexpr uint32_t BUFF_PERMANENT = 0xFFFFFFFFu; // expire_tick of a buff that lasts until removed
+
 // (Max 8 buffs per entity)
 struct ActiveBuff {
     uint32_t source_entity_id = 0;
-    uint16_t buff_id = 0;
-    int32_t remaining_ticks = 0;   
+    uint16_t buff_id = 0;       // BuffId (game_defs.h)
+    uint32_t applied_tick = 0;  // periods run every period_ticks from here
+    uint32_t expire_tick = 0;   // tick it ends on (a period due then still runs), BUFF_PERMANENT = never
 };
 
 #pragma pack(push, 1)
@@ -38,14 +52,14 @@ struct EntityState {
     int32_t radius = 0;
     int32_t lifetime_ticks = -1; // -1 = infinite
     uint16_t status_flags = 0;
+    uint8_t team = 0; // projectiles take their caster's
     uint8_t active_buff_count = 0;
     ActiveBuff buffs[8];
+    uint16_t ability_id = 0xFFFF; // projectiles: the AbilityId that spawned it (its on_hit takes the hits), 0xFFFF = none
+    uint32_t caster_id = 0;       // projectiles: who spawned it, the source of its hits' damage
 
     constexpr EntityState() = default;
 
-    // Callbacks (simplified for now)
-    // ex.: std::string on_hit_callback; 
-
     constexpr bool operator==(EntityState const& o) const {
         return id == o.id &&
                type == o.type &&
@@ -56,7 +70,23 @@ struct EntityState {
                health == o.health &&
                radius == o.radius &&
                lifetime_ticks == o.lifetime_ticks &&
-               status_flags == o.status_flags;
+               status_flags == o.status_flags &&
+               team == o.team &&
+               ability_id == o.ability_id &&
+               caster_id == o.caster_id &&
+               buffsEqual(o);
+    }
+
+    // only the live slots [0, active_buff_count) count
+    constexpr bool buffsEqual(EntityState const& o) const {
+        if (active_buff_count != o.active_buff_count) return false;
+        for (uint32_t b = 0; b < active_buff_count && b < 8; ++b) {
+            if (buffs[b].source_entity_id != o.buffs[b].source_entity_id ||
+                buffs[b].buff_id != o.buffs[b].buff_id ||
+                buffs[b].applied_tick != o.buffs[b].applied_tick ||
+                buffs[b].expire_tick != o.buffs[b].expire_tick) return false;
+        }
+        return true;
     }
 
     constexpr bool operator!=(EntityState const& o) const {
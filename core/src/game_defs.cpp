@@ -0,0 +1,394 @@
+#include "game_defs.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+#include "entity_state.h"
+#include "../../vendor/cpp/nlohmann/json.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+// ---------- Compiler ----------
+
+namespace {
+
+struct StringPool {
+    std::string bytes{std::string(1, '\0')};
+    std::unordered_map<std::string, uint32_t> offsets;
+
+    uint32_t intern(const std::string& s) {
+        if (s.empty()) return 0;
+        auto it = offsets.find(s);
+        if (it != offsets.end()) return it->second;
+        uint32_t off = static_cast<uint32_t>(bytes.size());
+        bytes.append(s).push_back('\0');
+        offsets.emplace(s, off);
+        return off;
+    }
+};
+
+template <class T>
+uint32_t appendSection(std::vector<uint8_t>& out, T const* data, size_t count) {
+    out.resize((out.size() + 3) & ~size_t(3), 0);
+    uint32_t off = static_cast<uint32_t>(out.size());
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+    out.insert(out.end(), p, p + count * sizeof(T));
+    return off;
+}
+
+std::vector<DefsNameIndex> sortedIndex(std::vector<DefsEntryInfo> const& info, StringPool const& pool) {
+    std::vector<DefsNameIndex> index(info.size());
+    for (size_t i = 0; i < info.size(); ++i) index[i] = DefsNameIndex{info[i].name, static_cast<uint32_t>(i)};
+    std::sort(index.begin(), index.end(), [&](DefsNameIndex const& a, DefsNameIndex const& b) {
+        return strcmp(pool.bytes.data() + a.name, pool.bytes.data() + b.name) < 0;
+    });
+    return index;
+}
+
+// "status": ["Burn", ...] -> StatusFlags mask; false on an unknown name
+bool parseStatusFlags(json const& names, uint16_t& out, std::string& bad) {
+    static const struct { const char* name; StatusFlags flag; } known[] = {
+        {"Stun", StatusFlags::Stun}, {"Root", StatusFlags::Root}, {"KnockUp", StatusFlags::KnockUp},
+        {"Suppression", StatusFlags::Suppression}, {"Freeze", StatusFlags::Freeze}, {"Paralysis", StatusFlags::Paralysis},
+        {"Burn", StatusFlags::Burn}, {"Confusion", StatusFlags::Confusion}, {"Hypnosis", StatusFlags::Hypnosis},
+    };
+    out = 0;
+    for (auto const& n : names) {
+        std::string name = n.get<std::string>();
+        bool found = false;
+        for (auto const& k : known) {
+            if (name != k.name) continue;
+            out |= static_cast<uint16_t>(k.flag);
+            found = true;
+        }
+        if (!found) {
+            bad = name;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool CompileGameDefs(const std::string& json_text, DefsUnits units, std::vector<uint8_t>& out, std::string& error) {
+    json data = json::parse(json_text, nullptr, false);
+    if (data.is_discarded()) {
+        error = "game defs: malformed JSON";
+        return false;
+    }
+
+    auto fixed = [&](double v) { return static_cast<int32_t>(std::llround(v * units.pos_scale)); };
+    auto ticks = [&](double seconds) { return static_cast<int32_t>(std::llround(seconds * units.tick_rate)); };
+    auto permille = [](double v) { return static_cast<int32_t>(std::llround(v * 1000.0)); };
+
+    StringPool pool;
+    std::vector<AbilityStats> abilities;
+    std::vector<DefsEntryInfo> ability_info;
+    std::vector<CharacterStats> characters;
+    std::vector<DefsEntryInfo> character_info;
+    std::vector<BuffStats> buffs;
+    std::vector<DefsEntryInfo> buff_info;
+
+    try {
+        if (data.contains("abilities")) {
+            for (auto& [ability_key, ability_data] : data["abilities"].items()) {
+                AbilityStats as;
+                as.cooldown_ticks = ticks(ability_data.value("cooldown", 0.0));
+                as.mana_cost = ability_data.value("manaCost", 0);
+                if (ability_data.contains("stats")) {
+                    auto const& stats = ability_data["stats"];
+                    as.damage = stats.value("damage", 0);
+                    as.damage_type = ParseDamageType(stats.value("damageType", std::string()).c_str());
+                    as.speed = fixed(stats.value("speed", 0.0));
+                    as.radius = fixed(stats.value("radius", 0.0));
+                    if (stats.contains("lifetime")) as.lifetime_ticks = ticks(stats["lifetime"].get<double>());
+                }
+                abilities.push_back(as);
+                ability_info.push_back(DefsEntryInfo{pool.intern(ability_key), pool.intern(ability_data.value("script", std::string()))});
+            }
+        }
+
+        if (data.contains("characters")) {
+            for (auto& [char_key, char_data] : data["characters"].items()) {
+                CharacterStats cs;
+                if (char_data.contains("baseStats")) {
+                    auto const& stats = char_data["baseStats"];
+                    cs.hp = stats.value("hp", 0);
+                    cs.mana = stats.value("mana", 0);
+                    cs.armor = stats.value("armor", 0);
+                    cs.magic_resist = stats.value("magicResist", 0);
+                    cs.move_speed = stats.value("moveSpeed", 0);
+                    cs.cooldown_reduction_permille = permille(stats.value("cooldownReduction", 0.0));
+                    cs.vampirism_permille = permille(stats.value("vampirism", 0.0));
+                }
+                characters.push_back(cs);
+                character_info.push_back(DefsEntryInfo{pool.intern(char_key), 0});
+            }
+        }
+
+        if (data.contains("buffs")) {
+            for (auto& [buff_key, buff_data] : data["buffs"].items()) {
+                BuffStats bs;
+                if (buff_data.contains("duration")) bs.duration_ticks = ticks(buff_data["duration"].get<double>());
+                bs.period_ticks = ticks(buff_data.value("period", 0.0));
+                bs.tick_damage = buff_data.value("tickDamage", 0);
+                bs.damage_type = ParseDamageType(buff_data.value("damageType", std::string()).c_str());
+                std::string bad;
+                if (buff_data.contains("status") && !parseStatusFlags(buff_data["status"], bs.status_flags, bad)) {
+                    error = "game defs: buff " + buff_key + ": unknown status '" + bad + "'";
+                    return false;
+                }
+                if (bs.period_ticks < 0 || (bs.duration_ticks < 0 && bs.duration_ticks != -1)) {
+                    error = "game defs: buff " + buff_key + ": negative period or duration";
+                    return false;
+                }
+                buffs.push_back(bs);
+                buff_info.push_back(DefsEntryInfo{pool.intern(buff_key), pool.intern(buff_data.value("script", std::string()))});
+            }
+        }
+    } catch (json::exception const& e) {
+        error = std::string("game defs: ") + e.what();
+        return false;
+    }
+
+    if (abilities.size() >= INVALID_DEF_ID || characters.size() >= INVALID_DEF_ID || buffs.size() >= INVALID_DEF_ID) {
+        error = "game defs: too many entries for 16-bit ids";
+        return false;
+    }
+
+    std::vector<DefsNameIndex> ability_index = sortedIndex(ability_info, pool);
+    std::vector<DefsNameIndex> character_index = sortedIndex(character_info, pool);
+    std::vector<DefsNameIndex> buff_index = sortedIndex(buff_info, pool);
+
+    DefsBlobHeader hdr{};
+    out.assign(sizeof(DefsBlobHeader), 0);
+    hdr.magic = DEFS_BLOB_MAGIC;
+    hdr.version = DEFS_BLOB_VERSION;
+    hdr.pos_scale = units.pos_scale;
+    hdr.tick_rate = units.tick_rate;
+    hdr.ability_count = static_cast<uint32_t>(abilities.size());
+    hdr.abilities_off = appendSection(out, abilities.data(), abilities.size());
+    hdr.ability_info_off = appendSection(out, ability_info.data(), ability_info.size());
+    hdr.ability_index_off = appendSection(out, ability_index.data(), ability_index.size());
+    hdr.character_count = static_cast<uint32_t>(characters.size());
+    hdr.characters_off = appendSection(out, characters.data(), characters.size());
+    hdr.character_info_off = appendSection(out, character_info.data(), character_info.size());
+    hdr.character_index_off = appendSection(out, character_index.data(), character_index.size());
+    hdr.buff_count = static_cast<uint32_t>(buffs.size());
+    hdr.buffs_off = appendSection(out, buffs.data(), buffs.size());
+    hdr.buff_info_off = appendSection(out, buff_info.data(), buff_info.size());
+    hdr.buff_index_off = appendSection(out, buff_index.data(), buff_index.size());
+    hdr.strings_off = appendSection(out, pool.bytes.data(), pool.bytes.size());
+    hdr.strings_size = static_cast<uint32_t>(pool.bytes.size());
+    out.resize((out.size() + 3) & ~size_t(3), 0);
+    hdr.total_size = static_cast<uint32_t>(out.size());
+    memcpy(out.data(), &hdr, sizeof(hdr));
+    return true;
+}
+
+// ---------- GameDefs ----------
+
+GameDefs::~GameDefs() {
+    clear();
+}
+
+void GameDefs::clear() {
+    unmap();
+    owned.clear();
+    hdr = nullptr;
+    abilities = nullptr;
+    ability_info = nullptr;
+    ability_index = nullptr;
+    ability_count = 0;
+    characters = nullptr;
+    character_info = nullptr;
+    character_index = nullptr;
+    character_count = 0;
+    buffs = nullptr;
+    buff_info = nullptr;
+    buff_index = nullptr;
+    buff_count = 0;
+    strings = nullptr;
+    strings_size = 0;
+}
+
+void GameDefs::swap(GameDefs& other) {
+    // the blob's pointers stay valid: a vector swap and a mapping both keep their bytes in place
+    std::swap(owned, other.owned);
+    std::swap(map_base, other.map_base);
+    std::swap(map_size, other.map_size);
+#ifdef _WIN32
+    std::swap(map_file, other.map_file);
+    std::swap(map_handle, other.map_handle);
+#endif
+    std::swap(hdr, other.hdr);
+    std::swap(abilities, other.abilities);
+    std::swap(ability_info, other.ability_info);
+    std::swap(ability_index, other.ability_index);
+    std::swap(ability_count, other.ability_count);
+    std::swap(characters, other.characters);
+    std::swap(character_info, other.character_info);
+    std::swap(character_index, other.character_index);
+    std::swap(character_count, other.character_count);
+    std::swap(buffs, other.buffs);
+    std::swap(buff_info, other.buff_info);
+    std::swap(buff_index, other.buff_index);
+    std::swap(buff_count, other.buff_count);
+    std::swap(strings, other.strings);
+    std::swap(strings_size, other.strings_size);
+}
+
+bool GameDefs::adopt(std::vector<uint8_t> blob, std::string& error) {
+    clear();
+    owned = std::move(blob);
+    if (attach(owned.data(), owned.size(), error)) return true;
+    clear();
+    return false;
+}
+
+bool GameDefs::mapFile(const std::string& path, std::string& error) {
+    clear();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        error = "cannot map " + path;
+        return false;
+    }
+    map_file = file;
+    map_handle = mapping;
+    map_base = base;
+    map_size = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file alive
+    if (base == MAP_FAILED) {
+        error = "cannot map " + path;
+        return false;
+    }
+    map_base = base;
+    map_size = static_cast<size_t>(st.st_size);
+#endif
+
+    if (attach(static_cast<const uint8_t*>(map_base), map_size, error)) return true;
+    error = path + ": " + error;
+    clear();
+    return false;
+}
+
+void GameDefs::unmap() {
+    if (!map_base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(map_base);
+    CloseHandle(static_cast<HANDLE>(map_handle));
+    CloseHandle(static_cast<HANDLE>(map_file));
+    map_handle = nullptr;
+    map_file = nullptr;
+#else
+    munmap(map_base, map_size);
+#endif
+    map_base = nullptr;
+    map_size = 0;
+}
+
+// O(1) apart from the index ids: the records are used as they are
+bool GameDefs::attach(const uint8_t* data, size_t size, std::string& error) {
+    if (size < sizeof(DefsBlobHeader)) {
+        error = "truncated defs blob";
+        return false;
+    }
+    auto const* h = reinterpret_cast<DefsBlobHeader const*>(data);
+    if (h->magic != DEFS_BLOB_MAGIC) {
+        error = "not a defs blob (bad magic)";
+        return false;
+    }
+    if (h->version != DEFS_BLOB_VERSION) {
+        error = "defs blob version " + std::to_string(h->version) + ", expected " + std::to_string(DEFS_BLOB_VERSION);
+        return false;
+    }
+    auto section = [&](uint32_t off, uint64_t count, size_t elem) {
+        return off % 4 == 0 && off >= sizeof(DefsBlobHeader) && off <= size && count * elem <= size - off;
+    };
+    bool ok = h->total_size == size && h->ability_count < INVALID_DEF_ID && h->character_count < INVALID_DEF_ID && h->buff_count < INVALID_DEF_ID &&
+              section(h->abilities_off, h->ability_count, sizeof(AbilityStats)) &&
+              section(h->ability_info_off, h->ability_count, sizeof(DefsEntryInfo)) &&
+              section(h->ability_index_off, h->ability_count, sizeof(DefsNameIndex)) &&
+              section(h->characters_off, h->character_count, sizeof(CharacterStats)) &&
+              section(h->character_info_off, h->character_count, sizeof(DefsEntryInfo)) &&
+              section(h->character_index_off, h->character_count, sizeof(DefsNameIndex)) &&
+              section(h->buffs_off, h->buff_count, sizeof(BuffStats)) &&
+              section(h->buff_info_off, h->buff_count, sizeof(DefsEntryInfo)) &&
+              section(h->buff_index_off, h->buff_count, sizeof(DefsNameIndex)) &&
+              section(h->strings_off, h->strings_size, 1) && h->strings_size > 0 &&
+              data[h->strings_off] == 0 && data[h->strings_off + h->strings_size - 1] == 0;
+    if (!ok) {
+        error = "corrupt defs blob (section bounds)";
+        return false;
+    }
+
+    auto const* a_index = reinterpret_cast<DefsNameIndex const*>(data + h->ability_index_off);
+    auto const* c_index = reinterpret_cast<DefsNameIndex const*>(data + h->character_index_off);
+    auto const* b_index = reinterpret_cast<DefsNameIndex const*>(data + h->buff_index_off);
+    for (uint32_t k = 0; k < h->ability_count; ++k) ok = ok && a_index[k].id < h->ability_count;
+    for (uint32_t k = 0; k < h->character_count; ++k) ok = ok && c_index[k].id < h->character_count;
+    for (uint32_t k = 0; k < h->buff_count; ++k) ok = ok && b_index[k].id < h->buff_count;
+    if (!ok) {
+        error = "corrupt defs blob (name index)";
+        return false;
+    }
+
+    hdr = h;
+    abilities = reinterpret_cast<AbilityStats const*>(data + h->abilities_off);
+    ability_info = reinterpret_cast<DefsEntryInfo const*>(data + h->ability_info_off);
+    ability_index = a_index;
+    ability_count = h->ability_count;
+    characters = reinterpret_cast<CharacterStats const*>(data + h->characters_off);
+    character_info = reinterpret_cast<DefsEntryInfo const*>(data + h->character_info_off);
+    character_index = c_index;
+    character_count = h->character_count;
+    buffs = reinterpret_cast<BuffStats const*>(data + h->buffs_off);
+    buff_info = reinterpret_cast<DefsEntryInfo const*>(data + h->buff_info_off);
+    buff_index = b_index;
+    buff_count = h->buff_count;
+    strings = reinterpret_cast<const char*>(data + h->strings_off);
+    strings_size = h->strings_size;
+    return true;
+}
+
+uint16_t GameDefs::find(DefsNameIndex const* index, uint32_t count, const char* name) const {
+    if (!index || !name) return INVALID_DEF_ID;
+    auto const* end = index + count;
+    auto const* it = std::lower_bound(index, end, name, [this](DefsNameIndex const& e, const char* key) {
+        return strcmp(str(e.name), key) < 0;
+    });
+    if (it == end || strcmp(str(it->name), name) != 0) return INVALID_DEF_ID;
+    return static_cast<uint16_t>(it->id);
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "combat.h"
+
+// ---------- Compiled game definitions ----------
+// game_defs.json (the authoring format, see CharAbilityEditor) is compiled into one flat,
+// versioned binary blob: fixed-point stat tables indexed by dense ids, a string pool and a
+// name index sorted for binary search. moba_defs_compiler emits it at build time and the
+// server maps the file and reads it in place (no parsing, no allocation); without a blob the
+// server compiles the JSON into the same layout in memory. Names are looked up at load time
+// only (findAbility/findCharacter); the tick and the Lua bindings index the tables directly.
+using AbilityId = uint16_t;
+using CharacterId = uint16_t;
+using BuffId = uint16_t;
+constexpr uint16_t INVALID_DEF_ID = 0xFFFF;
+
+// Script-visible stats (Lua: GetAbilityStat(id, AbilityStat.<name>))
+enum class AbilityStat : uint8_t {
+    Damage,
+    Speed,
+    Radius,
+    Lifetime,
+    Cooldown,
+    ManaCost,
+    Count
+};
+constexpr uint32_t ABILITY_STAT_COUNT = static_cast<uint32_t>(AbilityStat::Count);
+
+inline const char* abilityStatName(AbilityStat s) {
+    switch (s) {
+        case AbilityStat::Damage: return "damage";
+        case AbilityStat::Speed: return "speed";
+        case AbilityStat::Radius: return "radius";
+        case AbilityStat::Lifetime: return "lifetime";
+        case AbilityStat::Cooldown: return "cooldown";
+        case AbilityStat::ManaCost: return "mana_cost";
+        default: return "?";
+    }
+}
+
+// Blob records: written and read as raw bytes, so no implicit padding (static_asserts below)
+struct AbilityStats {
+    int32_t damage = 0;           // raw, resist is applied on hit
+    int32_t speed = 0;            // fixed-point units per second
+    int32_t radius = 0;           // fixed-point
+    int32_t lifetime_ticks = -1;  // -1 = infinite
+    int32_t cooldown_ticks = 0;
+    int32_t mana_cost = 0;
+    DamageType damage_type = DamageType::Absolute;
+    uint8_t reserved[3] = {};
+};
+
+struct CharacterStats {
+    int32_t hp = 0;
+    int32_t mana = 0;
+    int32_t armor = 0;
+    int32_t magic_resist = 0;
+    int32_t move_speed = 0;
+    int32_t cooldown_reduction_permille = 0; // 0.05 -> 50
+    int32_t vampirism_permille = 0;
+};
+
+// A timed status (DemoServer::processBuffs). Its script's on_apply/on_expire hooks run when it starts/ends.
+struct BuffStats {
+    int32_t duration_ticks = -1;  // -1 = until removed
+    int32_t period_ticks = 0;     // 0 = no periodic effect, else tick_damage every period
+    int32_t tick_damage = 0;      // raw, per period
+    uint16_t status_flags = 0;    // StatusFlags held while active
+    DamageType damage_type = DamageType::Absolute;
+    uint8_t reserved = 0;
+};
+
+static_assert(sizeof(AbilityStats) == 28, "AbilityStats is a blob record, keep it padding-free");
+static_assert(sizeof(CharacterStats) == 28, "CharacterStats is a blob record, keep it padding-free");
+static_assert(sizeof(BuffStats) == 16, "BuffStats is a blob record, keep it padding-free");
+
+// ---------- Blob layout (version 2, little-endian) ----------
+// [header][ability stats][ability info][ability index][character stats][character info]
+// [character index][buff stats][buff info][buff index][string pool]. Every section is 4-byte aligned; offsets are from the
+// start of the blob. String offsets point into the pool, whose first byte is '\0' (offset 0
+// = empty string). Bump DEFS_BLOB_VERSION whenever a record or the header changes.
+constexpr uint32_t DEFS_BLOB_MAGIC = 0x4645444Du; // "MDEF"
+constexpr uint32_t DEFS_BLOB_VERSION = 2;
+
+struct DefsBlobHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t pos_scale;  // units the fixed-point fields were compiled with (POS_SCALE)
+    uint32_t tick_rate;  // ... and the tick fields (SERVER_TICK_RATE)
+    uint32_t ability_count;
+    uint32_t abilities_off;     // AbilityStats[ability_count], indexed by AbilityId
+    uint32_t ability_info_off;  // DefsEntryInfo[ability_count]
+    uint32_t ability_index_off; // DefsNameIndex[ability_count], sorted by name
+    uint32_t character_count;
+    uint32_t characters_off;
+    uint32_t character_info_off;
+    uint32_t character_index_off;
+    uint32_t buff_count;
+    uint32_t buffs_off;
+    uint32_t buff_info_off;
+    uint32_t buff_index_off;
+    uint32_t strings_off;
+    uint32_t strings_size;
+};
+
+struct DefsEntryInfo {
+    uint32_t name;   // string offset: the JSON key ("fireball_test")
+    uint32_t script; // string offset: script path relative to the scripts root, 0 = none
+};
+
+struct DefsNameIndex {
+    uint32_t name; // string offset
+    uint32_t id;
+};
+
+struct DefsUnits {
+    uint32_t pos_scale;
+    uint32_t tick_rate;
+};
+
+// game_defs.json text -> blob. Ids follow the JSON key order (sorted), so the same input
+// always yields the same bytes. Returns false with `error` set on malformed input.
+bool CompileGameDefs(const std::string& json_text, DefsUnits units, std::vector<uint8_t>& out, std::string& error);
+
+class GameDefs {
+public:
+    GameDefs() = default;
+    ~GameDefs();
+
+    GameDefs(GameDefs const&) = delete;
+    GameDefs& operator=(GameDefs const&) = delete;
+
+    // Map a blob file read-only and use it in place. Validates the header and section bounds.
+    bool mapFile(const std::string& path, std::string& error);
+    // Use a blob built in memory (CompileGameDefs)
+    bool adopt(std::vector<uint8_t> blob, std::string& error);
+    void clear();
+    // Exchange contents (hot reload: the new defs are built aside, then swapped in between ticks)
+    void swap(GameDefs& other);
+
+    bool loaded() const { return hdr != nullptr; }
+    bool mapped() const { return map_base != nullptr; }
+    DefsUnits units() const { return hdr ? DefsUnits{hdr->pos_scale, hdr->tick_rate} : DefsUnits{0, 0}; }
+
+    // Load time (binary search over the name index): INVALID_DEF_ID when unknown
+    AbilityId findAbility(const char* name) const { return find(ability_index, ability_count, name); }
+    CharacterId findCharacter(const char* name) const { return find(character_index, character_count, name); }
+    AbilityId findAbility(const std::string& name) const { return findAbility(name.c_str()); }
+    CharacterId findCharacter(const std::string& name) const { return findCharacter(name.c_str()); }
+    BuffId findBuff(const char* name) const { return find(buff_index, buff_count, name); }
+
+    // Hot path: plain index, nullptr when out of range
+    AbilityStats const* ability(AbilityId id) const { return id < ability_count ? &abilities[id] : nullptr; }
+    CharacterStats const* character(CharacterId id) const { return id < character_count ? &characters[id] : nullptr; }
+    BuffStats const* buff(BuffId id) const { return id < buff_count ? &buffs[id] : nullptr; }
+
+    const char* abilityName(AbilityId id) const { return id < ability_count ? str(ability_info[id].name) : ""; }
+    const char* abilityScript(AbilityId id) const { return id < ability_count ? str(ability_info[id].script) : ""; }
+    const char* characterName(CharacterId id) const { return id < character_count ? str(character_info[id].name) : ""; }
+    const char* buffName(BuffId id) const { return id < buff_count ? str(buff_info[id].name) : ""; }
+    const char* buffScript(BuffId id) const { return id < buff_count ? str(buff_info[id].script) : ""; }
+    size_t abilityCount() const { return ability_count; }
+    size_t characterCount() const { return character_count; }
+    size_t buffCount() const { return buff_count; }
+
+private:
+    bool attach(const uint8_t* data, size_t size, std::string& error);
+    void unmap();
+    const char* str(uint32_t off) const { return off < strings_size ? strings + off : ""; }
+    uint16_t find(DefsNameIndex const* index, uint32_t count, const char* name) const;
+
+    std::vector<uint8_t> owned;
+    void* map_base = nullptr;
+    size_t map_size = 0;
+#ifdef _WIN32
+    void* map_file = nullptr;
+    void* map_handle = nullptr;
+#endif
+
+    DefsBlobHeader const* hdr = nullptr;
+    AbilityStats const* abilities = nullptr;
+    DefsEntryInfo const* ability_info = nullptr;
+    DefsNameIndex const* ability_index = nullptr;
+    uint32_t ability_count = 0;
+    CharacterStats const* characters = nullptr;
+    DefsEntryInfo const* character_info = nullptr;
+    DefsNameIndex const* character_index = nullptr;
+    uint32_t character_count = 0;
+    BuffStats const* buffs = nullptr;
+    DefsEntryInfo const* buff_info = nullptr;
+    DefsNameIndex const* buff_index = nullptr;
+    uint32_t buff_count = 0;
+    const char* strings = nullptr;
+    uint32_t strings_size = 0;
+};
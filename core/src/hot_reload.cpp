@@ -0,0 +1,413 @@
+#include "hot_reload.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include "log.h"
+#include "lua_bridge.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t WAIT_SLICE_MS = 50; // how often the watcher checks for stop()
+
+bool ReadBytes(std::string const& path, std::string& out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+uint64_t HashBytes(std::string const& s) {
+    uint64_t h = 1469598103934665603ull; // FNV-1a
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// dot directories (the bytecode cache, editor temp dirs) are never watched
+bool Hidden(fs::path const& p) {
+    std::string name = p.filename().string();
+    return !name.empty() && name[0] == '.';
+}
+
+#if defined(__linux__)
+
+// inotify: one watch per directory (it isn't recursive), directories created later are added
+// as they appear
+class ChangeSource {
+public:
+    ~ChangeSource() {
+        if (fd >= 0) close(fd);
+    }
+
+    bool open(std::string const& defs_dir, std::string const& scripts_root) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) return false;
+        addDir(defs_dir, false);
+        addTree(scripts_root);
+        return !dirs.empty();
+    }
+
+    void wait(std::vector<std::string>& changed, uint32_t timeout_ms) {
+        pollfd p{fd, POLLIN, 0};
+        if (poll(&p, 1, static_cast<int>(timeout_ms)) <= 0) return;
+        alignas(inotify_event) char buf[4096];
+        for (;;) {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0) return;
+            for (char* at = buf; at < buf + n;) {
+                inotify_event const* ev = reinterpret_cast<inotify_event const*>(at);
+                at += sizeof(inotify_event) + ev->len;
+                auto it = dirs.find(ev->wd);
+                if (it == dirs.end()) continue;
+                if (ev->mask & IN_IGNORED) {
+                    dirs.erase(it); // the directory is gone
+                    continue;
+                }
+                if (ev->len == 0) continue;
+                std::string path = it->second.path + ev->name;
+                if (!(ev->mask & IN_ISDIR)) {
+                    if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) changed.push_back(path); // not a half-written IN_CREATE
+                } else if (it->second.recursive && (ev->mask & (IN_CREATE | IN_MOVED_TO)) && !Hidden(path)) {
+                    addTree(path + "/");
+                    listFiles(path, changed); // written before its watch existed
+                }
+            }
+        }
+    }
+
+private:
+    struct Dir {
+        std::string path; // with the trailing '/'
+        bool recursive;
+    };
+
+    void addDir(std::string const& dir, bool recursive) {
+        // a finished write or a rename into place (editors save to a temp file and move it)
+        int wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd >= 0) dirs[wd] = Dir{dir, recursive};
+    }
+
+    void addTree(std::string const& root) {
+        addDir(root, true);
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (!it->is_directory(ec)) continue;
+            if (Hidden(it->path())) {
+                it.disable_recursion_pending();
+                continue;
+            }
+            addDir(it->path().generic_string() + "/", true);
+        }
+    }
+
+    static void listFiles(std::string const& dir, std::vector<std::string>& out) {
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(dir, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec)) out.push_back(it->path().generic_string());
+        }
+    }
+
+    int fd = -1;
+    std::unordered_map<int, Dir> dirs; // by watch descriptor
+};
+
+#elif defined(_WIN32)
+
+// ReadDirectoryChangesW, overlapped so the watcher can stop: the defs dir flat, the scripts
+// root as a subtree
+class ChangeSource {
+public:
+    ~ChangeSource() {
+        for (auto& d : dirs) {
+            CancelIoEx(d->handle, &d->ov);
+            DWORD bytes;
+            GetOverlappedResult(d->handle, &d->ov, &bytes, TRUE);
+            CloseHandle(d->ov.hEvent);
+            CloseHandle(d->handle);
+        }
+    }
+
+    bool open(std::string const& defs_dir, std::string const& scripts_root) {
+        addDir(defs_dir, false);
+        addDir(scripts_root, true);
+        return !dirs.empty();
+    }
+
+    void wait(std::vector<std::string>& changed, uint32_t timeout_ms) {
+        if (events.empty()) return;
+        DWORD r = WaitForMultipleObjects(static_cast<DWORD>(events.size()), events.data(), FALSE, timeout_ms);
+        if (r >= WAIT_OBJECT_0 + events.size()) return; // timeout
+        for (auto& d : dirs) {
+            if (WaitForSingleObject(d->ov.hEvent, 0) != WAIT_OBJECT_0) continue;
+            DWORD bytes = 0;
+            if (GetOverlappedResult(d->handle, &d->ov, &bytes, FALSE) && bytes > 0) collect(*d, changed);
+            arm(*d); // bytes == 0: the buffer overflowed, those changes are lost
+        }
+    }
+
+private:
+    struct Dir {
+        std::string path;
+        bool recursive;
+        HANDLE handle;
+        OVERLAPPED ov;
+        alignas(DWORD) char buf[16 * 1024];
+    };
+
+    void addDir(std::string const& dir, bool recursive) {
+        HANDLE h = CreateFileA(dir.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                               OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+        if (h == INVALID_HANDLE_VALUE) return;
+        std::unique_ptr<Dir> d(new Dir());
+        d->path = dir;
+        d->recursive = recursive;
+        d->handle = h;
+        d->ov.hEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+        if (!d->ov.hEvent || !arm(*d)) {
+            if (d->ov.hEvent) CloseHandle(d->ov.hEvent);
+            CloseHandle(h);
+            return;
+        }
+        events.push_back(d->ov.hEvent);
+        dirs.push_back(std::move(d));
+    }
+
+    bool arm(Dir& d) {
+        ResetEvent(d.ov.hEvent);
+        return ReadDirectoryChangesW(d.handle, d.buf, sizeof(d.buf), d.recursive ? TRUE : FALSE,
+                                     FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                     nullptr, &d.ov, nullptr) != 0;
+    }
+
+    static void collect(Dir const& d, std::vector<std::string>& changed) {
+        char const* at = d.buf;
+        for (;;) {
+            FILE_NOTIFY_INFORMATION const* info = reinterpret_cast<FILE_NOTIFY_INFORMATION const*>(at);
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+                std::wstring name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+                changed.push_back(d.path + fs::path(name).generic_string()); // subtree names use '\'
+            }
+            if (info->NextEntryOffset == 0) break;
+            at += info->NextEntryOffset;
+        }
+    }
+
+    std::vector<std::unique_ptr<Dir>> dirs;
+    std::vector<HANDLE> events;
+};
+
+#else
+
+// No watch API: compare modification times every HOT_RELOAD_POLL_MS
+class ChangeSource {
+public:
+    bool open(std::string const& defs, std::string const& scripts) {
+        defs_dir = defs;
+        scripts_root = scripts;
+        scan(nullptr);
+        return true;
+    }
+
+    void wait(std::vector<std::string>& changed, uint32_t timeout_ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_scan < std::chrono::milliseconds(HOT_RELOAD_POLL_MS)) return;
+        last_scan = now;
+        scan(&changed);
+    }
+
+private:
+    void scan(std::vector<std::string>* changed) {
+        std::error_code ec;
+        for (auto const& entry : fs::directory_iterator(defs_dir, ec)) visit(entry, changed);
+        for (auto it = fs::recursive_directory_iterator(scripts_root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec) && Hidden(it->path())) it.disable_recursion_pending();
+            else visit(*it, changed);
+        }
+    }
+
+    // nullptr: baseline, nothing is reported
+    void visit(fs::directory_entry const& entry, std::vector<std::string>* changed) {
+        std::error_code ec;
+        if (!entry.is_regular_file(ec)) return;
+        fs::file_time_type t = entry.last_write_time(ec);
+        std::string path = entry.path().generic_string();
+        auto ins = seen.try_emplace(path, t);
+        if (!ins.second && ins.first->second == t) return;
+        ins.first->second = t;
+        if (changed) changed->push_back(path);
+    }
+
+    std::string defs_dir, scripts_root;
+    std::unordered_map<std::string, fs::file_time_type> seen;
+    std::chrono::steady_clock::time_point last_scan = std::chrono::steady_clock::now();
+};
+
+#endif
+
+} // namespace
+
+HotReloadWatcher::HotReloadWatcher(std::string defs, std::string scripts, DefsUnits u)
+    : defs_dir(std::move(defs)), scripts_root(std::move(scripts)), units(u) {}
+
+HotReloadWatcher::~HotReloadWatcher() {
+    stop();
+}
+
+void HotReloadWatcher::start() {
+    if (thread.joinable()) return;
+    quit.store(false, std::memory_order_relaxed);
+    thread = std::thread(&HotReloadWatcher::run, this);
+}
+
+void HotReloadWatcher::stop() {
+    if (!thread.joinable()) return;
+    quit.store(true, std::memory_order_release);
+    thread.join();
+}
+
+bool HotReloadWatcher::take(HotReloadBatch& out) {
+    if (!ready.load(std::memory_order_acquire)) return false;
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    out = std::move(next);
+    next = HotReloadBatch();
+    ready.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+void HotReloadWatcher::run() {
+    using Clock = std::chrono::steady_clock;
+    ChangeSource source;
+    if (!source.open(defs_dir, scripts_root)) {
+        MOBA_LOG(Lua, Warn, "Hot reload: cannot watch {}, reloading is off", scripts_root);
+        return;
+    }
+    MOBA_LOG(Lua, Info, "Hot reload: watching {} and {}game_defs", scripts_root, defs_dir);
+
+    std::vector<std::string> changed;
+    Clock::time_point last_change = Clock::now();
+    while (!quit.load(std::memory_order_acquire)) {
+        size_t before = changed.size();
+        source.wait(changed, WAIT_SLICE_MS);
+        Clock::time_point now = Clock::now();
+        if (changed.size() != before) {
+            last_change = now;
+        } else if (!changed.empty() && now - last_change >= std::chrono::milliseconds(HOT_RELOAD_SETTLE_MS)) {
+            prepare(changed);
+            changed.clear();
+        }
+    }
+}
+
+void HotReloadWatcher::prepare(std::vector<std::string> const& changed) {
+    std::vector<std::string> paths = changed;
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    HotReloadBatch batch;
+    bool defs_changed = false;
+    for (std::string const& path : paths) {
+        if (path == defs_dir + "game_defs.json" || path == defs_dir + "game_defs.bin") {
+            defs_changed = true;
+            continue;
+        }
+        if (path.size() <= scripts_root.size() || path.compare(0, scripts_root.size(), scripts_root) != 0) continue;
+        if (fs::path(path).extension() != ".lua" || path.find("/.", scripts_root.size() - 1) != std::string::npos) continue;
+        ScriptReload s;
+        if (prepareScript(path, s)) batch.scripts.push_back(std::move(s));
+    }
+    if (defs_changed) prepareDefs(batch);
+    if (batch.scripts.empty() && !batch.defs) return;
+    publish(std::move(batch));
+}
+
+bool HotReloadWatcher::prepareScript(std::string const& path, ScriptReload& out) {
+    std::string src;
+    if (!ReadBytes(path, src)) return false; // deleted again: the loaded version stays
+    uint64_t h = HashBytes(src);
+    auto it = source_hash.find(path);
+    if (it != source_hash.end() && it->second == h) return false; // touched, not edited
+    source_hash[path] = h;
+
+    std::string error;
+    if (!LuaBridge::compileChunk(src, path, out.bytecode, error)) {
+        MOBA_LOG(Lua, Error, "Hot reload: {} not reloaded: {}", path, error);
+        return false;
+    }
+    out.name = path.substr(scripts_root.size());
+    out.path = path;
+    return true;
+}
+
+bool HotReloadWatcher::prepareDefs(HotReloadBatch& batch) {
+    // the same choice as DemoServer::LoadGameDefs: the blob unless the JSON is newer
+    std::string blob_path = defs_dir + "game_defs.bin";
+    std::string json_path = defs_dir + "game_defs.json";
+    std::error_code ec;
+    bool have_blob = fs::exists(blob_path, ec);
+    if (have_blob && fs::exists(json_path, ec) && fs::last_write_time(json_path, ec) > fs::last_write_time(blob_path, ec)) have_blob = false;
+
+    std::string source = have_blob ? blob_path : json_path;
+    std::string bytes;
+    if (!ReadBytes(source, bytes)) {
+        MOBA_LOG(Gameplay, Error, "Hot reload: could not open {}", source);
+        return false;
+    }
+    uint64_t h = HashBytes(bytes);
+    auto it = source_hash.find(source);
+    if (it != source_hash.end() && it->second == h) return false;
+    source_hash[source] = h;
+
+    std::string error;
+    std::vector<uint8_t> blob;
+    if (have_blob) {
+        blob.assign(bytes.begin(), bytes.end());
+    } else if (!CompileGameDefs(bytes, units, blob, error)) {
+        MOBA_LOG(Gameplay, Error, "Hot reload: {}: {}, the loaded defs stay", source, error);
+        return false;
+    }
+    std::unique_ptr<GameDefs> defs(new GameDefs());
+    if (!defs->adopt(std::move(blob), error)) {
+        MOBA_LOG(Gameplay, Error, "Hot reload: {}: {}, the loaded defs stay", source, error);
+        return false;
+    }
+    DefsUnits u = defs->units();
+    if (u.pos_scale != units.pos_scale || u.tick_rate != units.tick_rate) {
+        MOBA_LOG(Gameplay, Error, "Hot reload: {} was compiled for other units, the loaded defs stay", source);
+        return false;
+    }
+    batch.defs = std::move(defs);
+    batch.defs_source = source;
+    return true;
+}
+
+void HotReloadWatcher::publish(HotReloadBatch&& batch) {
+    std::lock_guard<std::mutex> lock(batch_mutex);
+    // the tick thread hasn't taken the previous batch yet: fold this one in, newest wins
+    for (ScriptReload& s : batch.scripts) {
+        auto it = std::lower_bound(next.scripts.begin(), next.scripts.end(), s.name,
+                                   [](ScriptReload const& a, std::string const& name) { return a.name < name; });
+        if (it != next.scripts.end() && it->name == s.name) *it = std::move(s);
+        else next.scripts.insert(it, std::move(s));
+    }
+    if (batch.defs) {
+        next.defs = std::move(batch.defs);
+        next.defs_source = std::move(batch.defs_source);
+    }
+    ready.store(true, std::memory_order_release);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "game_defs.h"
+
+// ---------- Script and defs hot reload ----------
+// A watcher thread follows the scripts root (abilities/, ScriptPusher's imported/, ...) and
+// game_defs.json/.bin next to it: inotify on Linux, ReadDirectoryChangesW on Windows, an
+// mtime scan elsewhere. Once a changed file has settled (HOT_RELOAD_SETTLE_MS without another
+// write) the thread does the expensive part itself: a script is compiled to bytecode in a
+// scratch Lua state (a syntax error is logged there and never reaches the match), the defs are
+// compiled or read and validated into a complete GameDefs. The result is published as one
+// HotReloadBatch; the tick thread takes it between ticks (DemoServer::runIdleWork) and only
+// loads bytecode and swaps refs and stat tables. While nothing changes, its cost is one
+// relaxed atomic load.
+//
+// Development only: a replay log records inputs, not reloads.
+
+constexpr uint32_t HOT_RELOAD_SETTLE_MS = 100; // editors write a file in several steps
+constexpr uint32_t HOT_RELOAD_POLL_MS = 250;   // mtime scan period where there is no file watch API
+
+struct ScriptReload {
+    std::string name;     // relative to the scripts root, as LuaBridge names it ("imported/foo.lua")
+    std::string path;
+    std::string bytecode; // LuaBridge::compileChunk output
+};
+
+struct HotReloadBatch {
+    std::vector<ScriptReload> scripts; // sorted by name
+    std::unique_ptr<GameDefs> defs;    // loaded and unit-checked, nullptr when the defs didn't change
+    std::string defs_source;           // the file it came from
+};
+
+class HotReloadWatcher {
+public:
+    // `defs_dir` holds game_defs.json/.bin, `scripts_root` the ability scripts (both ending in '/').
+    // Defs are compiled for `units` and rejected when a blob was built for others.
+    HotReloadWatcher(std::string defs_dir, std::string scripts_root, DefsUnits units);
+    ~HotReloadWatcher();
+
+    HotReloadWatcher(HotReloadWatcher const&) = delete;
+    HotReloadWatcher& operator=(HotReloadWatcher const&) = delete;
+
+    void start();
+    void stop();
+
+    // Tick thread, every idle slot: a batch is waiting
+    bool pending() const { return ready.load(std::memory_order_relaxed); }
+    // Tick thread: move the waiting batch out. False when there is none.
+    bool take(HotReloadBatch& out);
+
+private:
+    void run();
+    // changed paths accumulated since the last batch -> the next batch (off the tick thread)
+    void prepare(std::vector<std::string> const& changed);
+    bool prepareScript(std::string const& path, ScriptReload& out);
+    bool prepareDefs(HotReloadBatch& batch);
+    void publish(HotReloadBatch&& batch);
+
+    std::string defs_dir;
+    std::string scripts_root;
+    DefsUnits units;
+    std::unordered_map<std::string, uint64_t> source_hash; // last prepared content per file (skips touches)
+
+    std::thread thread;
+    std::atomic<bool> quit{false};
+    std::atomic<bool> ready{false};
+    std::mutex batch_mutex;
+    HotReloadBatch next; // under batch_mutex
+};
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "client_input.h"
+
+// ---------- InputQueue (tick-indexed ring, max 256) ----------
+// Fixed-capacity ring of INPUT_WINDOW_TICKS tick slots, each holding up to MAX_INPUTS_PER_TICK inputs.
+// An input lands in slot target_tick % INPUT_WINDOW_TICKS, so push and popForTick are O(1)
+// (plus a tiny sorted insert inside the slot) and nothing is ever allocated.
+constexpr uint32_t INPUT_WINDOW_TICKS = 32;   // ~1 s at 30 t/s of look-ahead
+constexpr uint32_t MAX_INPUTS_PER_TICK = 8;
+constexpr size_t MAX_CLIENT_INPUT_QUEUE = INPUT_WINDOW_TICKS * MAX_INPUTS_PER_TICK;
+
+enum class InputPushResult : uint8_t {
+    Accepted,
+    Duplicate, // same input_seq already queued (redundant resend), harmless
+    Stale,     // target tick already simulated
+    TooFar,    // target tick beyond the ring window
+    Full       // per-tick slot is full
+};
+
+// Non-owning view over the inputs of one tick. Valid until the ring slot is reused
+// (i.e. until an input for tick + INPUT_WINDOW_TICKS is pushed).
+struct InputSpan {
+    const ClientInput* data = nullptr;
+    size_t count = 0;
+
+    const ClientInput* begin() const { return data; }
+    const ClientInput* end() const { return data + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+};
+
+class InputQueue {
+public:
+    // `first_tick`: the first tick this queue will be popped for (a client joining mid-match
+    // starts at the current tick, otherwise its inputs would all be TooFar)
+    explicit InputQueue(uint32_t first_tick = 0) : next_tick(first_tick) { }
+
+    [[nodiscard]] InputPushResult push(ClientInput const& in) {
+        if (in.target_tick < next_tick) return InputPushResult::Stale;
+        if (in.target_tick - next_tick >= INPUT_WINDOW_TICKS) return InputPushResult::TooFar;
+
+        Slot& s = slots[in.target_tick % INPUT_WINDOW_TICKS];
+        if (s.tick != in.target_tick) {
+            // slot still holds an older (already consumed or never popped) tick
+            s.tick = in.target_tick;
+            s.count = 0;
+        }
+
+        // keep the slot sorted by input_seq: deterministic order no matter how packets were reordered
+        uint32_t pos = s.count;
+        while (pos > 0 && s.inputs[pos - 1].input_seq > in.input_seq) --pos;
+        if (pos > 0 && s.inputs[pos - 1].input_seq == in.input_seq) return InputPushResult::Duplicate;
+        if (s.count >= MAX_INPUTS_PER_TICK) return InputPushResult::Full;
+
+        for (uint32_t k = s.count; k > pos; --k) s.inputs[k] = s.inputs[k - 1];
+        s.inputs[pos] = in;
+        s.count++;
+        return InputPushResult::Accepted;
+    }
+
+    // Inputs targeting `tick`, in input_seq order. Marks every tick <= `tick` as consumed,
+    // so later inputs for them are rejected as Stale.
+    InputSpan popForTick(uint32_t tick) {
+        InputSpan res;
+        if (tick < next_tick) return res;
+        next_tick = tick + 1;
+
+        Slot& s = slots[tick % INPUT_WINDOW_TICKS];
+        if (s.tick != tick || s.count == 0) return res;
+
+        // the slot keeps its inputs until it is reused, so rewind() can pop the tick again
+        res.data = s.inputs;
+        res.count = s.count;
+        return res;
+    }
+
+    // Rollback: ticks >= `tick` become poppable (and pushable) again, keeping every input they
+    // had, including ones that arrived after they were first popped. A consumed tick's slot is
+    // reused by tick + INPUT_WINDOW_TICKS, so rewinding k ticks is exact as long as no input
+    // was queued more than INPUT_WINDOW_TICKS - k ticks ahead. False when `tick` is out of the window.
+    bool rewind(uint32_t tick) {
+        if (tick >= next_tick) return true;
+        if (next_tick - tick > INPUT_WINDOW_TICKS) return false;
+        next_tick = tick;
+        return true;
+    }
+
+    // inputs still waiting to be popped
+    size_t size() const {
+        size_t n = 0;
+        forEachQueued([&n](ClientInput const&) { ++n; });
+        return n;
+    }
+
+    // fn(ClientInput const&) for every input still waiting to be popped, by tick then input_seq
+    template <class Fn>
+    void forEachQueued(Fn&& fn) const {
+        for (uint32_t t = next_tick; t < next_tick + INPUT_WINDOW_TICKS; ++t) {
+            Slot const& s = slots[t % INPUT_WINDOW_TICKS];
+            if (s.tick != t) continue;
+            for (uint32_t k = 0; k < s.count; ++k) fn(s.inputs[k]);
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t tick = 0;
+        uint32_t count = 0;
+        ClientInput inputs[MAX_INPUTS_PER_TICK];
+    };
+
+    Slot slots[INPUT_WINDOW_TICKS];
+    uint32_t next_tick = 0; // first tick that has not been popped yet
+};
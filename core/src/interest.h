@@ -0,0 +1,92 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "entity.h"
+#include "physics.h"
+#include "snapshot.h"
+
+// ---------- Interest management ----------
+// A client is only sent what its team may know about: the team's own entities plus every
+// entity inside the vision radius of one of the team's characters (fog of war). Nothing else
+// reaches the encoder, so encode time and bandwidth follow what a player can see instead of
+// the map size, and hidden positions never go on the wire (nothing for a wallhack to read).
+//
+// Visibility is computed per team (all clients of a team share it) after every tick, with one
+// spatial grid query per vision source. Each tick's set stays in a ring beside the snapshot
+// ring, so a delta knows exactly which entities the client holds in its acked baseline: an
+// entity coming into view is sent in full (enter), one going out of view is sent as a
+// removal (leave), everything else as a normal delta.
+//
+// The set is rebuilt rather than patched per cell change: vision is an exact circle test, and
+// an entity moving inside its cell crosses that edge as often as one changing cells, so a
+// cell-driven update would either miss those or make fog of war cell-sized. The rebuild costs
+// one grid query per team character plus a pass over the ids; tick() no longer copies the
+// map for it (or anything else).
+constexpr uint32_t MAX_INTEREST_TEAMS = 8; // higher team ids (and TEAM_NEUTRAL) see everything
+
+struct InterestConfig {
+    int32_t vision_radius = 0; // fixed point, 0 = off: every client gets every entity
+};
+
+class TeamInterest {
+public:
+    // Visible set after `tick`. `scratch` is the caller's query buffer.
+    void update(uint32_t tick, uint8_t team, EntityStore const& s, SpatialGrid const& grid, int32_t vision,
+                std::vector<uint32_t>& scratch) {
+        work.clear();
+        for (uint32_t i = 0; i < s.size(); ++i) {
+            if (s.team[i] == team) work.push_back(s.id[i]);
+        }
+
+        EntityStore::Range chars = s.range(EntityType::Character);
+        for (uint32_t i = chars.begin; i < chars.end; ++i) {
+            if (s.team[i] != team) continue;
+            int32_t x = s.pos_x[i], y = s.pos_y[i];
+            grid.ForEachInRadius(x, y, vision, scratch, [&](uint32_t other_id) {
+                uint32_t j = s.find(other_id);
+                if (j != EntityStore::INVALID_INDEX && s.team[j] != team &&
+                    SpatialGrid::CheckCollision(x, y, vision, s.pos_x[j], s.pos_y[j], s.radius[j])) {
+                    work.push_back(other_id);
+                }
+                return true;
+            });
+        }
+        std::sort(work.begin(), work.end());
+        work.erase(std::unique(work.begin(), work.end()), work.end());
+
+        entered_ids.clear();
+        left_ids.clear();
+        static const std::vector<uint32_t> none;
+        std::vector<uint32_t> const* prev = tick > 0 ? visibleAt(tick - 1) : nullptr;
+        std::vector<uint32_t> const& before = prev ? *prev : none;
+        std::set_difference(work.begin(), work.end(), before.begin(), before.end(), std::back_inserter(entered_ids));
+        std::set_difference(before.begin(), before.end(), work.begin(), work.end(), std::back_inserter(left_ids));
+
+        Frame& f = frames[tick % SNAPSHOT_RING_SIZE];
+        f.tick = tick;
+        f.ids.swap(work); // the slot's old buffer becomes next tick's scratch
+    }
+
+    // ids visible after `tick` (ascending); nullptr when never computed or already overwritten
+    std::vector<uint32_t> const* visibleAt(uint32_t tick) const {
+        Frame const& f = frames[tick % SNAPSHOT_RING_SIZE];
+        return f.tick == tick ? &f.ids : nullptr;
+    }
+
+    // what the last update() changed against the tick before it
+    std::vector<uint32_t> const& entered() const { return entered_ids; }
+    std::vector<uint32_t> const& left() const { return left_ids; }
+
+private:
+    struct Frame {
+        uint32_t tick = NO_BASELINE;
+        std::vector<uint32_t> ids;
+    };
+
+    Frame frames[SNAPSHOT_RING_SIZE];
+    std::vector<uint32_t> work;
+    std::vector<uint32_t> entered_ids;
+    std::vector<uint32_t> left_ids;
+};
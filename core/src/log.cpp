@@ -0,0 +1,213 @@
+#include "log.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "mpsc_queue.h"
+
+std::atomic<uint8_t> Log::levels[static_cast<size_t>(LogCategory::Count)] = {
+    {static_cast<uint8_t>(LogLevel::Info)}, {static_cast<uint8_t>(LogLevel::Info)}, {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)}, {static_cast<uint8_t>(LogLevel::Info)}, {static_cast<uint8_t>(LogLevel::Info)},
+    {static_cast<uint8_t>(LogLevel::Info)}, {static_cast<uint8_t>(LogLevel::Info)},
+};
+std::atomic<uint64_t> Log::drop_count{0};
+
+namespace {
+
+constexpr size_t WRITE_CHUNK_BYTES = 64 * 1024; // text buffered per fwrite
+constexpr auto IDLE_SLEEP = std::chrono::milliseconds(1);
+
+// Never destroyed once created: a producer that saw `running` just before stop() still pushes
+// into live memory (its record is lost, nothing worse)
+struct Writer {
+    BoundedMpscQueue<LogRecord, LOG_RING_RECORDS> ring;
+    std::thread thread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> quit{false};
+    std::atomic<uint64_t> flushed{0}; // newest flush marker whose preceding lines are written
+    uint64_t next_marker = 0;         // under control
+    FILE* out = stdout;
+    FILE* err = stderr;
+};
+
+std::atomic<Writer*> writer{nullptr};
+std::mutex control;   // start/stop/flush
+std::mutex sync_lock; // synchronous fallback
+
+struct TextSink {
+    std::string out, err;
+
+    void add(LogRecord const& r, std::string& line) {
+        Log::format(r, line);
+        line += '\n';
+        (r.level >= static_cast<uint8_t>(LogLevel::Warn) ? err : out) += line;
+    }
+    void write(Writer const& w) {
+        if (!out.empty()) {
+            std::fwrite(out.data(), 1, out.size(), w.out);
+            std::fflush(w.out);
+            out.clear();
+        }
+        if (!err.empty()) {
+            std::fwrite(err.data(), 1, err.size(), w.err);
+            std::fflush(w.err);
+            err.clear();
+        }
+    }
+};
+
+void reportDrops(TextSink& sink, uint64_t& reported) {
+    uint64_t d = Log::dropped();
+    if (d == reported) return;
+    sink.err += "[Log] " + std::to_string(d - reported) + " records dropped (ring full)\n";
+    reported = d;
+}
+
+void writerLoop(Writer& w) {
+    TextSink sink;
+    std::string line;
+    uint64_t reported = Log::dropped();
+    for (;;) {
+        bool quitting = w.quit.load(std::memory_order_acquire); // read before the drain: stop() loses nothing
+        uint64_t marker = 0;
+        size_t popped = 0;
+        LogRecord r;
+        while (w.ring.try_pop(r)) {
+            ++popped;
+            if (!r.format) {
+                std::memcpy(&marker, r.payload, sizeof(marker));
+                continue;
+            }
+            sink.add(r, line);
+            if (sink.out.size() + sink.err.size() >= WRITE_CHUNK_BYTES) sink.write(w);
+        }
+        w.ring.publish();
+        reportDrops(sink, reported);
+        sink.write(w);
+        if (marker) w.flushed.store(marker, std::memory_order_release);
+        if (quitting) break;
+        if (popped == 0) std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+void appendArg(LogRecord const& r, size_t& at, std::string& line) {
+    if (at >= r.size) return;
+    LogArg tag = static_cast<LogArg>(r.payload[at]);
+    if (tag == LogArg::Str) {
+        uint16_t n;
+        std::memcpy(&n, r.payload + at + 1, sizeof(n));
+        line.append(reinterpret_cast<const char*>(r.payload + at + 3), n);
+        at += 3 + n;
+        return;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, r.payload + at + 1, sizeof(bits));
+    at += 9;
+    char buf[32];
+    switch (tag) {
+        case LogArg::Int: std::snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(bits)); break;
+        case LogArg::UInt: std::snprintf(buf, sizeof(buf), "%llu", static_cast<unsigned long long>(bits)); break;
+        case LogArg::Hex: std::snprintf(buf, sizeof(buf), "%llx", static_cast<unsigned long long>(bits)); break;
+        case LogArg::Float: {
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            std::snprintf(buf, sizeof(buf), "%g", d); // what an ostream prints by default
+            break;
+        }
+        default: buf[0] = '\0'; break;
+    }
+    line += buf;
+}
+
+} // namespace
+
+const char* Log::categoryName(LogCategory c) {
+    switch (c) {
+        case LogCategory::App: return "";
+        case LogCategory::Gameplay: return "Gameplay";
+        case LogCategory::Combat: return "Combat";
+        case LogCategory::Physics: return "Physics";
+        case LogCategory::Lua: return "Lua";
+        case LogCategory::Net: return "Net";
+        case LogCategory::Replay: return "Replay";
+        case LogCategory::Desync: return "Desync";
+        default: return "?";
+    }
+}
+
+void Log::format(LogRecord const& r, std::string& line) {
+    line.clear();
+    const char* name = categoryName(static_cast<LogCategory>(r.category));
+    if (*name) {
+        line += '[';
+        line += name;
+        line += "] ";
+    }
+    size_t at = 0;
+    uint32_t args_left = r.arg_count;
+    for (const char* p = r.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}' && args_left > 0) {
+            appendArg(r, at, line);
+            --args_left;
+            ++p;
+            continue;
+        }
+        line += *p;
+    }
+}
+
+void Log::submit(LogRecord const& r) {
+    Writer* w = writer.load(std::memory_order_acquire);
+    if (w && w->running.load(std::memory_order_acquire)) {
+        if (!w->ring.try_push(r)) drop_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // no writer (tools, before start()): format right here
+    std::lock_guard<std::mutex> lock(sync_lock);
+    static std::string line;
+    format(r, line);
+    line += '\n';
+    FILE* f = r.level >= static_cast<uint8_t>(LogLevel::Warn) ? (w ? w->err : stderr) : (w ? w->out : stdout);
+    std::fwrite(line.data(), 1, line.size(), f);
+}
+
+void Log::start(FILE* out, FILE* err) {
+    std::lock_guard<std::mutex> lock(control);
+    if (!writer.load(std::memory_order_relaxed)) writer.store(new Writer(), std::memory_order_release);
+    Writer& w = *writer.load(std::memory_order_relaxed);
+    if (w.running.load(std::memory_order_relaxed)) return;
+    std::fflush(stdout); // whatever was printed before goes out first
+    w.out = out;
+    w.err = err;
+    w.quit.store(false, std::memory_order_relaxed);
+    w.running.store(true, std::memory_order_release);
+    w.thread = std::thread(writerLoop, std::ref(w));
+}
+
+void Log::stop() {
+    std::lock_guard<std::mutex> lock(control);
+    Writer* wp = writer.load(std::memory_order_relaxed);
+    if (!wp || !wp->running.load(std::memory_order_relaxed)) return;
+    Writer& w = *wp;
+    w.running.store(false, std::memory_order_release);
+    w.quit.store(true, std::memory_order_release);
+    w.thread.join();
+}
+
+void Log::flush() {
+    std::lock_guard<std::mutex> lock(control);
+    Writer* wp = writer.load(std::memory_order_relaxed);
+    if (!wp || !wp->running.load(std::memory_order_acquire)) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+        return;
+    }
+    Writer& w = *wp;
+    LogRecord marker;
+    marker.format = nullptr;
+    marker.size = 0;
+    marker.arg_count = 0;
+    uint64_t id = ++w.next_marker;
+    std::memcpy(marker.payload, &id, sizeof(id));
+    while (!w.ring.try_push(marker)) std::this_thread::yield();
+    while (w.flushed.load(std::memory_order_acquire) < id) std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
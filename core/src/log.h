@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// ---------- Async binary log ----------
+// Nothing is formatted where it is logged. A call site copies its arguments as tagged binary
+// values (strings by value, truncated to fit) into one fixed-size record and pushes it into a
+// lock-free MPSC ring (mpsc_queue.h); a background writer thread pops records, turns them into
+// text and writes them out. A slow stdout or log pipe can fill the ring but never stalls the
+// tick: a full ring drops the record (counted, reported by the writer).
+//
+//   MOBA_LOG(Combat, Info, "Entity {} took {} final dmg", id, dmg);
+//
+// The format is a string literal with {} placeholders (it is kept by pointer, not copied).
+// Each category has a compile-time floor (MOBA_LOG_MIN_LEVEL, or MOBA_LOG_MIN_<CATEGORY>):
+// below it the call compiles to nothing, arguments included. Above it a runtime level per
+// category (Log::setLevel) costs one relaxed load. Until Log::start() (tools, early startup)
+// records are formatted and written synchronously instead.
+//
+// Lines are "[Category] text" (App has no prefix); Warn and above go to stderr.
+
+enum class LogLevel : uint8_t { Trace, Debug, Info, Warn, Error, Off };
+
+enum class LogCategory : uint8_t { App, Gameplay, Combat, Physics, Lua, Net, Replay, Desync, Count };
+
+#ifndef MOBA_LOG_MIN_LEVEL
+#define MOBA_LOG_MIN_LEVEL 0 // everything compiled in; a release build can raise it (CMake MOBA_LOG_MIN_LEVEL)
+#endif
+#ifndef MOBA_LOG_MIN_APP
+#define MOBA_LOG_MIN_APP MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_GAMEPLAY
+#define MOBA_LOG_MIN_GAMEPLAY MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_COMBAT
+#define MOBA_LOG_MIN_COMBAT MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_PHYSICS
+#define MOBA_LOG_MIN_PHYSICS MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_LUA
+#define MOBA_LOG_MIN_LUA MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_NET
+#define MOBA_LOG_MIN_NET MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_REPLAY
+#define MOBA_LOG_MIN_REPLAY MOBA_LOG_MIN_LEVEL
+#endif
+#ifndef MOBA_LOG_MIN_DESYNC
+#define MOBA_LOG_MIN_DESYNC MOBA_LOG_MIN_LEVEL
+#endif
+
+constexpr uint8_t LOG_COMPILED_MIN[static_cast<size_t>(LogCategory::Count)] = {
+    MOBA_LOG_MIN_APP,  MOBA_LOG_MIN_GAMEPLAY, MOBA_LOG_MIN_COMBAT, MOBA_LOG_MIN_PHYSICS,
+    MOBA_LOG_MIN_LUA,  MOBA_LOG_MIN_NET,      MOBA_LOG_MIN_REPLAY, MOBA_LOG_MIN_DESYNC,
+};
+
+constexpr bool logCompiledIn(LogCategory c, LogLevel l) {
+    return l != LogLevel::Off && static_cast<uint8_t>(l) >= LOG_COMPILED_MIN[static_cast<size_t>(c)];
+}
+
+#define MOBA_LOG(category, level, ...)                                                               \
+    do {                                                                                             \
+        if constexpr (logCompiledIn(LogCategory::category, LogLevel::level)) {                       \
+            if (Log::enabled(LogCategory::category, LogLevel::level))                                \
+                Log::write(LogCategory::category, LogLevel::level, __VA_ARGS__);                     \
+        }                                                                                            \
+    } while (0)
+
+// Argument printed as lowercase hex (state hashes)
+struct LogHex {
+    uint64_t value;
+};
+
+constexpr size_t LOG_RECORD_BYTES = 256;
+constexpr size_t LOG_RING_RECORDS = 4096; // 1 MB; a power of two (BoundedMpscQueue)
+
+// One log call, as queued. Payload: per argument a LogArg tag, then 8 bytes (numbers) or a
+// 16-bit length and the bytes (strings).
+struct LogRecord {
+    const char* format; // nullptr: flush marker, the payload holds its sequence number
+    uint8_t category;
+    uint8_t level;
+    uint8_t arg_count;
+    uint8_t size; // payload bytes used
+    uint8_t payload[LOG_RECORD_BYTES - sizeof(const char*) - 4];
+};
+static_assert(sizeof(LogRecord) == LOG_RECORD_BYTES, "LogRecord must stay one fixed-size ring slot");
+
+enum class LogArg : uint8_t { Int, UInt, Float, Hex, Str };
+
+class Log {
+public:
+    // Start the writer thread (idempotent). `out` gets levels below Warn, `err` the rest.
+    static void start(FILE* out = stdout, FILE* err = stderr);
+    // Drain everything queued so far, write it, join the writer; later records go synchronous
+    static void stop();
+    // Block until every record pushed before the call has been written (then a direct
+    // printf/std::cout can't overtake queued lines)
+    static void flush();
+
+    static void setLevel(LogCategory c, LogLevel l) { levels[static_cast<size_t>(c)].store(static_cast<uint8_t>(l), std::memory_order_relaxed); }
+    static void setLevel(LogLevel l) {
+        for (size_t c = 0; c < static_cast<size_t>(LogCategory::Count); ++c) setLevel(static_cast<LogCategory>(c), l);
+    }
+    static bool enabled(LogCategory c, LogLevel l) {
+        return static_cast<uint8_t>(l) >= levels[static_cast<size_t>(c)].load(std::memory_order_relaxed);
+    }
+
+    // records lost to a full ring since start
+    static uint64_t dropped() { return drop_count.load(std::memory_order_relaxed); }
+
+    template<typename... Args>
+    static void write(LogCategory c, LogLevel l, const char* format, Args const&... args) {
+        LogRecord r;
+        r.format = format;
+        r.category = static_cast<uint8_t>(c);
+        r.level = static_cast<uint8_t>(l);
+        r.arg_count = 0;
+        r.size = 0;
+        (encode(r, args), ...);
+        submit(r);
+    }
+
+    // "[Category] text" without the newline, as the writer prints it
+    static void format(LogRecord const& r, std::string& line);
+    static const char* categoryName(LogCategory c);
+
+private:
+    static void submit(LogRecord const& r);
+
+    static bool reserve(LogRecord& r, size_t n) {
+        if (r.size + n > sizeof(r.payload)) return false; // out of room: this and later args are dropped
+        return true;
+    }
+    static void encodeWord(LogRecord& r, LogArg tag, uint64_t bits) {
+        if (!reserve(r, 9)) return;
+        r.payload[r.size] = static_cast<uint8_t>(tag);
+        std::memcpy(r.payload + r.size + 1, &bits, sizeof(bits));
+        r.size = static_cast<uint8_t>(r.size + 9);
+        ++r.arg_count;
+    }
+    static void encodeStr(LogRecord& r, std::string_view s) {
+        if (!reserve(r, 3)) return;
+        size_t room = sizeof(r.payload) - r.size - 3;
+        uint16_t n = static_cast<uint16_t>(s.size() < room ? s.size() : room);
+        r.payload[r.size] = static_cast<uint8_t>(LogArg::Str);
+        std::memcpy(r.payload + r.size + 1, &n, sizeof(n));
+        std::memcpy(r.payload + r.size + 3, s.data(), n);
+        r.size = static_cast<uint8_t>(r.size + 3 + n);
+        ++r.arg_count;
+    }
+
+    template<typename T>
+    static void encode(LogRecord& r, T const& v) {
+        if constexpr (std::is_same_v<T, LogHex>) {
+            encodeWord(r, LogArg::Hex, v.value);
+        } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+            encodeStr(r, v ? std::string_view(v) : std::string_view("(null)"));
+        } else if constexpr (std::is_same_v<T, bool>) {
+            encodeWord(r, LogArg::UInt, v ? 1 : 0);
+        } else if constexpr (std::is_enum_v<T>) {
+            encode(r, static_cast<std::underlying_type_t<T>>(v));
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            encodeWord(r, LogArg::Int, static_cast<uint64_t>(static_cast<int64_t>(v)));
+        } else if constexpr (std::is_integral_v<T>) {
+            encodeWord(r, LogArg::UInt, static_cast<uint64_t>(v));
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double d = static_cast<double>(v);
+            uint64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            encodeWord(r, LogArg::Float, bits);
+        } else {
+            static_assert(std::is_convertible_v<T const&, std::string_view>, "MOBA_LOG: unsupported argument type");
+            encodeStr(r, std::string_view(v));
+        }
+    }
+
+    static std::atomic<uint8_t> levels[static_cast<size_t>(LogCategory::Count)];
+    static std::atomic<uint64_t> drop_count;
+};
@@ -0,0 +1,122 @@
+#include "lua_alloc.h"
+#include <cstdlib>
+#include <cstring>
+
+LuaPoolAllocator::~LuaPoolAllocator() {
+    for (void* s : slabs) std::free(s);
+}
+
+void* LuaPoolAllocator::alloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+    LuaPoolAllocator* self = static_cast<LuaPoolAllocator*>(ud);
+    if (nsize == 0) {
+        if (ptr) self->release(ptr, osize);
+        return nullptr;
+    }
+    // with ptr == NULL, osize is the object type tag, not a size
+    if (!ptr) return self->allocate(nsize, true);
+    return self->reallocate(ptr, osize, nsize);
+}
+
+void* LuaPoolAllocator::allocate(size_t size, bool enforce_limit) {
+    if (enforce_limit && limit != 0 && st.bytes_in_use + size > limit) {
+        ++st.failed_allocs;
+        return nullptr;
+    }
+
+    void* p;
+    if (size <= POOL_MAX_BYTES) {
+        size_t cls = classOf(size);
+        if (!free_lists[cls] && !refill(cls)) {
+            ++st.failed_allocs;
+            return nullptr;
+        }
+        FreeNode* n = free_lists[cls];
+        free_lists[cls] = n->next;
+        p = n;
+        ++st.pooled_allocs;
+    } else {
+        p = std::malloc(size);
+        if (!p) {
+            ++st.failed_allocs;
+            return nullptr;
+        }
+        ++st.large_allocs;
+    }
+
+    st.bytes_in_use += size;
+    if (st.bytes_in_use > st.peak_bytes) st.peak_bytes = st.bytes_in_use;
+    return p;
+}
+
+void LuaPoolAllocator::release(void* ptr, size_t size) {
+    st.bytes_in_use -= size;
+    if (size <= POOL_MAX_BYTES) {
+        FreeNode* n = static_cast<FreeNode*>(ptr);
+        size_t cls = classOf(size);
+        n->next = free_lists[cls];
+        free_lists[cls] = n;
+    } else {
+        std::free(ptr);
+    }
+}
+
+void* LuaPoolAllocator::reallocate(void* ptr, size_t osize, size_t nsize) {
+    bool old_pooled = osize <= POOL_MAX_BYTES;
+    bool new_pooled = nsize <= POOL_MAX_BYTES;
+
+    // shrinking never fails (Lua relies on that), growing respects the limit
+    if (nsize > osize && limit != 0 && st.bytes_in_use + (nsize - osize) > limit) {
+        ++st.failed_allocs;
+        return nullptr;
+    }
+
+    if (old_pooled && new_pooled && classOf(osize) == classOf(nsize)) {
+        st.bytes_in_use = st.bytes_in_use - osize + nsize;
+        if (st.bytes_in_use > st.peak_bytes) st.peak_bytes = st.bytes_in_use;
+        return ptr; // same slot fits both
+    }
+
+    if (!old_pooled && !new_pooled) {
+        void* p = std::realloc(ptr, nsize);
+        if (!p) {
+            ++st.failed_allocs;
+            return nullptr;
+        }
+        ++st.large_allocs;
+        st.bytes_in_use = st.bytes_in_use - osize + nsize;
+        if (st.bytes_in_use > st.peak_bytes) st.peak_bytes = st.bytes_in_use;
+        return p;
+    }
+
+    // crossing a class: move the block (a failed move leaves the old block untouched)
+    bool shrinking = nsize < osize;
+    void* p = allocate(nsize, !shrinking);
+    if (!p) {
+        if (!shrinking) return nullptr;
+        // don't fail a shrink (only reachable when a slab can't be malloc'ed): the big block
+        // stays and, once freed at its new size, simply becomes a slot of the smaller class
+        st.bytes_in_use = st.bytes_in_use - osize + nsize;
+        return ptr;
+    }
+    std::memcpy(p, ptr, osize < nsize ? osize : nsize);
+    release(ptr, osize);
+    return p;
+}
+
+bool LuaPoolAllocator::refill(size_t cls) {
+    size_t slot = (cls + 1) * POOL_GRANULE;
+    char* slab = static_cast<char*>(std::malloc(POOL_BLOCK_BYTES));
+    if (!slab) return false;
+    slabs.push_back(slab);
+    st.reserved_bytes += POOL_BLOCK_BYTES;
+
+    size_t count = POOL_BLOCK_BYTES / slot;
+    FreeNode* head = free_lists[cls];
+    for (size_t k = count; k > 0; --k) {
+        FreeNode* n = reinterpret_cast<FreeNode*>(slab + (k - 1) * slot);
+        n->next = head;
+        head = n;
+    }
+    free_lists[cls] = head;
+    return true;
+}
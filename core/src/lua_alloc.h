@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------- Lua VM allocator ----------
+// lua_Alloc backed by per-size-class free lists. Almost everything a script allocates per cast
+// (small tables, closures, short strings) is <= POOL_MAX_BYTES and gets recycled from the
+// lists without touching malloc; bigger blocks (array parts, long strings) go to realloc().
+// Blocks are carved from POOL_BLOCK_BYTES slabs and only returned to the OS when the VM is gone.
+// One instance per lua_State, not thread-safe (the VM isn't either).
+
+constexpr size_t POOL_GRANULE = 16;
+constexpr size_t POOL_MAX_BYTES = 512;
+constexpr size_t POOL_CLASS_COUNT = POOL_MAX_BYTES / POOL_GRANULE;
+constexpr size_t POOL_BLOCK_BYTES = 64 * 1024;
+
+struct LuaMemoryStats {
+    size_t bytes_in_use = 0;    // what Lua asked for (nsize), pooled and large
+    size_t peak_bytes = 0;
+    size_t reserved_bytes = 0;  // slab bytes held by the pools
+    uint64_t pooled_allocs = 0;
+    uint64_t large_allocs = 0;
+    uint64_t failed_allocs = 0; // over the limit (or out of memory): Lua raises "not enough memory"
+};
+
+class LuaPoolAllocator {
+public:
+    explicit LuaPoolAllocator(size_t limit_bytes = 0) : limit(limit_bytes) {}
+    ~LuaPoolAllocator();
+
+    LuaPoolAllocator(LuaPoolAllocator const&) = delete;
+    LuaPoolAllocator& operator=(LuaPoolAllocator const&) = delete;
+
+    // lua_Alloc entry point, `ud` is the LuaPoolAllocator
+    static void* alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+    // 0 = unlimited. Allocations that would exceed it fail (Lua turns that into an error).
+    void setLimit(size_t limit_bytes) { limit = limit_bytes; }
+    LuaMemoryStats const& stats() const { return st; }
+
+private:
+    struct FreeNode { FreeNode* next; };
+
+    static size_t classOf(size_t size) { return (size + POOL_GRANULE - 1) / POOL_GRANULE - 1; }
+
+    void* allocate(size_t size, bool enforce_limit);
+    void release(void* ptr, size_t size);
+    void* reallocate(void* ptr, size_t osize, size_t nsize);
+    bool refill(size_t cls);
+
+    FreeNode* free_lists[POOL_CLASS_COUNT] = {};
+    std::vector<void*> slabs;
+    size_t limit;
+    LuaMemoryStats st;
+};
@@ -1,96 +1,513 @@
 #include "lua_bridge.h"
-#include <iostream>
+#include "game_defs.h"
+#include "log.h"
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
-// ---- Engine integration stubs (MUST BE IMPLEMENTED) ----
-// Replace them with the engine functions from the deterministic_sim.cpp.
-// They are declared extern here can be implemented in engine code.
-
-extern "C" {
-extern bool Engine_GetPosition(int entity_id, float &out_x, float &out_y);
-extern bool Engine_SetMovement(int entity_id, float vx, float vy);
-extern bool Engine_ApplyDamage(int source_id, int target_id, int amount, const char* damage_type);
-extern bool Engine_ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration);
+// lua_pop is (L,n) (n >= 1)
+// other operations read specific values (-1 is the newest, 1 is the oldest = not so usual)
 
-// returns new projectile entity id (>0) or -1 on error
-extern int Engine_SpawnProjectile(int caster_id, float spawn_x, float spawn_y, float dir_x, float dir_y, float speed, float radius, float life_time, const char* on_hit_cb);
+static int LuaPanic(lua_State* L) {
+    const char* msg = lua_tostring(L, -1);
+    MOBA_LOG(Lua, Error, "PANIC: unprotected error: {}", msg ? msg : "?");
+    Log::flush(); // Lua aborts right after
+    return 0; // Lua aborts
 }
 
-// -------------------------------------------------------------
-
-// lua_pop is (L,n) (n >= 1)
-// other operations read specific values (-1 is the newest, 1 is the oldest = not so usual)
+// print() for every script: the stock tab-separated line, but into the log instead of a
+// blocking write to stdout from the tick thread
+static int LuaPrint(lua_State* L) {
+    static thread_local std::string line;
+    line.clear();
+    int n = lua_gettop(L);
+    for (int i = 1; i <= n; ++i) {
+        size_t len;
+        const char* s = luaL_tolstring(L, i, &len);
+        if (i > 1) line += '\t';
+        line.append(s, len);
+        lua_pop(L,1);
+    }
+    MOBA_LOG(Lua, Info, "{}", line);
+    return 0;
+}
 
-LuaBridge::LuaBridge() {
-    L = luaL_newstate();
+LuaBridge::LuaBridge(ScriptHost* host) : host(host) {
+    // pooled allocator instead of luaL_newstate()'s realloc one
+    L = lua_newstate(LuaPoolAllocator::alloc, &allocator);
+    lua_atpanic(L, LuaPanic);
     luaL_openlibs(L); // open standard libs (optionally restrict in prod)
 
+    // generational (cast garbage dies young), driven only by collectGarbage()
+    lua_gc(L, LUA_GCGEN, 0, 0);
+    lua_gc(L, LUA_GCSTOP);
+
     // register bindings
     registerCoreBindings();
+
+    // default cast_batch (and on_hit_batch): one pcall per entry stays inside the VM, so a batch
+    // is a single crossing
+    static const char BATCH_RUNNER[] =
+        "local pcall = pcall\n"
+        "return function(cast)\n"
+        "  return function(n, casters, xs, ys)\n"
+        "    local errors, first_error = 0, nil\n"
+        "    for i = 1, n do\n"
+        "      local ok, err = pcall(cast, casters[i], xs[i], ys[i])\n"
+        "      if not ok then\n"
+        "        errors = errors + 1\n"
+        "        first_error = first_error or err\n"
+        "      end\n"
+        "    end\n"
+        "    return errors, first_error\n"
+        "  end\n"
+        "end\n";
+    if (luaL_loadbufferx(L, BATCH_RUNNER, sizeof(BATCH_RUNNER) - 1, "=cast_batch", "t") == LUA_OK &&
+        lua_pcall(L, 0, 1, 0) == LUA_OK) {
+        batch_runner_factory = luaL_ref(L, LUA_REGISTRYINDEX);
+    } else {
+        MOBA_LOG(Lua, Error, "Error building the cast batch runner: {}", lua_tostring(L, -1));
+        lua_pop(L,1);
+    }
+    lua_newtable(L);
+    batch_casters = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_newtable(L);
+    batch_x = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_newtable(L);
+    batch_y = luaL_ref(L, LUA_REGISTRYINDEX);
 }
 
 LuaBridge::~LuaBridge() {
     if (L) lua_close(L);
 }
 
+bool LuaBridge::collectGarbage(uint64_t slack_ns) {
+    size_t in_use = allocator.stats().bytes_in_use;
+    size_t garbage = in_use > gc_baseline_bytes ? in_use - gc_baseline_bytes : 0;
+    if (garbage == 0) return false;
+
+    bool forced = garbage >= GC_FORCE_BYTES;
+    if (slack_ns < gc_budget_ns && !forced) {
+        ++gc_stats.gc_skipped;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    lua_gc(L, LUA_GCSTEP, 0); // steps even while stopped (minor collection, major when due)
+    uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    ++gc_stats.gc_steps;
+    if (forced && slack_ns < gc_budget_ns) ++gc_stats.gc_forced;
+    gc_stats.gc_ns_total += ns;
+    if (ns > gc_stats.gc_ns_max) gc_stats.gc_ns_max = ns;
+    gc_baseline_bytes = allocator.stats().bytes_in_use;
+    return true;
+}
+
+LuaVmStats LuaBridge::vmStats() const {
+    LuaVmStats s = gc_stats;
+    s.memory = allocator.stats();
+    return s;
+}
+
 bool LuaBridge::doFile(const std::string &path) {
     if (luaL_dofile(L, path.c_str()) != LUA_OK) {
-        std::cerr << "[Lua] Error loading file: " << lua_tostring(L, -1) << std::endl;
+        MOBA_LOG(Lua, Error, "Error loading file: {}", lua_tostring(L, -1));
         lua_pop(L,1);
         return false;
     }
     return true;
 }
 
-bool LuaBridge::callCastFunction(const std::string &fnName, int caster_id, float target_x, float target_y) {
-    lua_getglobal(L, fnName.c_str()); // push function
+// ------------------- Ability scripts --------------------
+
+LuaRef LuaBridge::resolveFunction(const char* global_name) {
+    lua_getglobal(L, global_name);
     if (!lua_isfunction(L, -1)) {
         lua_pop(L,1);
-        std::cerr << "[Lua] Function not found: " << fnName << std::endl;
-        return false;
+        return LUA_NOREF;
     }
+    return luaL_ref(L, LUA_REGISTRYINDEX); // pops the function
+}
 
-    lua_pushinteger(L, caster_id);
-    lua_pushnumber(L, target_x);
-    lua_pushnumber(L, target_y);
+// ---- Bytecode cache ----
+// Key = FNV-1a of the source plus the bytecode format (Lua version and number sizes),
+// so a changed script or a different Lua build never picks up stale bytecode.
+
+static uint64_t HashScript(const std::string &src) {
+    uint64_t h = 1469598103934665603ull;
+    auto mix = [&h](unsigned char c) { h ^= c; h *= 1099511628211ull; };
+    for (unsigned char c : src) mix(c);
+    mix(static_cast<unsigned char>(LUA_VERSION_NUM & 0xFF));
+    mix(static_cast<unsigned char>(LUA_VERSION_NUM >> 8));
+    mix(static_cast<unsigned char>(sizeof(lua_Number)));
+    mix(static_cast<unsigned char>(sizeof(lua_Integer)));
+    return h;
+}
 
-    // call function with 3 args, 1 result and no custom error handler
-    // lua p_call(L, n-args, n-results, errfunc)
-    if (lua_pcall(L, 3, 1, 0) != LUA_OK) {
-        std::cerr << "[Lua] Error calling function: " << lua_tostring(L, -1) << std::endl;
-        lua_pop(L,1);
+// process-wide: every match's LuaBridge shares what the first one compiled
+static std::mutex s_bytecode_mutex;
+static std::unordered_map<uint64_t, std::string> s_bytecode;
+
+static int DumpWriter(lua_State*, const void* p, size_t sz, void* ud) {
+    static_cast<std::string*>(ud)->append(static_cast<const char*>(p), sz);
+    return 0;
+}
+
+static bool ReadFile(const std::string &path, std::string &out) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) return false;
+    out.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool LuaBridge::loadChunk(const std::string &path) {
+    std::string src;
+    if (!ReadFile(path, src)) {
+        MOBA_LOG(Lua, Error, "Error loading file: cannot open {}", path);
         return false;
     }
+    uint64_t key = HashScript(src);
+    std::string chunkname = "@" + path; // keeps file:line in error messages
+
+    std::string bytecode;
+    {
+        std::lock_guard<std::mutex> lock(s_bytecode_mutex);
+        auto it = s_bytecode.find(key);
+        if (it != s_bytecode.end()) bytecode = it->second;
+    }
+    if (!bytecode.empty()) {
+        if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") == LUA_OK) {
+            ++load_stats.memory_hits;
+            return true;
+        }
+        lua_pop(L,1);
+    }
+
+    std::string cache_file;
+    if (!bytecode_dir.empty()) {
+        std::ostringstream name;
+        name << bytecode_dir << "/" << std::hex << key << ".luac";
+        cache_file = name.str();
+        if (ReadFile(cache_file, bytecode)) {
+            if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") == LUA_OK) {
+                std::lock_guard<std::mutex> lock(s_bytecode_mutex);
+                s_bytecode[key] = bytecode;
+                ++load_stats.disk_hits;
+                return true;
+            }
+            lua_pop(L,1); // truncated/foreign file: recompile and overwrite it
+        }
+    }
 
-    // Now top of stack is the returned Lua table (or something)
-    if (!lua_istable(L, -1)) {
-        std::cerr << "[Lua] Expected table result from cast, got something else." << std::endl;
+    // cache miss: parse the source once, then keep its bytecode
+    if (luaL_loadbufferx(L, src.data(), src.size(), chunkname.c_str(), "t") != LUA_OK) {
+        MOBA_LOG(Lua, Error, "Error loading file: {}", lua_tostring(L, -1));
         lua_pop(L,1);
         return false;
     }
+    ++load_stats.compiled;
 
-    // -- EXAMPLE: Reading "damage" of the ability --
-    lua_getfield(L, -1, "damage");
-    if (!lua_isnumber(L, -1)) {
-        lua_pop(L,2); // pops the field value + the table
-        std::cerr << "[Lua] ability.damage missing or not a number\n";
+    bytecode.clear();
+    if (lua_dump(L, DumpWriter, &bytecode, 0) == 0 && !bytecode.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(s_bytecode_mutex);
+            s_bytecode[key] = bytecode;
+        }
+        if (!cache_file.empty()) {
+            std::error_code ec;
+            std::filesystem::create_directories(bytecode_dir, ec);
+            std::ofstream out(cache_file, std::ios::binary | std::ios::trunc);
+            if (out.is_open()) out.write(bytecode.data(), static_cast<std::streamsize>(bytecode.size()));
+        }
+    }
+    return true;
+}
+
+AbilityHandle LuaBridge::loadAbility(const std::string &name, const std::string &path) {
+    if (abilities.size() >= INVALID_ABILITY) return INVALID_ABILITY;
+    if (!loadChunk(path)) return INVALID_ABILITY; // [chunk]
+    return installChunk(name, path, INVALID_ABILITY);
+}
+
+bool LuaBridge::compileChunk(const std::string &src, const std::string &path, std::string &bytecode, std::string &error) {
+    lua_State* scratch = luaL_newstate(); // never touches a match VM, so any thread can compile
+    if (!scratch) {
+        error = "cannot create a Lua state";
         return false;
     }
-    int damage = (int)lua_tointeger(L, -1);
-    lua_pop(L,1);
+    std::string chunkname = "@" + path;
+    bool ok = luaL_loadbufferx(scratch, src.data(), src.size(), chunkname.c_str(), "t") == LUA_OK;
+    if (!ok) {
+        error = lua_tostring(scratch, -1);
+    } else {
+        bytecode.clear();
+        ok = lua_dump(scratch, DumpWriter, &bytecode, 0) == 0 && !bytecode.empty();
+        if (!ok) error = "cannot dump bytecode";
+    }
+    lua_close(scratch);
+    return ok;
+}
 
-    std::cout << "[C++] Lua reported damage = " << damage << std::endl;
+AbilityHandle LuaBridge::reloadAbility(const std::string &name, const std::string &path, const std::string &bytecode) {
+    AbilityHandle h = findAbility(name);
+    if (h == INVALID_ABILITY && abilities.size() >= INVALID_ABILITY) return INVALID_ABILITY;
+    std::string chunkname = "@" + path;
+    if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(), chunkname.c_str(), "b") != LUA_OK) {
+        MOBA_LOG(Lua, Error, "Error loading file: {}", lua_tostring(L, -1));
+        lua_pop(L,1);
+        return INVALID_ABILITY;
+    }
+    return installChunk(name, path, h);
+}
 
-    lua_pop(L,1);
+size_t LuaBridge::reloadAbilities() {
+    size_t reloaded = 0;
+    for (size_t i = 0; i < abilities.size(); ++i) {
+        std::string name = abilities[i].name, path = abilities[i].path; // the slot is replaced below
+        if (!loadChunk(path)) continue;
+        if (installChunk(name, path, static_cast<AbilityHandle>(i)) != INVALID_ABILITY) ++reloaded;
+    }
+    return reloaded;
+}
+
+void LuaBridge::releaseScript(AbilityScript &script) {
+    for (LuaRef ref : {script.cast, script.on_hit, script.cast_batch, script.on_hit_batch, script.on_apply, script.on_expire, script.env}) {
+        if (ref != LUA_NOREF) luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    }
+    script.cast = script.on_hit = script.cast_batch = script.on_hit_batch = script.on_apply = script.on_expire = script.env = LUA_NOREF;
+}
+
+AbilityHandle LuaBridge::installChunk(const std::string &name, const std::string &path, AbilityHandle slot) {
+    // private _ENV = setmetatable({}, { __index = _G }): reads fall through to the engine
+    // bindings and stdlib, every global the script defines stays in its own table
+    lua_newtable(L);                  // [chunk, env]
+    lua_newtable(L);                  // [chunk, env, mt]
+    lua_pushglobaltable(L);
+    lua_setfield(L, -2, "__index");
+    lua_setmetatable(L, -2);          // [chunk, env]
+    lua_pushvalue(L, -1);
+    LuaRef env = luaL_ref(L, LUA_REGISTRYINDEX);
+    lua_setupvalue(L, -2, 1);         // chunk's first upvalue is _ENV; [chunk]
+
+    if (lua_pcall(L, 0, 0, 0) != LUA_OK) {
+        MOBA_LOG(Lua, Error, "Error running {}: {}", path, lua_tostring(L, -1));
+        lua_pop(L,1);
+        luaL_unref(L, LUA_REGISTRYINDEX, env);
+        return INVALID_ABILITY;
+    }
+
+    AbilityScript script;
+    script.name = name;
+    script.path = path;
+    script.env = env;
+    auto pin = [this, env](const char* field) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, env);
+        lua_getfield(L, -1, field);
+        LuaRef ref = LUA_NOREF;
+        if (lua_isfunction(L, -1)) ref = luaL_ref(L, LUA_REGISTRYINDEX); // pops the function
+        else lua_pop(L,1);
+        lua_pop(L,1); // env
+        return ref;
+    };
+    script.cast = pin("cast");
+    script.on_hit = pin("on_hit");
+    script.on_apply = pin("on_apply");
+    script.on_expire = pin("on_expire");
+
+    if (script.cast == LUA_NOREF) {
+        MOBA_LOG(Lua, Warn, "{} defines no cast function", path);
+        releaseScript(script);
+        return INVALID_ABILITY;
+    }
+
+    auto runner = [this](LuaRef fn) {
+        if (batch_runner_factory == LUA_NOREF) return LUA_NOREF;
+        lua_rawgeti(L, LUA_REGISTRYINDEX, fn);
+        return callRef(batch_runner_factory, 1, 1, "batch runner") ? luaL_ref(L, LUA_REGISTRYINDEX) : LUA_NOREF;
+    };
+    script.cast_batch = pin("cast_batch");
+    if (script.cast_batch == LUA_NOREF) script.cast_batch = runner(script.cast);
+    script.on_hit_batch = pin("on_hit_batch");
+    if (script.on_hit_batch == LUA_NOREF && script.on_hit != LUA_NOREF) script.on_hit_batch = runner(script.on_hit);
+
+    if (slot != INVALID_ABILITY) {
+        // the new entry points are complete: only now do the old ones go
+        releaseScript(abilities[slot]);
+        abilities[slot] = std::move(script);
+        return slot;
+    }
+    abilities.push_back(std::move(script));
+    return static_cast<AbilityHandle>(abilities.size() - 1);
+}
+
+size_t LuaBridge::loadAbilityDirectory(const std::string &dir, const std::string &prefix) {
+    std::error_code ec;
+    std::vector<std::string> files;
+    for (auto const& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".lua") files.push_back(entry.path().filename().string());
+    }
+    std::sort(files.begin(), files.end());
+
+    size_t loaded = 0;
+    for (auto const& file : files) {
+        if (findAbility(prefix + file) != INVALID_ABILITY) continue; // already registered
+        if (loadAbility(prefix + file, dir + "/" + file) != INVALID_ABILITY) ++loaded;
+    }
+    return loaded;
+}
+
+AbilityHandle LuaBridge::findAbility(const std::string &name) const {
+    for (size_t i = 0; i < abilities.size(); ++i) {
+        if (abilities[i].name == name) return static_cast<AbilityHandle>(i);
+    }
+    return INVALID_ABILITY;
+}
+
+bool LuaBridge::callRef(LuaRef fn, int nargs, int nresults, const char* what) {
+    lua_rawgeti(L, LUA_REGISTRYINDEX, fn); // push function
+    lua_insert(L, -(nargs + 1));           // ...below its arguments
+
+    // lua p_call(L, n-args, n-results, errfunc)
+    if (lua_pcall(L, nargs, nresults, 0) != LUA_OK) {
+        MOBA_LOG(Lua, Error, "Error calling {}: {}", what, lua_tostring(L, -1));
+        lua_pop(L,1);
+        return false;
+    }
     return true;
+}
+
+bool LuaBridge::callCast(AbilityHandle h, int caster_id, lua_Number target_x, lua_Number target_y, CastResult* out) {
+    if (h >= abilities.size()) return false;
+
+    lua_pushinteger(L, caster_id);
+    lua_pushnumber(L, target_x);
+    lua_pushnumber(L, target_y);
+    if (!callRef(abilities[h].cast, 3, 2, "cast")) return false;
+
+    // (ok, projectile_id) on the stack: only an explicit `false` means the cast failed
+    CastResult r;
+    r.ok = !(lua_isboolean(L, -2) && !lua_toboolean(L, -2));
+    if (lua_isinteger(L, -1)) r.projectile_id = (int)lua_tointeger(L, -1);
+    lua_pop(L,2);
+
+    if (out) *out = r;
+    return r.ok;
+}
+
+size_t LuaBridge::callCastBatch(AbilityHandle h, const CastRequest* casts, size_t count) {
+    if (h >= abilities.size() || count == 0) return 0;
+    AbilityScript const& a = abilities[h];
+    if (a.cast_batch == LUA_NOREF) {
+        size_t failed = 0;
+        for (size_t k = 0; k < count; ++k) {
+            lua_pushinteger(L, casts[k].caster_id);
+            lua_pushnumber(L, casts[k].target_x);
+            lua_pushnumber(L, casts[k].target_y);
+            if (!callRef(a.cast, 3, 0, "cast")) ++failed;
+        }
+        return failed;
+    }
+
+    // fill the reused argument arrays (entries past n are stale and ignored)
+    lua_pushinteger(L, static_cast<lua_Integer>(count));
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_casters);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_x);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_y);
+    for (size_t k = 0; k < count; ++k) {
+        lua_Integer idx = static_cast<lua_Integer>(k + 1);
+        lua_pushinteger(L, casts[k].caster_id);
+        lua_rawseti(L, -4, idx);
+        lua_pushnumber(L, casts[k].target_x);
+        lua_rawseti(L, -3, idx);
+        lua_pushnumber(L, casts[k].target_y);
+        lua_rawseti(L, -2, idx);
+    }
+    if (!callRef(a.cast_batch, 4, 2, "cast_batch")) return count;
+
+    size_t errors = lua_isinteger(L, -2) ? static_cast<size_t>(lua_tointeger(L, -2)) : 0;
+    if (errors > 0) {
+        const char* msg = lua_isstring(L, -1) ? lua_tostring(L, -1) : "?";
+        MOBA_LOG(Lua, Error, "{} of {} casts of {} failed, first: {}", errors, count, a.name, msg);
+    }
+    lua_pop(L,2);
+    return errors;
+}
+
+size_t LuaBridge::callOnHitBatch(AbilityHandle h, const HitRequest* hits, size_t count) {
+    if (h >= abilities.size() || count == 0) return 0;
+    AbilityScript const& a = abilities[h];
+    if (a.on_hit_batch == LUA_NOREF) {
+        size_t failed = 0;
+        for (size_t k = 0; k < count; ++k) {
+            if (a.on_hit != LUA_NOREF && !callOnHit(h, hits[k].projectile_id, hits[k].target_id, hits[k].caster_id)) ++failed;
+        }
+        return failed;
+    }
 
+    lua_pushinteger(L, static_cast<lua_Integer>(count));
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_casters);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_x);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_y);
+    for (size_t k = 0; k < count; ++k) {
+        lua_Integer idx = static_cast<lua_Integer>(k + 1);
+        lua_pushinteger(L, hits[k].projectile_id);
+        lua_rawseti(L, -4, idx);
+        lua_pushinteger(L, hits[k].target_id);
+        lua_rawseti(L, -3, idx);
+        lua_pushinteger(L, hits[k].caster_id);
+        lua_rawseti(L, -2, idx);
+    }
+    if (!callRef(a.on_hit_batch, 4, 2, "on_hit_batch")) return count;
+
+    size_t errors = lua_isinteger(L, -2) ? static_cast<size_t>(lua_tointeger(L, -2)) : 0;
+    if (errors > 0) {
+        const char* msg = lua_isstring(L, -1) ? lua_tostring(L, -1) : "?";
+        MOBA_LOG(Lua, Error, "{} of {} hits of {} failed, first: {}", errors, count, a.name, msg);
+    }
+    lua_pop(L,2);
+    return errors;
+}
+
+bool LuaBridge::callBuffHooks(AbilityHandle h, BuffHook hook, const BuffHookRequest* calls, size_t count) {
+    if (h >= abilities.size() || count == 0) return true;
+    AbilityScript const& a = abilities[h];
+    LuaRef fn = hook == BuffHook::Apply ? a.on_apply : a.on_expire;
+    if (fn == LUA_NOREF) return true;
+
+    // the cast batch arrays, free again by now (entries past n are stale and ignored)
+    lua_pushinteger(L, static_cast<lua_Integer>(count));
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_casters);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_x);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, batch_y);
+    for (size_t k = 0; k < count; ++k) {
+        lua_Integer idx = static_cast<lua_Integer>(k + 1);
+        lua_pushinteger(L, calls[k].target_id);
+        lua_rawseti(L, -4, idx);
+        lua_pushinteger(L, calls[k].source_id);
+        lua_rawseti(L, -3, idx);
+        lua_pushinteger(L, calls[k].buff_id);
+        lua_rawseti(L, -2, idx);
+    }
+    return callRef(fn, 4, 0, hook == BuffHook::Apply ? "on_apply" : "on_expire");
 }
 
-// Double overload that delegates to the float version
-bool LuaBridge::callCastFunction(const std::string &fnName, int caster_id, double target_x, double target_y) {
-    return callCastFunction(fnName, caster_id, (float)target_x, (float)target_y);
+bool LuaBridge::callOnHit(AbilityHandle h, int projectile_id, int target_id, int caster_id) {
+    if (h >= abilities.size() || abilities[h].on_hit == LUA_NOREF) return false;
+
+    lua_pushinteger(L, projectile_id);
+    lua_pushinteger(L, target_id);
+    lua_pushinteger(L, caster_id);
+    return callRef(abilities[h].on_hit, 3, 0, "on_hit");
 }
 
 
@@ -121,11 +538,31 @@ bool LuaBridge::checkFieldInt(lua_State* L, int idx, const char* key, int &out)
 // ------------------- Binding registration --------------------
 
 void LuaBridge::registerCoreBindings() {
-    lua_register(L, "GetPosition", LuaBridge::l_GetPosition);
-    lua_register(L, "SetMovement", LuaBridge::l_SetMovement);
-    lua_register(L, "ApplyDamage", LuaBridge::l_ApplyDamage);
-    lua_register(L, "ApplyKnockback", LuaBridge::l_ApplyKnockback);
-    lua_register(L, "SpawnProjectile", LuaBridge::l_SpawnProjectile);
+    // lua_register, but with the host as upvalue 1 (see HostOf)
+    auto bind = [this](const char* name, lua_CFunction fn) {
+        lua_pushlightuserdata(L, host);
+        lua_pushcclosure(L, fn, 1);
+        lua_setglobal(L, name);
+    };
+    bind("GetPosition", LuaBridge::l_GetPosition);
+    bind("SetMovement", LuaBridge::l_SetMovement);
+    bind("ApplyDamage", LuaBridge::l_ApplyDamage);
+    bind("ApplyKnockback", LuaBridge::l_ApplyKnockback);
+    bind("SpawnProjectile", LuaBridge::l_SpawnProjectile);
+    bind("FindAbility", LuaBridge::l_FindAbility);
+    bind("GetAbilityStat", LuaBridge::l_GetAbilityStat);
+    bind("FindBuff", LuaBridge::l_FindBuff);
+    bind("ApplyBuff", LuaBridge::l_ApplyBuff);
+    bind("RemoveBuff", LuaBridge::l_RemoveBuff);
+    lua_register(L, "print", LuaPrint);
+
+    // AbilityStat.damage, AbilityStat.speed, ... -> the integer keys GetAbilityStat takes
+    lua_createtable(L, 0, ABILITY_STAT_COUNT);
+    for (uint32_t k = 0; k < ABILITY_STAT_COUNT; ++k) {
+        lua_pushinteger(L, k);
+        lua_setfield(L, -2, abilityStatName(static_cast<AbilityStat>(k)));
+    }
+    lua_setglobal(L, "AbilityStat");
 
     // (Optionally) add a small helper table
     // e.g. could create Game API table: game.GetPosition(...) etc.
@@ -133,6 +570,16 @@ void LuaBridge::registerCoreBindings() {
 
 // ------------------- Binding implementations --------------------
 
+// The match this binding was registered for (never returns null: raises instead)
+static ScriptHost* HostOf(lua_State* L) {
+    ScriptHost* host = static_cast<ScriptHost*>(lua_touserdata(L, lua_upvalueindex(1)));
+    if (!host) {
+        lua_pushstring(L, "no engine attached to this Lua state");
+        lua_error(L);
+    }
+    return host;
+}
+
 // GetPosition(entity_id) -> x, y
 int LuaBridge::l_GetPosition(lua_State* L) {
     if (!lua_isinteger(L, 1)) {
@@ -142,7 +589,7 @@ int LuaBridge::l_GetPosition(lua_State* L) {
     }
     int entity_id = (int)lua_tointeger(L, 1);
     float x = 0.0, y = 0.0;
-    bool ok = Engine_GetPosition(entity_id, x, y);
+    bool ok = HostOf(L)->GetPosition(entity_id, x, y);
     if (!ok) {
         lua_pushnil(L);
         lua_pushnil(L);
@@ -163,7 +610,7 @@ int LuaBridge::l_SetMovement(lua_State* L) {
     int entity_id = (int)lua_tointeger(L, 1);
     float vx = lua_tonumber(L, 2);
     float vy = lua_tonumber(L, 3);
-    bool ok = Engine_SetMovement(entity_id, vx, vy);
+    bool ok = HostOf(L)->SetMovement(entity_id, vx, vy);
     lua_pushboolean(L, ok ? 1 : 0);
     return 1;
 }
@@ -180,7 +627,7 @@ int LuaBridge::l_ApplyDamage(lua_State* L) {
     int target = (int)lua_tointeger(L,2);
     int amount = (int)lua_tonumber(L,3);
     const char* dtype = lua_tostring(L,4);
-    bool ok = Engine_ApplyDamage(source, target, amount, dtype);
+    bool ok = HostOf(L)->ApplyDamage(source, target, amount, dtype);
     lua_pushboolean(L, ok ? 1 : 0);
     return 1;
 }
@@ -207,7 +654,7 @@ int LuaBridge::l_ApplyKnockback(lua_State* L) {
     if (len == 0.0) { dx = 1.0; dy = 0.0; len = 1.0; }
     dx /= len; dy /= len; // unit vectors
 
-    bool ok = Engine_ApplyKnockback(source, target, dx, dy, force, duration);
+    bool ok = HostOf(L)->ApplyKnockback(source, target, dx, dy, force, duration);
     lua_pushboolean(L, ok ? 1 : 0);
     return 1;
 }
@@ -288,19 +735,13 @@ int LuaBridge::l_SpawnProjectile(lua_State* L) {
     float life_time = 0.0;
     checkFieldNumber(L, 1, "life_time", life_time);
 
-    // on_hit callback name (string)
-    std::string on_hit;
-    lua_getfield(L, 1, "on_hit");
-    if (lua_isstring(L, -1)) {
-        on_hit = lua_tostring(L, -1);
-    }
-    lua_pop(L,1);
+    // `on_hit` (a callback name) is no longer read: hits go to the casting script's on_hit
 
     // Cases where optionals are not available
     // 1. If spawn pos not specified, try to use caster position
     if (spawn_x == 0.0 && spawn_y == 0.0) {
         float sx=0.0, sy=0.0;
-        if (Engine_GetPosition(caster, sx, sy)) {
+        if (HostOf(L)->GetPosition(caster, sx, sy)) {
             spawn_x = sx;
             spawn_y = sy;
         }
@@ -320,8 +761,7 @@ int LuaBridge::l_SpawnProjectile(lua_State* L) {
     else { dir_x /= dlen; dir_y /= dlen; }
 
     // Call engine to create projectile
-    const char* on_hit_cstr = on_hit.empty() ? nullptr : on_hit.c_str();
-    int proj_id = Engine_SpawnProjectile(caster, spawn_x, spawn_y, dir_x, dir_y, speed, radius, life_time, on_hit_cstr);
+    int proj_id = HostOf(L)->SpawnProjectile(caster, spawn_x, spawn_y, dir_x, dir_y, speed, radius, life_time);
     if (proj_id <= 0) {
         lua_pushnil(L);
         lua_pushstring(L, "Failed to spawn projectile");
@@ -330,4 +770,71 @@ int LuaBridge::l_SpawnProjectile(lua_State* L) {
 
     lua_pushinteger(L, proj_id);
     return 1;
-}
\ No newline at end of file
+}
+// FindAbility(name) -> ability id | nil  (once, at script load: the id is what the hot path uses)
+int LuaBridge::l_FindAbility(lua_State* L) {
+    const char* name = lua_tostring(L, 1);
+    if (!name) {
+        lua_pushstring(L, "FindAbility: expected string name");
+        lua_error(L);
+        return 0;
+    }
+    int id = HostOf(L)->FindAbilityId(name);
+    if (id < 0) lua_pushnil(L);
+    else lua_pushinteger(L, id);
+    return 1;
+}
+
+// GetAbilityStat(ability_id, AbilityStat.<stat>) -> number | nil  (world units, seconds)
+int LuaBridge::l_GetAbilityStat(lua_State* L) {
+    if (!lua_isinteger(L, 1) || !lua_isinteger(L, 2)) {
+        lua_pushstring(L, "GetAbilityStat: expected (int ability_id, int stat)");
+        lua_error(L);
+        return 0;
+    }
+    float value = 0.0f;
+    if (!HostOf(L)->GetAbilityStat((int)lua_tointeger(L, 1), (int)lua_tointeger(L, 2), value)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushnumber(L, value);
+    return 1;
+}
+
+// FindBuff(name) -> buff id | nil  (once, at script load, like FindAbility)
+int LuaBridge::l_FindBuff(lua_State* L) {
+    const char* name = lua_tostring(L, 1);
+    if (!name) {
+        lua_pushstring(L, "FindBuff: expected string name");
+        lua_error(L);
+        return 0;
+    }
+    int id = HostOf(L)->FindBuffId(name);
+    if (id < 0) lua_pushnil(L);
+    else lua_pushinteger(L, id);
+    return 1;
+}
+
+// ApplyBuff(source_id, target_id, buff_id) -> ok
+int LuaBridge::l_ApplyBuff(lua_State* L) {
+    if (!lua_isinteger(L, 1) || !lua_isinteger(L, 2) || !lua_isinteger(L, 3)) {
+        lua_pushstring(L, "ApplyBuff: expected (int source_id, int target_id, int buff_id)");
+        lua_error(L);
+        return 0;
+    }
+    bool ok = HostOf(L)->ApplyBuff((int)lua_tointeger(L, 1), (int)lua_tointeger(L, 2), (int)lua_tointeger(L, 3));
+    lua_pushboolean(L, ok ? 1 : 0);
+    return 1;
+}
+
+// RemoveBuff(target_id, buff_id) -> ok
+int LuaBridge::l_RemoveBuff(lua_State* L) {
+    if (!lua_isinteger(L, 1) || !lua_isinteger(L, 2)) {
+        lua_pushstring(L, "RemoveBuff: expected (int target_id, int buff_id)");
+        lua_error(L);
+        return 0;
+    }
+    bool ok = HostOf(L)->RemoveBuff((int)lua_tointeger(L, 1), (int)lua_tointeger(L, 2));
+    lua_pushboolean(L, ok ? 1 : 0);
+    return 1;
+}
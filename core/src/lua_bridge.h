@@ -1,17 +1,171 @@
 #pragma once
 #include "lua.hpp"
+#include "lua_alloc.h"
+#include <cstdint>
 #include <string>
+#include <vector>
+
+// Registry reference to a Lua value (luaL_ref), LUA_NOREF when missing
+using LuaRef = int;
+
+// Index of a loaded ability script, resolved once at load time
+using AbilityHandle = uint16_t;
+constexpr AbilityHandle INVALID_ABILITY = 0xFFFF;
+
+// An ability script's entry points, pinned in the registry so calls never look up globals by name.
+// Each script runs in its own _ENV table (falling back to the globals for the engine bindings),
+// so every file can define `cast` without clobbering the others.
+struct AbilityScript {
+    std::string name;          // script path relative to the scripts root, e.g. "abilities/fireball_test.lua"
+    std::string path;          // the file it was loaded from
+    LuaRef env = LUA_NOREF;    // the script's _ENV table
+    LuaRef cast = LUA_NOREF;   // cast(caster_id, target_x, target_y) -> ok, projectile_id | false, err
+    LuaRef on_hit = LUA_NOREF; // on_hit(projectile_id, target_id, caster_id)
+    // cast_batch(n, casters, xs, ys) -> errors, first_error. The script's own `cast_batch` when it
+    // defines one, otherwise a shared Lua loop that pcalls `cast` per entry.
+    LuaRef cast_batch = LUA_NOREF;
+    // on_hit_batch(n, projectiles, targets, casters) -> errors, first_error: likewise, over on_hit
+    LuaRef on_hit_batch = LUA_NOREF;
+    // buff hooks, batched per tick: on_apply(n, targets, sources, buffs), same for on_expire
+    LuaRef on_apply = LUA_NOREF;
+    LuaRef on_expire = LUA_NOREF;
+};
+
+// One entry of a callCastBatch() batch
+struct CastRequest {
+    int caster_id;
+    lua_Number target_x;
+    lua_Number target_y;
+};
+
+// One entry of a callOnHitBatch() batch
+struct HitRequest {
+    int projectile_id;
+    int target_id;
+    int caster_id;
+};
+
+enum class BuffHook : uint8_t {
+    Apply,
+    Expire // ran out or was removed
+};
+
+// One entry of a callBuffHooks() batch
+struct BuffHookRequest {
+    int target_id;
+    int source_id;
+    int buff_id;
+};
+
+struct CastResult {
+    bool ok = false;
+    int projectile_id = 0; // 0 when the cast spawned nothing
+};
+
+// The match a LuaBridge's bindings act on. Every core binding is a C closure holding its host
+// as upvalue 1, so each match (with its own VM) reaches its own state and several matches can
+// share a process.
+class ScriptHost {
+public:
+    virtual ~ScriptHost() = default;
+
+    virtual bool GetPosition(int entity_id, float &out_x, float &out_y) = 0;
+    virtual bool SetMovement(int entity_id, float vx, float vy) = 0;
+    virtual bool ApplyDamage(int source_id, int target_id, int amount, const char* damage_type) = 0;
+    virtual bool ApplyKnockback(int source_id, int target_id, float dir_x, float dir_y, float force, float duration) = 0;
+    // returns new projectile entity id (>0) or -1 on error
+    // hits go to the on_hit of the ability casting when it spawns
+    virtual int SpawnProjectile(int caster_id, float spawn_x, float spawn_y, float dir_x, float dir_y, float speed, float radius, float life_time) = 0;
+
+    // Stat lookups by id: scripts resolve names once at load (FindAbility) and keep the id.
+    // FindAbilityId returns -1 for unknown names; stat is an AbilityStat (game_defs.h).
+    virtual int FindAbilityId(const char* name) = 0;
+    virtual bool GetAbilityStat(int ability_id, int stat, float& out) = 0;
+
+    // Buffs (game_defs.json "buffs"): FindBuffId returns -1 for unknown names. Applying the
+    // same buff from the same source again refreshes its duration.
+    virtual int FindBuffId(const char* name) = 0;
+    virtual bool ApplyBuff(int source_id, int target_id, int buff_id) = 0;
+    virtual bool RemoveBuff(int target_id, int buff_id) = 0;
+};
+
+// VM memory (allocator) + collector activity, one LuaBridge per match
+struct LuaVmStats {
+    LuaMemoryStats memory;
+    uint64_t gc_steps = 0;   // collections run in slack time
+    uint64_t gc_skipped = 0; // idle calls with garbage pending but not enough slack
+    uint64_t gc_forced = 0;  // ran without slack because garbage passed GC_FORCE_BYTES
+    uint64_t gc_ns_total = 0;
+    uint64_t gc_ns_max = 0;
+};
+
+// Garbage that forces a collection even when a tick left no slack (bounds VM growth under load)
+constexpr size_t GC_FORCE_BYTES = 4u << 20;
 
 struct LuaBridge {
     lua_State *L;   // Pointer for Lua state (holds context)
-    LuaBridge();    // Constructor
+    explicit LuaBridge(ScriptHost* host = nullptr); // bindings raise an error while host is null
     ~LuaBridge();   // Destructor
 
     // Load and execute Lua file
     bool doFile(const std::string &path);
-    bool callCastFunction(const std::string &fnName, int caster_id, float target_x, float target_y);
-    // Specific Lua function for test (fireball-test)
-    bool callCastFunction(const std::string &fnName, int caster_id, double target_x, double target_y);
+
+    // Run an ability script in a fresh _ENV and pin its `cast` / `on_hit` functions in the registry.
+    // The compiled chunk comes from the bytecode cache when the source is unchanged.
+    // Returns INVALID_ABILITY when the file fails to load or defines no `cast`.
+    AbilityHandle loadAbility(const std::string &name, const std::string &path);
+    // Load every *.lua directly under `dir` (sorted, so handles are stable), named `prefix` + filename.
+    // Returns how many loaded.
+    size_t loadAbilityDirectory(const std::string &dir, const std::string &prefix);
+    AbilityHandle findAbility(const std::string &name) const; // load time only (string compare)
+
+    // Hot reload (hot_reload.h). Compile `src` to bytecode in a scratch Lua state: touches no
+    // LuaBridge, so the watcher thread does it and syntax errors never reach the match.
+    static bool compileChunk(const std::string &src, const std::string &path, std::string &bytecode, std::string &error);
+    // Run compiled bytecode in a fresh _ENV and swap it in under the handle `name` already has
+    // (a new handle for an unknown name). The old entry points stay when the new chunk raises
+    // or defines no `cast`. Between ticks only: a batch in flight would call the old ones.
+    AbilityHandle reloadAbility(const std::string &name, const std::string &path, const std::string &bytecode);
+    // Rerun every loaded script from its file, handles kept (after the defs changed, so load
+    // time lookups like FindAbility resolve again). Returns how many reloaded.
+    size_t reloadAbilities();
+    AbilityScript const* ability(AbilityHandle h) const { return h < abilities.size() ? &abilities[h] : nullptr; }
+
+    // Hot path: call by handle, no string hashing, results come back as plain return values
+    bool callCast(AbilityHandle h, int caster_id, lua_Number target_x, lua_Number target_y, CastResult* out = nullptr);
+    bool callOnHit(AbilityHandle h, int projectile_id, int target_id, int caster_id);
+    // A tick's hits of one ability's projectiles in a single C->Lua call, like callCastBatch().
+    // Nothing happens when the script has no on_hit; returns how many raised.
+    size_t callOnHitBatch(AbilityHandle h, const HitRequest* hits, size_t count);
+    // Every cast of one ability for this tick in a single C->Lua call. A cast that raises doesn't
+    // stop the rest; returns how many raised (the first message is logged).
+    size_t callCastBatch(AbilityHandle h, const CastRequest* casts, size_t count);
+    // One tick's on_apply/on_expire calls for a script's buffs in a single C->Lua call (nothing
+    // happens when the script lacks the hook). False when the hook raised.
+    bool callBuffHooks(AbilityHandle h, BuffHook hook, const BuffHookRequest* calls, size_t count);
+
+    // Pin a global function in the registry (LUA_NOREF when it isn't a function)
+    LuaRef resolveFunction(const char* global_name);
+
+    // Bytecode cache: compiled chunks are kept per process (shared by every LuaBridge, so extra
+    // matches never reparse) and, when a directory is set, as <hash>.luac files across restarts.
+    // The directory must be server-local: bytecode is not verified like source is.
+    void setBytecodeCacheDir(const std::string &dir) { bytecode_dir = dir; }
+    struct ScriptLoadStats {
+        uint32_t compiled = 0;    // parsed from source
+        uint32_t memory_hits = 0; // reused bytecode compiled earlier in this process
+        uint32_t disk_hits = 0;   // loaded from bytecode_dir
+    };
+    ScriptLoadStats const& loadStats() const { return load_stats; }
+
+    // The collector never runs on its own (it would land inside casts): it is in generational
+    // mode, stopped, and only steps here. Call once per tick with the slack left before the next
+    // one; a step (one minor collection) runs when slack >= the budget or garbage piled up.
+    void setGcBudget(uint64_t budget_ns) { gc_budget_ns = budget_ns; }
+    bool collectGarbage(uint64_t slack_ns);
+    // 0 = unlimited. Over the limit allocations fail and the script gets a "not enough memory" error.
+    void setMemoryLimit(size_t limit_bytes) { allocator.setLimit(limit_bytes); }
+    LuaVmStats vmStats() const;
 
     // Register core game functions to Lua
     void registerCoreBindings();
@@ -22,9 +176,38 @@ struct LuaBridge {
     static int l_ApplyDamage(lua_State* L);
     static int l_ApplyKnockback(lua_State* L);
     static int l_SpawnProjectile(lua_State* L);
+    static int l_FindAbility(lua_State* L);
+    static int l_GetAbilityStat(lua_State* L);
+    static int l_FindBuff(lua_State* L);
+    static int l_ApplyBuff(lua_State* L);
+    static int l_RemoveBuff(lua_State* L);
 
     // helpers for reading tables
     static bool checkFieldNumber(lua_State* L, int idx, const char* key, double &out);
     static bool checkFieldNumber(lua_State *L, int idx, const char *key, float &out);
     static bool checkFieldInt(lua_State *L, int idx, const char *key, int &out);
+
+private:
+    // pushes `fn` below the nargs arguments already on the stack and pcalls it
+    bool callRef(LuaRef fn, int nargs, int nresults, const char* what);
+    // pushes the compiled chunk of `path` (cache first, source otherwise)
+    bool loadChunk(const std::string &path);
+    // runs the chunk on the stack in a fresh _ENV and pins its entry points, into `slot` when
+    // it is a valid handle (replacing what was there) or a new one
+    AbilityHandle installChunk(const std::string &name, const std::string &path, AbilityHandle slot);
+    void releaseScript(AbilityScript &script);
+
+    ScriptHost* host;
+    LuaPoolAllocator allocator; // outlives L: members are destroyed after ~LuaBridge() closes it
+    uint64_t gc_budget_ns = 0;
+    size_t gc_baseline_bytes = 0; // bytes in use right after the last step
+    LuaVmStats gc_stats;
+
+    std::vector<AbilityScript> abilities;
+    LuaRef batch_runner_factory = LUA_NOREF; // function(fn) -> default cast_batch/on_hit_batch closure over fn
+    LuaRef batch_casters = LUA_NOREF;        // argument arrays reused by every callCastBatch() (and the other batches)
+    LuaRef batch_x = LUA_NOREF;
+    LuaRef batch_y = LUA_NOREF;
+    std::string bytecode_dir;
+    ScriptLoadStats load_stats;
 };
\ No newline at end of file
@@ -1,16 +1,45 @@
 #include <iostream>
-#include "lua_bridge.h"
+#include "engine_api.h"
 
+// Drives a match through the C ABI only (engine_api.h), the way a tool linking moba_sim would
 int main() {
-    LuaBridge bridge; // creates instance
-    if (!bridge.doFile("../../game/scripts/abilities/fireball_test.lua")) {
-        std::cerr << "Failed to load lua script\n";
+    MobaSimConfig config = {};
+    config.api_version = MOBA_SIM_API_VERSION;
+    config.quiet = 1;
+    MobaSim* sim = sim_create(&config);
+    if (!sim) {
+        std::cerr << "Failed to create the sim\n";
         return 1;
     }
 
-    // Simulate a caster (entity id 42) casting Fireball at (10.2, 5.7)
-    bridge.callCastFunction("cast", 42, 10.2, 5.7);
+    const MobaSimStateHeader* state = sim_read_state(sim);
+    uint32_t enemy = sim_spawn_character(sim, 5 * static_cast<int32_t>(state->pos_scale), 0, 1);
 
+    // Client 0 walks its hero (1001) right for one second
+    MobaSimInput in = {};
+    in.client_id = 0;
+    in.target_tick = MOBA_SIM_NOW;
+    in.move_dx = 127;
+    sim_push_input(sim, &in);
+    uint32_t tick = sim_step(sim, state->tick_rate);
+
+    // Columns are read in place
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(state);
+    const uint32_t* id = reinterpret_cast<const uint32_t*>(base + state->id_offset);
+    const int32_t* pos_x = reinterpret_cast<const int32_t*>(base + state->pos_x_offset);
+    const int32_t* pos_y = reinterpret_cast<const int32_t*>(base + state->pos_y_offset);
+    const int32_t* health = reinterpret_cast<const int32_t*>(base + state->health_offset);
+    std::cout << "Tick " << tick << ", " << state->count << " entities, hash " << std::hex << state->state_hash << std::dec << "\n";
+    for (uint32_t i = 0; i < state->count; ++i) {
+        std::cout << "  " << id[i] << (id[i] == enemy ? " (enemy)" : "") << " at (" << static_cast<double>(pos_x[i]) / state->pos_scale
+                  << ", " << static_cast<double>(pos_y[i]) / state->pos_scale << ") hp " << health[i] << "\n";
+    }
+
+    // Unpaced: a long run costs only the simulation
+    tick = sim_step(sim, 10000);
+    std::cout << "Tick " << tick << ", hash " << std::hex << state->state_hash << std::dec << "\n";
+
+    sim_destroy(sim);
     std::cout << "Done.\n";
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+#include "match_host.h"
+#include <thread>
+
+MatchHost::MatchHost(unsigned threads) : pool(threads) {}
+
+uint32_t MatchHost::createMatch() {
+    matches.push_back(std::unique_ptr<DemoServer>(new DemoServer()));
+    outgoing.emplace_back();
+    return static_cast<uint32_t>(matches.size() - 1);
+}
+
+void MatchHost::step(std::chrono::steady_clock::time_point deadline) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    pool.parallelFor(matches.size(), [this, deadline](size_t i) {
+        DemoServer& m = *matches[i];
+        m.tick();
+        m.buildClientSnapshots(outgoing[i]);
+        m.runIdleWork(deadline);
+    });
+
+    auto end = Clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    host_stats.step_ns.add(ns > 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<uint32_t>(ns));
+    ++host_stats.steps;
+    if (end > deadline) ++host_stats.late_steps;
+}
+
+void MatchHost::run(uint32_t steps) {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::nanoseconds(TICK_NS);
+
+    auto slot = Clock::now();
+    for (uint32_t k = 0; k < steps; ++k) {
+        std::this_thread::sleep_until(slot);
+        step(slot + period);
+        slot += period;
+
+        // more than a whole slot behind: drop the missed slots instead of bursting to catch up
+        auto now = Clock::now();
+        while (slot + period < now) {
+            slot += period;
+            ++host_stats.skipped_steps;
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "engine.h"
+#include "thread_pool.h"
+#include "tick_profiler.h"
+
+// ---------- Match host ----------
+// Runs many independent DemoServers in one process. Every host step ticks all matches on a
+// WorkStealingPool (one match = one task: tick, snapshots, idle work), and steps start on the
+// TICK_NS cadence. A match is only ever touched by one pool thread per step, and the pool's
+// barrier orders consecutive steps, so DemoServer itself needs no locking.
+struct MatchHostStats {
+    uint64_t steps = 0;
+    uint64_t late_steps = 0;    // the slowest match finished after the next step should have started
+    uint64_t skipped_steps = 0; // cadence slots dropped to catch up after falling behind
+    NsHistogram step_ns;        // wall time of one step (all matches)
+};
+
+class MatchHost {
+public:
+    // `threads` includes the calling thread (0 = hardware_concurrency)
+    explicit MatchHost(unsigned threads = 0);
+
+    // Between steps only. Returns the match index.
+    uint32_t createMatch();
+    size_t matchCount() const { return matches.size(); }
+    DemoServer& match(uint32_t index) { return *matches[index]; }
+    std::vector<ClientSnapshotRef> const& snapshots(uint32_t index) const { return outgoing[index]; }
+
+    // One step for every match; idle work (Lua GC) gets the time left until `deadline`
+    void step(std::chrono::steady_clock::time_point deadline);
+    // `steps` steps aligned to the 30 Hz cadence (sleeps until each slot starts)
+    void run(uint32_t steps);
+
+    MatchHostStats const& stats() const { return host_stats; }
+    unsigned threadCount() const { return pool.size(); }
+    uint64_t steals() const { return pool.steals(); }
+
+private:
+    WorkStealingPool pool;
+    std::vector<std::unique_ptr<DemoServer>> matches;
+    std::vector<std::vector<ClientSnapshotRef>> outgoing; // per match, valid until its next step
+    MatchHostStats host_stats;
+};
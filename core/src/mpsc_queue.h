@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Bounded lock-free multi-producer / single-consumer queue (Vyukov's bounded queue,
+// with the consumer side simplified since only one thread pops).
+// - producers (network threads) never block: try_push fails when the ring is full
+// - the consumer (tick thread) never takes a lock either, so a stalled producer can't stall the tick
+// Capacity must be a power of two. Storage is allocated once in the constructor.
+template<typename T, size_t Capacity>
+class BoundedMpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    BoundedMpscQueue() : cells(new Cell[Capacity]) {
+        for (size_t i = 0; i < Capacity; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedMpscQueue(BoundedMpscQueue const&) = delete;
+    BoundedMpscQueue& operator=(BoundedMpscQueue const&) = delete;
+
+    // Any thread. Returns false (and drops nothing already queued) when full.
+    bool try_push(T const& value) {
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &cells[pos & (Capacity - 1)];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (dif == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only.
+    bool try_pop(T& out) {
+        Cell& cell = cells[dequeue_pos & (Capacity - 1)];
+        size_t seq = cell.seq.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(dequeue_pos + 1) < 0) return false; // empty
+        out = cell.data;
+        cell.seq.store(dequeue_pos + Capacity, std::memory_order_release);
+        ++dequeue_pos;
+        return true;
+    }
+
+    // Approximate (racy by nature), for telemetry only
+    size_t size_approx() const {
+        size_t e = enqueue_pos.load(std::memory_order_relaxed);
+        size_t d = dequeue_pos_published.load(std::memory_order_relaxed);
+        return e >= d ? e - d : 0;
+    }
+
+    // Consumer thread: publish the dequeue position for size_approx()
+    void publish() { dequeue_pos_published.store(dequeue_pos, std::memory_order_relaxed); }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) size_t dequeue_pos = 0;
+    std::atomic<size_t> dequeue_pos_published{0};
+};
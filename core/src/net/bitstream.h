@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// --------------------------------------------------------------
+//  BIT STREAMS
+// --------------------------------------------------------------
+// BitWriter packs values LSB-first into a 64-bit scratch word and stores whole words
+// into a caller-owned buffer (one memcpy per 64 bits, no per-byte push_back).
+// BitReader is the exact mirror. Both assume a little-endian host, like the rest of the net code.
+// Overflow never writes/reads out of bounds: it sets a flag the caller must check.
+
+class BitWriter
+{
+public:
+    BitWriter(uint8_t* d, size_t cap) : data(d), capacity(cap) {}
+
+    // bits in [1, 32]
+    void writeBits(uint32_t value, uint32_t bits)
+    {
+        uint64_t v = bits == 32 ? value : (value & ((1u << bits) - 1u));
+        uint32_t free_bits = 64 - scratch_bits;
+        if (bits < free_bits) {
+            scratch |= v << scratch_bits;
+            scratch_bits += bits;
+            return;
+        }
+        // fill the word, store it, keep the remainder
+        scratch |= v << scratch_bits;
+        flushWord(scratch);
+        scratch = v >> free_bits; // free_bits <= bits <= 32 here
+        scratch_bits = bits - free_bits;
+    }
+
+    void writeBool(bool b) { writeBits(b ? 1u : 0u, 1); }
+
+    // 7 bits per group + continuation bit: values < 128 cost 8 bits
+    void writeVarint(uint32_t value)
+    {
+        while (value >= 0x80u) {
+            writeBits((value & 0x7Fu) | 0x80u, 8);
+            value >>= 7;
+        }
+        writeBits(value, 8);
+    }
+
+    // small negative and positive deltas both become small unsigned values
+    void writeZigzag(int32_t value)
+    {
+        writeVarint((static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+    }
+
+    // Flush the partial word. Returns the total number of bytes used.
+    size_t finish()
+    {
+        size_t tail = (scratch_bits + 7) / 8;
+        size_t at = words * 8;
+        if (at + tail > capacity) { overflow = true; tail = at < capacity ? capacity - at : 0; }
+        if (tail) memcpy(data + at, &scratch, tail);
+        size_t total = at + (scratch_bits + 7) / 8;
+        scratch = 0;
+        scratch_bits = 0;
+        return overflow ? capacity : total;
+    }
+
+    size_t bitsWritten() const { return words * 64 + scratch_bits; }
+    bool overflowed() const { return overflow; }
+
+private:
+    void flushWord(uint64_t w)
+    {
+        size_t at = words * 8;
+        if (at + 8 <= capacity) memcpy(data + at, &w, 8);
+        else overflow = true;
+        ++words;
+    }
+
+    uint8_t* data;
+    size_t capacity;
+    size_t words = 0;
+    uint64_t scratch = 0;
+    uint32_t scratch_bits = 0;
+    bool overflow = false;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t* d, size_t s) : data(d), size(s) {}
+
+    // bits in [1, 32]
+    uint32_t readBits(uint32_t bits)
+    {
+        uint64_t mask = bits == 32 ? 0xFFFFFFFFull : ((1ull << bits) - 1ull);
+        bits_read += bits;
+        if (bits_read > size * 8) overflow = true;
+
+        if (bits <= scratch_bits) {
+            uint32_t v = static_cast<uint32_t>(scratch & mask);
+            scratch >>= bits;
+            scratch_bits -= bits;
+            return v;
+        }
+        uint64_t w = loadWord();
+        uint32_t have = scratch_bits;
+        uint32_t v = static_cast<uint32_t>((scratch | (w << have)) & mask);
+        uint32_t used = bits - have;
+        scratch = w >> used; // used <= 32
+        scratch_bits = 64 - used;
+        return v;
+    }
+
+    bool readBool() { return readBits(1) != 0; }
+
+    uint32_t readVarint()
+    {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7) {
+            uint32_t group = readBits(8);
+            value |= (group & 0x7Fu) << shift;
+            if (!(group & 0x80u)) return value;
+        }
+        overflow = true; // malformed (more than 5 groups)
+        return value;
+    }
+
+    int32_t readZigzag()
+    {
+        uint32_t v = readVarint();
+        return static_cast<int32_t>((v >> 1) ^ (0u - (v & 1u)));
+    }
+
+    bool overflowed() const { return overflow; }
+
+private:
+    uint64_t loadWord()
+    {
+        uint64_t w = 0;
+        size_t at = word_index * 8;
+        if (at < size) memcpy(&w, data + at, (size - at) >= 8 ? 8 : (size - at));
+        ++word_index;
+        return w;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t word_index = 0;
+    size_t bits_read = 0;
+    uint64_t scratch = 0;
+    uint32_t scratch_bits = 0;
+    bool overflow = false;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// --------------------------------------------------------------
+//  SEND BUFFER POOL
+// --------------------------------------------------------------
+// Every outgoing datagram is built in place inside one of these buffers and handed to the
+// socket as-is (UdpSocket::sendBatch points its iovecs straight at them), so nothing is copied
+// between encoding and the kernel.
+// All buffers live in one slab allocated up front: a single region that can be registered
+// with the OS (io_uring fixed buffers, RIO) if the socket layer ever needs it.
+
+// Largest datagram we build. Stays under the 1280-byte IPv6 minimum MTU minus IP/UDP headers,
+// so snapshots are never fragmented by the network.
+constexpr size_t MAX_PACKET_BYTES = 1200;
+
+struct PacketBuffer
+{
+    uint8_t* data = nullptr;
+    uint16_t size = 0;   // bytes used
+    uint16_t index = 0;  // slot in the owning pool
+};
+
+class PacketPool
+{
+public:
+    explicit PacketPool(size_t count)
+        : slab(new uint8_t[count * MAX_PACKET_BYTES]), buffers(count)
+    {
+        assert(count <= 0xFFFF);
+        free_list.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            buffers[i].data = slab.get() + i * MAX_PACKET_BYTES;
+            buffers[i].index = static_cast<uint16_t>(i);
+            free_list.push_back(static_cast<uint16_t>(count - 1 - i)); // hand out low slots first
+        }
+    }
+
+    PacketPool(PacketPool const&) = delete;
+    PacketPool& operator=(PacketPool const&) = delete;
+
+    // nullptr when every buffer is in flight
+    PacketBuffer* acquire()
+    {
+        if (free_list.empty()) return nullptr;
+        PacketBuffer* b = &buffers[free_list.back()];
+        free_list.pop_back();
+        b->size = 0;
+        return b;
+    }
+
+    void release(PacketBuffer* b)
+    {
+        assert(b && &buffers[b->index] == b);
+        free_list.push_back(b->index);
+    }
+
+    size_t available() const { return free_list.size(); }
+    size_t capacity() const { return buffers.size(); }
+
+    // the registered region
+    const uint8_t* slabData() const { return slab.get(); }
+    size_t slabBytes() const { return buffers.size() * MAX_PACKET_BYTES; }
+
+private:
+    std::unique_ptr<uint8_t[]> slab;
+    std::vector<PacketBuffer> buffers;
+    std::vector<uint16_t> free_list;
+};
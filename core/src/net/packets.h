@@ -5,6 +5,7 @@
 #include <cassert>
 #include "../client_input.h"
 #include "../entity_state.h"
+#include "bitstream.h"
 
 #pragma pack(push, 1)
 
@@ -16,7 +17,8 @@ enum class PacketType : uint8_t
     INVALID = 0,
     CLIENT_INPUT = 1,       // Client -> Server
     SERVER_SNAPSHOT = 2,    // Server -> Client (full snapshot)
-    SERVER_SNAPSHOT_DELTA = 3 // Server -> Client (delta snapshot)
+    SERVER_SNAPSHOT_DELTA = 3, // Server -> Client (delta snapshot)
+    SERVER_SNAPSHOT_FRAGMENT = 4 // Server -> Client (one MTU-sized piece of a delta snapshot)
 };
 
 // --------------------------------------------------------------
@@ -91,10 +93,14 @@ struct BufferReader
 struct ClientInputPacket
 {
     PacketHeader header;
+    uint32_t clientId;       // sending client
+    uint32_t ackedTick;      // newest snapshot tick received (0xFFFFFFFF = none yet), selects the delta baseline
+    uint32_t hashTick;       // tick the client reports its own state hash for (0xFFFFFFFF = no report)
+    uint32_t stateHash;      // low 32 bits of the client's computeStateHash() for hashTick
     uint8_t inputCount;      // number of inputs
     ClientInput inputs[32];
 
-    ClientInputPacket() : inputCount(0)
+    ClientInputPacket() : clientId(0), ackedTick(0xFFFFFFFFu), hashTick(0xFFFFFFFFu), stateHash(0), inputCount(0)
     {
         header.type = PacketType::CLIENT_INPUT;
         header.size = sizeof(ClientInputPacket);
@@ -148,35 +154,70 @@ struct SnapshotDeltaPacket
     }
 };
 
+// --------------------------------------------------------------
+//  SNAPSHOT FRAGMENT PACKET (see snapshot_builder.h)
+// --------------------------------------------------------------
+struct SnapshotFragmentPacket
+{
+    PacketHeader header;      // tick = snapshot tick
+    uint32_t baselineTick;    // 0xFFFFFFFF = encoded against nothing
+    uint8_t fragmentIndex;
+    uint8_t fragmentCount;    // a tick is complete (and may be acked) once all of these arrived
+    uint16_t entityCount;
+    uint16_t removedCount;
+    uint32_t stateHash;       // low 32 bits of the server's state hash for this tick (state_hash.h)
+
+    // Bit-packed body follows: quantization shifts, then removed IDs, then entity records
+
+    SnapshotFragmentPacket() : baselineTick(0xFFFFFFFFu), fragmentIndex(0), fragmentCount(0), entityCount(0), removedCount(0), stateHash(0)
+    {
+        header.type = PacketType::SERVER_SNAPSHOT_FRAGMENT;
+    }
+};
+
 #pragma pack(pop)
 
 
 // --------------------------------------------------------------
 //  SERIALIZATION OF SNAPSHOTS
 // --------------------------------------------------------------
-inline void serializeSnapshot(
+// Writes entities[first..] until the buffer is full and returns how many went in,
+// so callers loop over MTU-sized buffers instead of overflowing one (or PacketHeader::size).
+inline size_t serializeSnapshot(
     const std::vector<EntityState>& entities,
     uint8_t* outBuffer,
     size_t outCapacity,
     size_t& outSize,
-    uint32_t tick)
+    uint32_t tick,
+    size_t first = 0)
 {
     BufferWriter w(outBuffer, outCapacity);
 
+    size_t cap = outCapacity < 0xFFFF ? outCapacity : 0xFFFF; // header.size is 16 bits
+    size_t room = cap >= sizeof(PacketHeader) + sizeof(uint16_t)
+        ? (cap - sizeof(PacketHeader) - sizeof(uint16_t)) / sizeof(EntityState) : 0;
+    size_t remaining = first < entities.size() ? entities.size() - first : 0;
+    size_t count = remaining < room ? remaining : room;
+
     SnapshotPacket pkt;
-    pkt.entityCount = (uint16_t)entities.size();
+    pkt.entityCount = (uint16_t)count;
     pkt.header.tick = tick;
     pkt.header.size = (uint16_t)pkt.computeSize();
 
     w.write(pkt.header);
     w.write(pkt.entityCount);
 
-    for (const auto& e : entities)
-        w.write(e);
+    for (size_t i = 0; i < count; ++i)
+        w.write(entities[first + i]);
 
     outSize = w.offset;
+    return count;
 }
 
+// Index-aligned delta (before[i] and after[i] are the same slot). Bit-packed body after the byte header:
+//   per changed slot: index gap varint | mask 9 | masked fields
+//   pos/vel/health/radius as zigzag deltas, flags 16 raw, type 3 raw, id varint
+// entityCount in the packet header tells the reader how many slot records follow.
 inline void serializeDeltaSnapshot(
     const std::vector<EntityState>& before,
     const std::vector<EntityState>& after,
@@ -196,6 +237,9 @@ inline void serializeDeltaSnapshot(
     w.write(pkt.header);
     w.write(pkt.entityCount);
 
+    BitWriter bits(outBuffer + w.offset, outCapacity - w.offset);
+    size_t prevIndex = 0;
+
     for (size_t i = 0; i < before.size(); ++i)
     {
         const auto& A = before[i];
@@ -214,24 +258,28 @@ inline void serializeDeltaSnapshot(
         if (A.id != B.id)         entityMask |= (1 << 7);
         if (A.radius != B.radius) entityMask |= (1 << 8);
         // lifetime_ticks has not been added here for now
-
-        w.write((uint16_t)i);
-        w.write(entityMask);
-
-        if (entityMask & (1 << 0)) w.write(B.pos_x);
-        if (entityMask & (1 << 1)) w.write(B.pos_y);
-        if (entityMask & (1 << 2)) w.write(B.vel_x);
-        if (entityMask & (1 << 3)) w.write(B.vel_y);
-        if (entityMask & (1 << 4)) w.write(B.health);
-        if (entityMask & (1 << 5)) w.write(B.status_flags);
-        if (entityMask & (1 << 6)) w.write(B.type);
-        if (entityMask & (1 << 7)) w.write(B.id);
-        if (entityMask & (1 << 8)) w.write(B.radius);
+        if (entityMask == 0) continue; // only lifetime changed
+
+        // slot index as the gap to the previous changed slot
+        bits.writeVarint((uint32_t)(pkt.entityCount == 0 ? i : i - prevIndex - 1));
+        bits.writeBits(entityMask, 9);
+        prevIndex = i;
+
+        if (entityMask & (1 << 0)) bits.writeZigzag((int32_t)((uint32_t)B.pos_x - (uint32_t)A.pos_x));
+        if (entityMask & (1 << 1)) bits.writeZigzag((int32_t)((uint32_t)B.pos_y - (uint32_t)A.pos_y));
+        if (entityMask & (1 << 2)) bits.writeZigzag((int32_t)((uint32_t)B.vel_x - (uint32_t)A.vel_x));
+        if (entityMask & (1 << 3)) bits.writeZigzag((int32_t)((uint32_t)B.vel_y - (uint32_t)A.vel_y));
+        if (entityMask & (1 << 4)) bits.writeZigzag((int32_t)((uint32_t)B.health - (uint32_t)A.health));
+        if (entityMask & (1 << 5)) bits.writeBits(B.status_flags, 16);
+        if (entityMask & (1 << 6)) bits.writeBits((uint32_t)B.type, 3);
+        if (entityMask & (1 << 7)) bits.writeVarint(B.id);
+        if (entityMask & (1 << 8)) bits.writeZigzag((int32_t)((uint32_t)B.radius - (uint32_t)A.radius));
 
         pkt.entityCount++;
     }
 
-    size_t finalOffset = w.offset;
+    size_t finalOffset = w.offset + bits.finish();
+    assert(!bits.overflowed());
     w.offset = headerOffset;
     
     // Update Packet struct details
@@ -243,4 +291,3 @@ inline void serializeDeltaSnapshot(
 
     outSize = finalOffset;
 }
-
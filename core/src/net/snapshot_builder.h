@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "../snapshot.h"
+#include "bitstream.h"
+#include "packet_pool.h"
+#include "packets.h"
+
+// --------------------------------------------------------------
+//  MTU-AWARE SNAPSHOT BUILDER
+// --------------------------------------------------------------
+// Encodes one delta (cur vs. the client's acked baseline) straight into pooled send buffers,
+// split into self-contained SERVER_SNAPSHOT_FRAGMENT datagrams of at most MAX_PACKET_BYTES.
+// - every fragment is decodable on its own against the same baseline, so a client can show
+//   whatever arrived right away; it acks the tick only once it holds all fragmentCount pieces
+// - removed IDs go first, then entity records by priority (nearest to the client's focus
+//   first), so the first datagram carries what matters most to that player
+// - inside a fragment IDs are sorted and gap coded exactly like serializeDelta
+// - with a SnapshotView only what the client may see is diffed (interest.h)
+//
+// Fragment body (bits): pos/vel/health shift 5+5+5 | removed id gaps varint | per entity: id gap varint | record
+
+static_assert(MAX_PACKET_BYTES <= 0xFFFF, "PacketHeader::size is 16 bits");
+
+constexpr uint32_t MAX_SNAPSHOT_FRAGMENTS = 0xFF;
+
+// Where the client is looking from (usually its own champion)
+struct SnapshotFocus {
+    int32_t x = 0;
+    int32_t y = 0;
+};
+
+// What the client may see (interest.h): ascending entity ids, nullptr = everything.
+// Entities outside `base` are treated as unknown to the client, outside `cur` as gone.
+struct SnapshotView {
+    std::vector<uint32_t> const* cur = nullptr;  // visible now
+    std::vector<uint32_t> const* base = nullptr; // visible when the baseline was sent
+};
+
+class SnapshotPacketBuilder
+{
+public:
+    // Appends the fragments to `out`. Returns false (before taking any buffer) when the pool
+    // runs dry or the delta needs more than MAX_SNAPSHOT_FRAGMENTS; the client then simply
+    // stays on its older baseline for another tick.
+    bool build(SnapshotFrame const& cur, SnapshotFrame const* baseline, SnapshotQuantization const& q,
+               SnapshotFocus const* focus, PacketPool& pool, std::vector<PacketBuffer*>& out,
+               SnapshotView const& view = SnapshotView{})
+    {
+        static const SnapshotFrame empty_frame;
+        SnapshotFrame const& base = baseline ? *baseline : empty_frame;
+
+        collect(cur, base, q, focus, view);
+        uint32_t fragments = assign();
+        if (fragments > MAX_SNAPSHOT_FRAGMENTS || fragments > pool.available()) return false;
+
+        // group by fragment, ascending ID inside each one
+        auto by_fragment = [](Item const& a, Item const& b) {
+            return a.fragment != b.fragment ? a.fragment < b.fragment : a.id < b.id;
+        };
+        std::sort(records.begin(), records.end(), by_fragment);
+        std::sort(removed.begin(), removed.end(), by_fragment);
+
+        size_t ri = 0, di = 0;
+        for (uint32_t f = 0; f < fragments; ++f) {
+            PacketBuffer* buf = pool.acquire();
+
+            SnapshotFragmentPacket pkt;
+            pkt.header.tick = cur.server_tick;
+            pkt.baselineTick = baseline ? baseline->server_tick : NO_BASELINE;
+            pkt.fragmentIndex = static_cast<uint8_t>(f);
+            pkt.fragmentCount = static_cast<uint8_t>(fragments);
+            pkt.stateHash = static_cast<uint32_t>(cur.state_hash);
+
+            BitWriter w(buf->data + sizeof(SnapshotFragmentPacket), MAX_PACKET_BYTES - sizeof(SnapshotFragmentPacket));
+            w.writeBits(q.pos_shift, 5);
+            w.writeBits(q.vel_shift, 5);
+            w.writeBits(q.health_shift, 5);
+
+            uint32_t prev_id = 0;
+            for (; di < removed.size() && removed[di].fragment == f; ++di, ++pkt.removedCount) {
+                w.writeVarint(pkt.removedCount == 0 ? removed[di].id : removed[di].id - prev_id - 1);
+                prev_id = removed[di].id;
+            }
+            prev_id = 0;
+            for (; ri < records.size() && records[ri].fragment == f; ++ri, ++pkt.entityCount) {
+                Item const& it = records[ri];
+                w.writeVarint(pkt.entityCount == 0 ? it.id : it.id - prev_id - 1);
+                prev_id = it.id;
+                writeEntityRecord(w, cur.entities[it.cur_index],
+                                  it.base_index != NO_INDEX ? &base.entities[it.base_index] : nullptr, it.mask, q);
+            }
+
+            size_t bytes = sizeof(SnapshotFragmentPacket) + w.finish();
+            pkt.header.size = static_cast<uint16_t>(bytes);
+            memcpy(buf->data, &pkt, sizeof(pkt));
+            buf->size = static_cast<uint16_t>(bytes);
+            out.push_back(buf);
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = 0xFFFFFFFFu;
+    static constexpr uint32_t BODY_BITS = static_cast<uint32_t>((MAX_PACKET_BYTES - sizeof(SnapshotFragmentPacket)) * 8) - 15;
+
+    struct Item {
+        uint32_t id;
+        uint32_t cur_index;
+        uint32_t base_index; // NO_INDEX: new entity (or removed item)
+        uint8_t mask;
+        uint32_t bits;       // upper bound (ID costed as absolute, gaps are never larger)
+        uint64_t priority;   // lower goes first
+        uint32_t fragment;
+    };
+
+    // `ids` ascending, probed with ascending `id`: `k` is the caller's cursor
+    static bool visible(std::vector<uint32_t> const* ids, size_t& k, uint32_t id)
+    {
+        if (!ids) return true;
+        while (k < ids->size() && (*ids)[k] < id) ++k;
+        return k < ids->size() && (*ids)[k] == id;
+    }
+
+    void collect(SnapshotFrame const& cur, SnapshotFrame const& base, SnapshotQuantization const& q, SnapshotFocus const* focus,
+                 SnapshotView const& view)
+    {
+        records.clear();
+        removed.clear();
+
+        // same linear merge as serializeDelta, restricted to the view on both sides
+        size_t bi = 0, vc = 0, vb = 0;
+        for (uint32_t ci = 0; ci < cur.entities.size(); ++ci) {
+            NetEntity const& e = cur.entities[ci];
+            if (!visible(view.cur, vc, e.id)) continue;
+            while (bi < base.entities.size() && base.entities[bi].id < e.id) ++bi;
+            bool known = bi < base.entities.size() && base.entities[bi].id == e.id && base.entities[bi].type == e.type &&
+                         visible(view.base, vb, e.id);
+            uint8_t mask = known ? changeMask(e, base.entities[bi], q) : CH_All;
+            if (known && mask == 0) continue;
+
+            NetEntity const* b = known ? &base.entities[bi] : nullptr;
+            Item it;
+            it.id = e.id;
+            it.cur_index = ci;
+            it.base_index = known ? static_cast<uint32_t>(bi) : NO_INDEX;
+            it.mask = mask;
+            it.bits = varintBits(e.id) + entityRecordBits(e, b, mask, q);
+            it.priority = 0;
+            if (focus) {
+                int64_t dx = static_cast<int64_t>(e.pos_x) - focus->x;
+                int64_t dy = static_cast<int64_t>(e.pos_y) - focus->y;
+                it.priority = static_cast<uint64_t>(dx * dx + dy * dy);
+            }
+            it.fragment = 0;
+            records.push_back(it);
+        }
+
+        size_t ci = 0;
+        vc = vb = 0;
+        for (uint32_t k = 0; k < base.entities.size(); ++k) {
+            uint32_t id = base.entities[k].id;
+            if (!visible(view.base, vb, id)) continue; // the client never had it
+            while (ci < cur.entities.size() && cur.entities[ci].id < id) ++ci;
+            if (ci < cur.entities.size() && cur.entities[ci].id == id && visible(view.cur, vc, id)) continue;
+            removed.push_back(Item{ id, NO_INDEX, NO_INDEX, 0, varintBits(id), 0, 0 });
+        }
+
+        // nearest first, ties by ID so the split is deterministic
+        std::sort(records.begin(), records.end(), [](Item const& a, Item const& b) {
+            return a.priority != b.priority ? a.priority < b.priority : a.id < b.id;
+        });
+    }
+
+    // Greedy fill in priority order. Returns the number of fragments (at least 1, so an
+    // empty delta still tells the client the tick happened).
+    uint32_t assign()
+    {
+        uint32_t fragment = 0;
+        uint32_t used = 0;
+        auto place = [&](Item& it) {
+            if (used + it.bits > BODY_BITS) { ++fragment; used = 0; }
+            used += it.bits;
+            it.fragment = fragment;
+        };
+        for (Item& it : removed) place(it);
+        for (Item& it : records) place(it);
+        return fragment + 1;
+    }
+
+    std::vector<Item> records; // scratch, reused across builds
+    std::vector<Item> removed;
+};
+
+// Client side (and tools): apply one fragment to `frame`. When `frame` doesn't hold the
+// fragment's tick yet it is first seeded from `baseline`. Returns false on a malformed packet
+// or baseline mismatch.
+inline bool applySnapshotFragment(const uint8_t* data, size_t size, SnapshotFrame const* baseline, SnapshotFrame& frame)
+{
+    if (size < sizeof(SnapshotFragmentPacket)) return false;
+    SnapshotFragmentPacket pkt;
+    memcpy(&pkt, data, sizeof(pkt));
+    if (pkt.header.type != PacketType::SERVER_SNAPSHOT_FRAGMENT || pkt.header.size > size) return false;
+
+    if (!frame.valid || frame.server_tick != pkt.header.tick) {
+        if (pkt.baselineTick != NO_BASELINE && (!baseline || baseline->server_tick != pkt.baselineTick)) return false;
+        frame.entities.clear();
+        if (pkt.baselineTick != NO_BASELINE) frame.entities = baseline->entities;
+        frame.server_tick = pkt.header.tick;
+        frame.valid = true;
+    }
+    frame.state_hash = pkt.stateHash;
+
+    BitReader r(data + sizeof(pkt), pkt.header.size - sizeof(pkt));
+    SnapshotQuantization q;
+    q.pos_shift = static_cast<uint8_t>(r.readBits(5));
+    q.vel_shift = static_cast<uint8_t>(r.readBits(5));
+    q.health_shift = static_cast<uint8_t>(r.readBits(5));
+
+    uint32_t id = 0;
+    for (uint32_t k = 0; k < pkt.removedCount && !r.overflowed(); ++k) {
+        uint32_t gap = r.readVarint();
+        id = k == 0 ? gap : id + gap + 1;
+        removeEntity(frame, id);
+    }
+    for (uint32_t k = 0; k < pkt.entityCount && !r.overflowed(); ++k) {
+        uint32_t gap = r.readVarint();
+        id = k == 0 ? gap : id + gap + 1; // records restart the gap chain
+        if (!readEntityRecord(r, id, q, frame)) return false;
+    }
+    return !r.overflowed();
+}
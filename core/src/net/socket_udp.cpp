@@ -0,0 +1,153 @@
+#include "socket_udp.h"
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#define MOBA_HAS_SENDMMSG 1
+#endif
+
+struct UdpSocket::BatchScratch
+{
+#ifdef MOBA_HAS_SENDMMSG
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iovs;
+#endif
+    std::vector<sockaddr_in> addrs;
+};
+
+static sockaddr_in ToSockaddr(UdpEndpoint const& ep)
+{
+    sockaddr_in a;
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(ep.ipv4);
+    a.sin_port = htons(ep.port);
+    return a;
+}
+
+UdpSocket::UdpSocket() : scratch(new BatchScratch()) {}
+
+UdpSocket::~UdpSocket()
+{
+    close();
+}
+
+bool UdpSocket::open(uint16_t port)
+{
+    close();
+#ifdef _WIN32
+    static bool wsa_started = false;
+    if (!wsa_started) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+        wsa_started = true;
+    }
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET) return false;
+    u_long non_blocking = 1;
+    ioctlsocket(s, FIONBIO, &non_blocking);
+#else
+    int s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0) return false;
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    handle = static_cast<Handle>(s);
+
+    UdpEndpoint any;
+    any.port = port;
+    sockaddr_in addr = ToSockaddr(any);
+    if (::bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void UdpSocket::close()
+{
+    if (handle == INVALID_HANDLE) return;
+#ifdef _WIN32
+    ::closesocket(static_cast<SOCKET>(handle));
+#else
+    ::close(handle);
+#endif
+    handle = INVALID_HANDLE;
+}
+
+size_t UdpSocket::sendBatch(const OutgoingDatagram* datagrams, size_t count)
+{
+    if (handle == INVALID_HANDLE || count == 0) return 0;
+
+    BatchScratch& sc = *scratch;
+    if (sc.addrs.size() < count) sc.addrs.resize(count);
+    for (size_t i = 0; i < count; ++i) sc.addrs[i] = ToSockaddr(datagrams[i].to);
+
+#ifdef MOBA_HAS_SENDMMSG
+    if (sc.msgs.size() < count) {
+        sc.msgs.resize(count);
+        sc.iovs.resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        // point straight into the pooled buffer: no copy before the kernel
+        sc.iovs[i].iov_base = datagrams[i].buffer->data;
+        sc.iovs[i].iov_len = datagrams[i].buffer->size;
+        mmsghdr& m = sc.msgs[i];
+        memset(&m, 0, sizeof(m));
+        m.msg_hdr.msg_name = &sc.addrs[i];
+        m.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        m.msg_hdr.msg_iov = &sc.iovs[i];
+        m.msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int n = ::sendmmsg(handle, sc.msgs.data() + sent, static_cast<unsigned>(count - sent), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            break; // EAGAIN: socket buffer full, the rest goes next tick
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return sent;
+#else
+    size_t sent = 0;
+    for (; sent < count; ++sent) {
+        const PacketBuffer* b = datagrams[sent].buffer;
+        int n = ::sendto(handle, reinterpret_cast<const char*>(b->data), b->size, 0,
+                         reinterpret_cast<const sockaddr*>(&sc.addrs[sent]), sizeof(sockaddr_in));
+        if (n < 0) break;
+    }
+    return sent;
+#endif
+}
+
+int UdpSocket::receive(uint8_t* buffer, size_t capacity, UdpEndpoint& from)
+{
+    if (handle == INVALID_HANDLE) return -1;
+    sockaddr_in addr;
+#ifdef _WIN32
+    int len = sizeof(addr);
+    int n = ::recvfrom(handle, reinterpret_cast<char*>(buffer), static_cast<int>(capacity), 0,
+                       reinterpret_cast<sockaddr*>(&addr), &len);
+    if (n < 0) return WSAGetLastError() == WSAEWOULDBLOCK ? 0 : -1;
+#else
+    socklen_t len = sizeof(addr);
+    ssize_t n = ::recvfrom(handle, buffer, capacity, 0, reinterpret_cast<sockaddr*>(&addr), &len);
+    if (n < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+#endif
+    from.ipv4 = ntohl(addr.sin_addr.s_addr);
+    from.port = ntohs(addr.sin_port);
+    return static_cast<int>(n);
+}
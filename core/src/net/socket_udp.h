@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "packet_pool.h"
+
+// --------------------------------------------------------------
+//  UDP SOCKET
+// --------------------------------------------------------------
+// Thin non-blocking IPv4 UDP socket. sendBatch() gathers pooled PacketBuffers straight into one
+// sendmmsg() call on Linux (one syscall per batch, the kernel reads our buffers directly);
+// other platforms fall back to a sendto() loop over the same buffers.
+
+struct UdpEndpoint
+{
+    uint32_t ipv4 = 0;   // host byte order, e.g. 0x7F000001 = 127.0.0.1
+    uint16_t port = 0;   // host byte order
+};
+
+struct OutgoingDatagram
+{
+    const PacketBuffer* buffer;
+    UdpEndpoint to;
+};
+
+class UdpSocket
+{
+public:
+    UdpSocket();
+    ~UdpSocket();
+
+    UdpSocket(UdpSocket const&) = delete;
+    UdpSocket& operator=(UdpSocket const&) = delete;
+
+    // Bind to `port` on all interfaces (0 = any free port)
+    bool open(uint16_t port);
+    void close();
+    bool isOpen() const { return handle != INVALID_HANDLE; }
+
+    // Returns how many datagrams the kernel accepted (stops at the first would-block/error).
+    // The buffers are only read during the call, so the caller may release them right after.
+    size_t sendBatch(const OutgoingDatagram* datagrams, size_t count);
+
+    // Non-blocking receive. Returns the datagram size, 0 when nothing is pending, -1 on error.
+    int receive(uint8_t* buffer, size_t capacity, UdpEndpoint& from);
+
+private:
+#ifdef _WIN32
+    using Handle = uintptr_t;
+#else
+    using Handle = int;
+#endif
+    static constexpr Handle INVALID_HANDLE = static_cast<Handle>(-1);
+
+    Handle handle = INVALID_HANDLE;
+
+    // sendmmsg headers/iovecs/addresses, grown once to the largest batch seen
+    struct BatchScratch;
+    std::unique_ptr<BatchScratch> scratch;
+};
@@ -1,69 +1,376 @@
 #include "physics.h"
 #include <algorithm>
+#include <cassert>
+#include <cmath>
 
-int32_t SpatialGrid::GetCellIndex(int32_t fixed_x, int32_t fixed_y) const {
-    int32_t cx = fixed_x / CELL_SIZE;
-    int32_t cy = fixed_y / CELL_SIZE;
+// ---------- Cell math policies ----------
+// Map a fixed-point offset from the grid origin to a (floored) cell coordinate.
+// The common map's power-of-two cell size is a template parameter, so the hot loops
+// compile down to an immediate shift instead of an integer divide.
 
+template<int32_t Shift>
+struct ShiftCells {
+    int32_t operator()(int32_t d) const { return d >> Shift; }
+};
+
+struct VarShiftCells {
+    int32_t shift;
+    int32_t operator()(int32_t d) const { return d >> shift; }
+};
+
+struct DivCells {
+    int32_t size;
+    int32_t operator()(int32_t d) const {
+        // floor division, so negative offsets match the shift paths bit for bit
+        int32_t q = d / size;
+        return (d % size != 0 && d < 0) ? q - 1 : q;
+    }
+};
+
+template<typename Fn>
+static void WithCellMath(int32_t cell_size, int32_t cell_shift, Fn&& fn) {
+    if (cell_shift == COMMON_CELL_SHIFT) fn(ShiftCells<COMMON_CELL_SHIFT>{});
+    else if (cell_shift >= 0) fn(VarShiftCells{cell_shift});
+    else fn(DivCells{cell_size});
+}
+
+static inline int32_t ClampCell(int32_t c, int32_t n) {
     // prevent memory access out of bondaries of the map
-    cx = std::max(0, std::min(cx, MAP_WIDTH_CELLS - 1));
-    cy = std::max(0, std::min(cy, MAP_HEIGHT_CELLS - 1));
+    return std::max(0, std::min(c, n - 1));
+}
+
+static int32_t Log2IfPow2(int32_t v) {
+    if (v <= 0 || (v & (v - 1)) != 0) return -1;
+    int32_t s = 0;
+    while ((1 << s) != v) ++s;
+    return s;
+}
+
+// ---------- Configuration ----------
 
-    // 2d grid --> 1 dimension array
-    return cy * MAP_WIDTH_CELLS + cx;
+void SpatialGrid::Configure(GridConfig const& cfg) {
+    config = cfg;
+    config.cell_size = std::max(1, cfg.cell_size);
+    config.width_cells = std::max(1, std::min(cfg.width_cells, 0xFFFF));
+    config.height_cells = std::max(1, std::min(cfg.height_cells, 0xFFFF));
+    config.levels = std::max(1, std::min(cfg.levels, MAX_GRID_LEVELS));
+
+    level_count = 0;
+    for (int32_t k = 0; k < config.levels; ++k) {
+        int64_t size = static_cast<int64_t>(config.cell_size) << k;
+        if (size > 0x3FFFFFFF) break;
+
+        Level& lv = levels[k];
+        lv.cell_size = static_cast<int32_t>(size);
+        lv.cell_shift = Log2IfPow2(lv.cell_size);
+        lv.width = (config.width_cells + (1 << k) - 1) >> k;
+        lv.height = (config.height_cells + (1 << k) - 1) >> k;
+
+        size_t cells = static_cast<size_t>(lv.width) * lv.height;
+        lv.items.clear();
+        lv.entries.clear();
+        lv.occupied.clear();
+        lv.cell_start.assign(cells, 0);
+        lv.cell_count.assign(cells, 0);
+        lv.cell_fill.assign(cells, 0);
+        ++level_count;
+    }
+    built = false;
 }
 
+// ---------- Per-tick build ----------
+
 void SpatialGrid::Clear() {
-    for (auto& cell : cells) {
-        cell.clear();
+    for (int32_t k = 0; k < level_count; ++k) {
+        Level& lv = levels[k];
+        // only the cells touched by the last build need resetting
+        for (uint32_t cell : lv.occupied) {
+            lv.cell_count[cell] = 0;
+            lv.cell_fill[cell] = 0;
+        }
+        lv.occupied.clear();
+        lv.items.clear();
+        lv.entries.clear();
     }
+    built = false;
 }
 
 void SpatialGrid::Insert(const EntityState& entity) {
-    // for now insert the entity's center point into the grid. this means very large entities might not be registered in all occupied cells
-    int32_t index = GetCellIndex(entity.pos_x, entity.pos_y);
-    cells[index].push_back(entity.id);
+    Insert(entity.id, entity.pos_x, entity.pos_y, entity.radius);
 }
 
-std::vector<uint32_t> SpatialGrid::QueryRadius(int32_t center_x, int32_t center_y, int32_t radius) const {
-    std::vector<uint32_t> found_entities;
+template<typename CellMath>
+void SpatialGrid::InsertImpl(Level& lv, CellMath cm, uint32_t entity_id, int32_t x, int32_t y, int32_t r) {
+    int32_t dx = x - config.origin_x;
+    int32_t dy = y - config.origin_y;
+    Item it;
+    it.id = entity_id;
+    it.min_cx = static_cast<uint16_t>(ClampCell(cm(dx - r), lv.width));
+    it.min_cy = static_cast<uint16_t>(ClampCell(cm(dy - r), lv.height));
+    it.max_cx = static_cast<uint16_t>(ClampCell(cm(dx + r), lv.width));
+    it.max_cy = static_cast<uint16_t>(ClampCell(cm(dy + r), lv.height));
+    lv.items.push_back(it);
+}
 
-    // broad-phase collision attempt
-    int32_t min_x = center_x - radius;
-    int32_t max_x = center_x + radius;
-    int32_t min_y = center_y - radius;
-    int32_t max_y = center_y + radius;
+void SpatialGrid::Insert(uint32_t entity_id, int32_t pos_x, int32_t pos_y, int32_t radius) {
+    int32_t r = radius > 0 ? radius : 0;
 
-    int32_t start_cx = std::max(0, min_x / CELL_SIZE);
-    int32_t end_cx   = std::min(MAP_WIDTH_CELLS - 1, max_x / CELL_SIZE);
-    int32_t start_cy = std::max(0, min_y / CELL_SIZE);
-    int32_t end_cy   = std::min(MAP_HEIGHT_CELLS - 1, max_y / CELL_SIZE);
+    // finest level whose cells can hold the entity's diameter
+    int32_t k = 0;
+    int64_t diameter = static_cast<int64_t>(r) * 2;
+    while (k + 1 < level_count && levels[k].cell_size < diameter) ++k;
+
+    Level& lv = levels[k];
+    WithCellMath(lv.cell_size, lv.cell_shift, [&](auto cm) {
+        InsertImpl(lv, cm, entity_id, pos_x, pos_y, r);
+    });
+}
+
+void SpatialGrid::BuildLevel(Level& lv) {
+    // 1) count entries per cell, remembering which cells are occupied
+    size_t total = 0;
+    for (Item const& it : lv.items) {
+        for (int32_t cy = it.min_cy; cy <= it.max_cy; ++cy) {
+            for (int32_t cx = it.min_cx; cx <= it.max_cx; ++cx) {
+                uint32_t cell = static_cast<uint32_t>(cy * lv.width + cx);
+                if (lv.cell_count[cell]++ == 0) lv.occupied.push_back(cell);
+                ++total;
+            }
+        }
+    }
+
+    // 2) prefix sum over occupied cells only
+    uint32_t offset = 0;
+    for (uint32_t cell : lv.occupied) {
+        lv.cell_start[cell] = offset;
+        offset += lv.cell_count[cell];
+    }
+
+    // 3) scatter into the single contiguous entry array
+    lv.entries.resize(total);
+    for (Item const& it : lv.items) {
+        Entry e;
+        e.id = it.id;
+        e.min_cx = it.min_cx;
+        e.min_cy = it.min_cy;
+        for (int32_t cy = it.min_cy; cy <= it.max_cy; ++cy) {
+            for (int32_t cx = it.min_cx; cx <= it.max_cx; ++cx) {
+                uint32_t cell = static_cast<uint32_t>(cy * lv.width + cx);
+                lv.entries[lv.cell_start[cell] + lv.cell_fill[cell]++] = e;
+            }
+        }
+    }
+}
+
+void SpatialGrid::Build() {
+    for (int32_t k = 0; k < level_count; ++k) BuildLevel(levels[k]);
+    built = true;
+}
+
+size_t SpatialGrid::OccupiedCellCount() const {
+    size_t n = 0;
+    for (int32_t k = 0; k < level_count; ++k) n += levels[k].occupied.size();
+    return n;
+}
+
+// ---------- Queries ----------
+
+template<typename CellMath>
+void SpatialGrid::GatherImpl(Level const& lv, CellMath cm, int32_t center_x, int32_t center_y, int32_t radius, std::vector<uint32_t>& out) const {
+    // broad-phase collision attempt
+    int32_t dx = center_x - config.origin_x;
+    int32_t dy = center_y - config.origin_y;
+    int32_t start_cx = ClampCell(cm(dx - radius), lv.width);
+    int32_t end_cx   = ClampCell(cm(dx + radius), lv.width);
+    int32_t start_cy = ClampCell(cm(dy - radius), lv.height);
+    int32_t end_cy   = ClampCell(cm(dy + radius), lv.height);
 
     for (int32_t cy = start_cy; cy <= end_cy; ++cy) {
         for (int32_t cx = start_cx; cx <= end_cx; ++cx) {
-            int32_t index = cy * MAP_WIDTH_CELLS + cx;
-            for (uint32_t id : cells[index]) {
-                found_entities.push_back(id);
+            int32_t index = cy * lv.width + cx;
+            uint32_t count = lv.cell_count[index];
+            if (count == 0) continue;
+            Entry const* e = lv.entries.data() + lv.cell_start[index];
+            for (uint32_t k = 0; k < count; ++k) {
+                // multi-cell entities are reported only from the first cell where their AABB
+                // and the query rect overlap, so no unique() pass is needed
+                int32_t ref_cx = std::max<int32_t>(start_cx, e[k].min_cx);
+                int32_t ref_cy = std::max<int32_t>(start_cy, e[k].min_cy);
+                if (cx == ref_cx && cy == ref_cy) out.push_back(e[k].id);
             }
         }
     }
+}
+
+void SpatialGrid::QueryRadius(int32_t center_x, int32_t center_y, int32_t radius, std::vector<uint32_t>& out) const {
+    assert(built && "SpatialGrid::Build() must run before queries");
+    out.clear();
+
+    // every entity lives in exactly one level, so the levels never report duplicates
+    int32_t r = radius > 0 ? radius : 0;
+    for (int32_t k = 0; k < level_count; ++k) {
+        Level const& lv = levels[k];
+        if (lv.entries.empty()) continue;
+        WithCellMath(lv.cell_size, lv.cell_shift, [&](auto cm) {
+            GatherImpl(lv, cm, center_x, center_y, r, out);
+        });
+    }
 
     // deterministic sort by ID so abilities always affect targets in the exact same order
-    std::sort(found_entities.begin(), found_entities.end());
-    
-    // remove duplicate IDs
-    found_entities.erase(std::unique(found_entities.begin(), found_entities.end()), found_entities.end());
+    std::sort(out.begin(), out.end());
+}
 
+std::vector<uint32_t> SpatialGrid::QueryRadius(int32_t center_x, int32_t center_y, int32_t radius) const {
+    std::vector<uint32_t> found_entities;
+    QueryRadius(center_x, center_y, radius, found_entities);
     return found_entities;
 }
 
+template<typename CellMath>
+void SpatialGrid::SweepImpl(Level const& lv, CellMath cm, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t radius,
+                            std::vector<uint32_t>& out) const {
+    int64_t ax = static_cast<int64_t>(x0) - config.origin_x;
+    int64_t ay = static_cast<int64_t>(y0) - config.origin_y;
+    int64_t dx = static_cast<int64_t>(x1) - x0;
+    int64_t dy = static_cast<int64_t>(y1) - y0;
+    int32_t cx = cm(static_cast<int32_t>(ax));
+    int32_t cy = cm(static_cast<int32_t>(ay));
+    int32_t end_cx = cm(static_cast<int32_t>(ax + dx));
+    int32_t end_cy = cm(static_cast<int32_t>(ay + dy));
+
+    // anything overlapping the swept circle has its AABB within `band` cells of a cell on the
+    // segment (the radius, rounded up, plus the cell the touching point falls into)
+    int32_t band = cm(radius) + 1;
+    auto visit = [&](int32_t vx, int32_t vy) {
+        int32_t x_lo = ClampCell(vx - band, lv.width), x_hi = ClampCell(vx + band, lv.width);
+        int32_t y_lo = ClampCell(vy - band, lv.height), y_hi = ClampCell(vy + band, lv.height);
+        for (int32_t y = y_lo; y <= y_hi; ++y) {
+            for (int32_t x = x_lo; x <= x_hi; ++x) {
+                int32_t index = y * lv.width + x;
+                uint32_t count = lv.cell_count[index];
+                if (count == 0) continue;
+                Entry const* e = lv.entries.data() + lv.cell_start[index];
+                for (uint32_t k = 0; k < count; ++k) out.push_back(e[k].id);
+            }
+        }
+    };
+
+    // Amanatides-Woo: every step crosses exactly one cell boundary, x or y, whichever the
+    // segment reaches first. Times are compared as cross products instead of divided out.
+    int32_t step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+    int64_t adx = dx < 0 ? -dx : dx, ady = dy < 0 ? -dy : dy;
+    int64_t size = lv.cell_size;
+    uint32_t steps = static_cast<uint32_t>(std::abs(end_cx - cx)) + static_cast<uint32_t>(std::abs(end_cy - cy));
+    visit(cx, cy);
+    for (uint32_t n = 0; n < steps; ++n) {
+        bool along_x;
+        if (cx == end_cx) along_x = false;
+        else if (cy == end_cy) along_x = true;
+        else {
+            // distance to the next boundary on each axis (>= 0), scaled by the other axis' speed
+            int64_t to_x = (step_x > 0 ? (cx + 1) * size - ax : ax - cx * size);
+            int64_t to_y = (step_y > 0 ? (cy + 1) * size - ay : ay - cy * size);
+            along_x = to_x * ady <= to_y * adx;
+        }
+        if (along_x) cx += step_x;
+        else cy += step_y;
+        visit(cx, cy);
+    }
+}
+
+void SpatialGrid::QuerySegment(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t radius, std::vector<uint32_t>& out) const {
+    assert(built && "SpatialGrid::Build() must run before queries");
+    out.clear();
+
+    int32_t r = radius > 0 ? radius : 0;
+    for (int32_t k = 0; k < level_count; ++k) {
+        Level const& lv = levels[k];
+        if (lv.entries.empty()) continue;
+        WithCellMath(lv.cell_size, lv.cell_shift, [&](auto cm) {
+            SweepImpl(lv, cm, x0, y0, x1, y1, r, out);
+        });
+    }
+
+    // the bands of neighbouring steps overlap and multi-cell entities sit in several cells
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+// ---------- Narrow phase ----------
+
 bool SpatialGrid::CheckCollision(const EntityState& a, const EntityState& b) {
-    int64_t dx = static_cast<int64_t>(a.pos_x) - b.pos_x;
-    int64_t dy = static_cast<int64_t>(a.pos_y) - b.pos_y;
+    return CheckCollision(a.pos_x, a.pos_y, a.radius, b.pos_x, b.pos_y, b.radius);
+}
+
+bool SpatialGrid::CheckCollision(int32_t ax, int32_t ay, int32_t ar, int32_t bx, int32_t by, int32_t br) {
+    int64_t dx = static_cast<int64_t>(ax) - bx;
+    int64_t dy = static_cast<int64_t>(ay) - by;
     int64_t dist_sq = (dx * dx) + (dy * dy);
-    
-    int64_t radius_sum = static_cast<int64_t>(a.radius) + b.radius;
+
+    int64_t radius_sum = static_cast<int64_t>(ar) + br;
     int64_t radius_sq = radius_sum * radius_sum;
-    
+
     return dist_sq <= radius_sq;
-}
\ No newline at end of file
+}
+
+// floor(sqrt(v)): the double estimate is correctly rounded (IEEE), the loops fix the last unit
+static uint64_t ISqrt(uint64_t v) {
+    uint64_t r = static_cast<uint64_t>(std::sqrt(static_cast<double>(v)));
+    while (r > 0 && r * r > v) --r;
+    while ((r + 1) * (r + 1) <= v) ++r;
+    return r;
+}
+
+bool SpatialGrid::SweepCollision(int32_t ax0, int32_t ay0, int32_t ax1, int32_t ay1, int32_t ar, int32_t bx, int32_t by, int32_t br,
+                                 uint32_t& t_q16) {
+    if (CheckCollision(ax0, ay0, ar, bx, by, br)) {
+        t_q16 = 0;
+        return true;
+    }
+
+    // outside the segment's box grown by both radii: no contact anywhere along it
+    int64_t reach = static_cast<int64_t>(ar) + br;
+    if (bx < std::min(ax0, ax1) - reach || bx > std::max(ax0, ax1) + reach ||
+        by < std::min(ay0, ay1) - reach || by > std::max(ay0, ay1) + reach) {
+        return false;
+    }
+
+    // |f + t d| = R for the first t in (0, 1]: a t^2 + 2 b t + c = 0, t = (-b - sqrt(b^2 - a c)) / a.
+    // Past the box test every term is bounded by the segment plus the radii; beyond
+    // SWEEP_EXACT_RANGE all of them are scaled down together so b^2 and a c can't overflow.
+    int64_t dx = static_cast<int64_t>(ax1) - ax0, dy = static_cast<int64_t>(ay1) - ay0;
+    int64_t fx = static_cast<int64_t>(ax0) - bx, fy = static_cast<int64_t>(ay0) - by;
+    int64_t span = std::max(dx < 0 ? -dx : dx, dy < 0 ? -dy : dy) + reach;
+    int32_t shift = 0;
+    while ((span >> shift) >= SWEEP_EXACT_RANGE) ++shift;
+    dx >>= shift;
+    dy >>= shift;
+    fx >>= shift;
+    fy >>= shift;
+    reach >>= shift;
+
+    int64_t a = dx * dx + dy * dy;
+    int64_t b = fx * dx + fy * dy;
+    int64_t c = fx * fx + fy * fy - reach * reach;
+    uint64_t t_end = uint64_t(1) << 16;
+    if (a > 0 && b < 0) {
+        if (c <= 0) { // only after scaling
+            t_q16 = 0;
+            return true;
+        }
+        int64_t disc = b * b - a * c;
+        if (disc >= 0) {
+            int64_t entry = -b - static_cast<int64_t>(ISqrt(static_cast<uint64_t>(disc)));
+            if (entry <= a) {
+                t_q16 = static_cast<uint32_t>((static_cast<uint64_t>(entry) << 16) / static_cast<uint64_t>(a));
+                return true;
+            }
+        }
+    }
+    // the end point decides on its own (rounding above must not lose what CheckCollision sees)
+    if (CheckCollision(ax1, ay1, ar, bx, by, br)) {
+        t_q16 = static_cast<uint32_t>(t_end);
+        return true;
+    }
+    return false;
+}
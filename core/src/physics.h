@@ -1,29 +1,132 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <algorithm>
+#include <utility>
 #include "entity_state.h"
 
-// POS_SCALE = 1000. A cell size of 5.0 world units = 5000 fixed-point units.
-constexpr int32_t CELL_SIZE = 5000; 
-constexpr int32_t MAP_WIDTH_CELLS = 30; // 150x150 world units map
-constexpr int32_t MAP_HEIGHT_CELLS = 30;
+// Defaults used until map data is loaded (POS_SCALE = 1000, so 5000 = 5.0 world units).
+constexpr int32_t DEFAULT_CELL_SIZE = 5000;
+constexpr int32_t DEFAULT_MAP_WIDTH_CELLS = 30; // 150x150 world units map
+constexpr int32_t DEFAULT_MAP_HEIGHT_CELLS = 30;
+constexpr int32_t MAX_GRID_LEVELS = 4;
 
+// Cell size of the common map as a power of two (1 << 12 = 4.096 world units).
+// Level 0 of a grid with exactly this cell size runs the shift-specialized fast path.
+constexpr int32_t COMMON_CELL_SHIFT = 12;
+
+// Grid geometry, normally coming from game/map_defs.json
+struct GridConfig {
+    int32_t cell_size = DEFAULT_CELL_SIZE; // fixed-point, level 0
+    int32_t width_cells = DEFAULT_MAP_WIDTH_CELLS; // level 0
+    int32_t height_cells = DEFAULT_MAP_HEIGHT_CELLS;
+    int32_t origin_x = 0; // fixed-point world position of the grid's min corner
+    int32_t origin_y = 0;
+    // Hierarchical levels: level k has cells of cell_size << k. Each entity goes to the
+    // finest level whose cells are at least its diameter, so big AoE entities and tiny
+    // projectiles both land in a level where they touch at most 2x2 cells.
+    int32_t levels = 1;
+};
+
+// Flat CSR-style hierarchical grid, rebuilt every tick:
+//   Clear() -> Insert() for every entity -> Build() -> queries
+// Build() is a counting sort per level: count entries per cell, prefix-sum the occupied cells,
+// scatter into one contiguous array. Every entity is registered in all cells its AABB overlaps.
+// Clear/Build/query cost scales with occupied cells, never with the full map,
+// and nothing allocates once the buffers have grown to the match's peak entity count.
+// Positions outside the map are clamped into the border cells (so map data must cover the playable area).
 class SpatialGrid {
 private:
-    // Flat array representing the 2D grid.
-    // Each cell holds a list of Entity IDs.
-    std::vector<uint32_t> cells[MAP_WIDTH_CELLS * MAP_HEIGHT_CELLS];
+    struct Item {
+        uint32_t id;
+        uint16_t min_cx, min_cy, max_cx, max_cy; // AABB in cells of its level (inclusive)
+    };
+
+    // One grid entry, stored contiguously per cell
+    struct Entry {
+        uint32_t id;
+        uint16_t min_cx, min_cy; // first cell of the entity's AABB (used to report each entity once)
+    };
+
+    struct Level {
+        int32_t cell_size = 0;
+        int32_t cell_shift = -1; // log2(cell_size) when it is a power of two, -1 otherwise
+        int32_t width = 0;
+        int32_t height = 0;
 
-    // Helper: fixed-point world coordinates to a 1D array index
-    int32_t GetCellIndex(int32_t fixed_x, int32_t fixed_y) const;
+        std::vector<Item> items;        // pending inserts for this tick
+        std::vector<Entry> entries;     // CSR payload
+        std::vector<uint32_t> occupied; // cells with count > 0 (only these get reset)
+        std::vector<uint32_t> cell_start;
+        std::vector<uint32_t> cell_count;
+        std::vector<uint32_t> cell_fill;
+    };
+
+    GridConfig config;
+    Level levels[MAX_GRID_LEVELS];
+    int32_t level_count = 0;
+    mutable std::vector<uint32_t> scratch; // default buffer for single-threaded queries
+    bool built = false;
+
+    template<typename CellMath> void InsertImpl(Level& lv, CellMath cm, uint32_t entity_id, int32_t x, int32_t y, int32_t r);
+    template<typename CellMath> void GatherImpl(Level const& lv, CellMath cm, int32_t x, int32_t y, int32_t r, std::vector<uint32_t>& out) const;
+    template<typename CellMath> void SweepImpl(Level const& lv, CellMath cm, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t r,
+                                               std::vector<uint32_t>& out) const;
+    static void BuildLevel(Level& lv);
 
 public:
+    SpatialGrid() { Configure(GridConfig{}); }
+    explicit SpatialGrid(GridConfig const& cfg) { Configure(cfg); }
+
+    // (Re)allocates the cell tables. Not a per-tick call.
+    void Configure(GridConfig const& cfg);
+    GridConfig const& Config() const { return config; }
+
     void Clear();
     void Insert(const EntityState& entity);
-    
-    // broad-phase collision query -> entity IDs
+    void Insert(uint32_t entity_id, int32_t pos_x, int32_t pos_y, int32_t radius);
+    void Build();
+
+    // broad-phase collision query -> entity IDs, ascending and unique.
+    // `out` is caller-owned and reused: it is cleared and filled, no allocation once it has grown.
+    void QueryRadius(int32_t center_x, int32_t center_y, int32_t radius, std::vector<uint32_t>& out) const;
+    // convenience version that returns a fresh vector (tools/tests, not the tick path)
     std::vector<uint32_t> QueryRadius(int32_t center_x, int32_t center_y, int32_t radius) const;
-    
+
+    // broad phase for a circle of `radius` swept from (x0, y0) to (x1, y1): walks the cells the
+    // segment crosses on every level (integer DDA, no per-step divide) plus a band of cells
+    // wide enough for the radius. IDs ascending and unique, `out` reused as in QueryRadius.
+    // Cost follows the segment length in cells, not its bounding box.
+    void QuerySegment(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t radius, std::vector<uint32_t>& out) const;
+
+    // Calls fn(entity_id) for every broad-phase candidate in ascending ID order.
+    // fn returns false to stop early. `buffer` is caller-owned scratch (one per thread).
+    template<typename Fn>
+    void ForEachInRadius(int32_t center_x, int32_t center_y, int32_t radius, std::vector<uint32_t>& buffer, Fn&& fn) const {
+        QueryRadius(center_x, center_y, radius, buffer);
+        for (uint32_t id : buffer) {
+            if (!fn(id)) break;
+        }
+    }
+
+    // Same, using the grid's own scratch buffer (single-threaded callers only)
+    template<typename Fn>
+    void ForEachInRadius(int32_t center_x, int32_t center_y, int32_t radius, Fn&& fn) const {
+        ForEachInRadius(center_x, center_y, radius, scratch, std::forward<Fn>(fn));
+    }
+
+    size_t OccupiedCellCount() const;
+
     // exact-phase collision check (Circle-Circle)
     static bool CheckCollision(const EntityState& a, const EntityState& b);
-};
\ No newline at end of file
+    static bool CheckCollision(int32_t ax, int32_t ay, int32_t ar, int32_t bx, int32_t by, int32_t br);
+
+    // Swept narrow phase (capsule vs circle): circle a moving from (ax0, ay0) to (ax1, ay1)
+    // against circle b at rest. On a hit `t_q16` is where along the segment they first touch
+    // (0 = start, 65536 = end) for earliest-hit ordering. Integer only; both ends agree with
+    // CheckCollision exactly. Exact while the segment plus both radii stay within 32 world
+    // units per axis (SWEEP_EXACT_RANGE), coarser but still deterministic beyond.
+    static bool SweepCollision(int32_t ax0, int32_t ay0, int32_t ax1, int32_t ay1, int32_t ar, int32_t bx, int32_t by, int32_t br,
+                               uint32_t& t_q16);
+    static constexpr int64_t SWEEP_EXACT_RANGE = 1 << 15; // fixed point: products stay inside int64 below this
+};
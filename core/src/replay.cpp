@@ -0,0 +1,202 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "engine.h"
+
+ReplayInputRecord ToReplayRecord(ClientInput const& in) {
+    ReplayInputRecord r;
+    r.client_id = in.client_id;
+    r.input_seq = in.input_seq;
+    r.target_tick = in.target_tick;
+    r.move_dx = in.move_dx;
+    r.move_dy = in.move_dy;
+    r.action_flags = in.action_flags;
+    r.ability_id = in.ability_id;
+    r.target_x = in.target_x;
+    r.target_y = in.target_y;
+    return r;
+}
+
+ClientInput FromReplayRecord(ReplayInputRecord const& r) {
+    ClientInput in;
+    in.client_id = r.client_id;
+    in.input_seq = r.input_seq;
+    in.target_tick = r.target_tick;
+    in.move_dx = r.move_dx;
+    in.move_dy = r.move_dy;
+    in.action_flags = r.action_flags;
+    in.ability_id = r.ability_id;
+    in.target_x = r.target_x;
+    in.target_y = r.target_y;
+    return in;
+}
+
+// ---------- Recorder ----------
+
+ReplayRecorder::~ReplayRecorder() {
+    close();
+}
+
+bool ReplayRecorder::open(const std::string& path, uint32_t interval) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    keyframe_interval = interval > 0 ? interval : REPLAY_KEYFRAME_TICKS;
+    rec_stats = ReplayRecorderStats{};
+    pending.clear();
+    pending.reserve(REPLAY_FLUSH_BYTES * 2);
+
+    ReplayFileHeader h;
+    h.magic = REPLAY_MAGIC;
+    h.version = REPLAY_VERSION;
+    h.tick_rate = static_cast<uint16_t>(SERVER_TICK_RATE);
+    h.keyframe_interval = keyframe_interval;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&h);
+    pending.insert(pending.end(), p, p + sizeof(h));
+    return true;
+}
+
+void ReplayRecorder::close() {
+    if (!file) return;
+    flush();
+    std::fclose(file);
+    file = nullptr;
+}
+
+void ReplayRecorder::recordInput(ClientInput const& in) {
+    ReplayInputRecord r = ToReplayRecord(in);
+    append(ReplayRecordType::Input, &r, sizeof(r));
+    ++rec_stats.inputs;
+}
+
+void ReplayRecorder::recordTickHash(uint32_t tick, uint64_t state_hash) {
+    ReplayTickHashRecord r{tick, state_hash};
+    append(ReplayRecordType::TickHash, &r, sizeof(r));
+}
+
+void ReplayRecorder::recordKeyframe(std::vector<uint8_t> const& state) {
+    append(ReplayRecordType::Keyframe, state.data(), state.size());
+    ++rec_stats.keyframes;
+}
+
+void ReplayRecorder::append(ReplayRecordType type, const void* payload, size_t size) {
+    if (!file) return;
+    uint32_t n = static_cast<uint32_t>(size);
+    pending.push_back(static_cast<uint8_t>(type));
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&n);
+    pending.insert(pending.end(), p, p + sizeof(n));
+    p = static_cast<const uint8_t*>(payload);
+    pending.insert(pending.end(), p, p + size);
+    if (pending.size() >= REPLAY_FLUSH_BYTES) flush();
+}
+
+void ReplayRecorder::flush() {
+    if (!file || pending.empty()) return;
+    if (std::fwrite(pending.data(), 1, pending.size(), file) != pending.size()) rec_stats.write_failed = true;
+    rec_stats.bytes += pending.size();
+    pending.clear();
+}
+
+// ---------- Reader ----------
+
+bool ReplayLog::load(const std::string& path, std::string& error) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(ReplayFileHeader)) {
+        error = "truncated replay header";
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != REPLAY_MAGIC) {
+        error = "not a replay log (bad magic)";
+        return false;
+    }
+    if (header.version != REPLAY_VERSION) {
+        error = "replay version " + std::to_string(header.version) + ", expected " + std::to_string(REPLAY_VERSION);
+        return false;
+    }
+
+    inputs.clear();
+    keyframes.clear();
+    tick_hashes.clear();
+
+    // a recorder that died mid-write leaves a partial last record: keep everything before it
+    size_t at = sizeof(ReplayFileHeader);
+    while (at + 5 <= data.size()) {
+        uint8_t type = data[at];
+        uint32_t size;
+        memcpy(&size, data.data() + at + 1, sizeof(size));
+        at += 5;
+        if (size > data.size() - at) break;
+        const uint8_t* payload = data.data() + at;
+        at += size;
+
+        switch (static_cast<ReplayRecordType>(type)) {
+            case ReplayRecordType::Input: {
+                if (size < sizeof(ReplayInputRecord)) break;
+                ReplayInputRecord r;
+                memcpy(&r, payload, sizeof(r));
+                inputs.push_back(FromReplayRecord(r));
+                break;
+            }
+            case ReplayRecordType::TickHash: {
+                if (size < sizeof(ReplayTickHashRecord)) break;
+                ReplayTickHashRecord r;
+                memcpy(&r, payload, sizeof(r));
+                tick_hashes.push_back(r);
+                break;
+            }
+            case ReplayRecordType::Keyframe: {
+                if (size < sizeof(ReplayKeyframeHeader)) break;
+                ReplayKeyframeHeader kh;
+                memcpy(&kh, payload, sizeof(kh));
+                ReplayKeyframe k;
+                k.tick = kh.tick;
+                k.state.assign(payload, payload + size);
+                keyframes.push_back(std::move(k));
+                break;
+            }
+            default:
+                break; // newer record kind
+        }
+    }
+
+    // inputs arrive in accept order; the runner feeds them tick by tick
+    std::stable_sort(inputs.begin(), inputs.end(), [](ClientInput const& a, ClientInput const& b) {
+        return a.target_tick < b.target_tick;
+    });
+    std::stable_sort(keyframes.begin(), keyframes.end(), [](ReplayKeyframe const& a, ReplayKeyframe const& b) {
+        return a.tick < b.tick;
+    });
+    std::stable_sort(tick_hashes.begin(), tick_hashes.end(), [](ReplayTickHashRecord const& a, ReplayTickHashRecord const& b) {
+        return a.tick < b.tick;
+    });
+    return true;
+}
+
+ReplayKeyframe const* ReplayLog::keyframeAtOrBefore(uint32_t tick) const {
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), tick,
+                               [](uint32_t t, ReplayKeyframe const& k) { return t < k.tick; });
+    return it == keyframes.begin() ? nullptr : &*(it - 1);
+}
+
+size_t ReplayLog::firstInputAt(uint32_t tick) const {
+    auto it = std::lower_bound(inputs.begin(), inputs.end(), tick,
+                               [](ClientInput const& in, uint32_t t) { return in.target_tick < t; });
+    return static_cast<size_t>(it - inputs.begin());
+}
+
+bool ReplayLog::hashAfter(uint32_t tick, uint64_t& out) const {
+    auto it = std::lower_bound(tick_hashes.begin(), tick_hashes.end(), tick,
+                               [](ReplayTickHashRecord const& r, uint32_t t) { return r.tick < t; });
+    if (it == tick_hashes.end() || it->tick != tick) return false;
+    out = it->state_hash;
+    return true;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "client_input.h"
+#include "entity.h"
+
+// ---------- Input-log replay ----------
+// A live match appends every accepted ClientInput to a compact binary log, plus its state hash
+// after every tick and a keyframe (the full match state, DemoServer::saveKeyframe) every
+// `keyframe_interval` ticks. The simulation is deterministic given its inputs, so re-feeding
+// the log reproduces the match bit for bit (the hashes prove it), and a keyframe lets a
+// replay start anywhere without simulating from tick 0. deterministic_sim_replay runs logs
+// headless and unpaced.
+//
+// File: ReplayFileHeader, then records [u8 ReplayRecordType][u32 payload size][payload].
+// Unknown record types are skipped by size, so old readers survive new record kinds.
+constexpr uint32_t REPLAY_MAGIC = 0x4C50524Du; // "MRPL"
+constexpr uint16_t REPLAY_VERSION = 4; // 2: keyframes carry the entity ID free lists, 3: and each projectile's ability, 4: and caster
+constexpr uint32_t REPLAY_KEYFRAME_TICKS = 300; // 10 s at 30 t/s
+
+enum class ReplayRecordType : uint8_t {
+    Input = 1,    // ReplayInputRecord
+    TickHash = 2, // ReplayTickHashRecord: state hash after the tick ran
+    Keyframe = 3  // ReplayKeyframeHeader + state, taken before the tick runs
+};
+
+#pragma pack(push, 1)
+struct ReplayFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t tick_rate;
+    uint32_t keyframe_interval;
+};
+
+struct ReplayInputRecord {
+    uint32_t client_id;
+    uint32_t input_seq;
+    uint32_t target_tick;
+    int8_t move_dx;
+    int8_t move_dy;
+    uint8_t action_flags;
+    uint16_t ability_id;
+    int32_t target_x;
+    int32_t target_y;
+};
+
+struct ReplayTickHashRecord {
+    uint32_t tick;
+    uint64_t state_hash;
+};
+
+// Keyframe payload: this header, then entity_count EntityState, command_count GameCommand,
+// event_count SimEvent, then per EntityType free_id_count[type] u32 IDs (EntityIdAllocator, in
+// hand-out order). Raw, same build only: the log is for reproducing, not archiving.
+struct ReplayKeyframeHeader {
+    uint32_t tick;               // the next tick to simulate
+    uint32_t next_entity_serial; // first never-used serial
+    uint64_t state_hash;         // computeStateHash(entities, tick) of the saved entities
+    uint32_t entity_count;
+    uint32_t command_count;
+    uint32_t event_count;
+    uint32_t free_id_count[ENTITY_TYPE_COUNT];
+};
+#pragma pack(pop)
+
+ReplayInputRecord ToReplayRecord(ClientInput const& in);
+ClientInput FromReplayRecord(ReplayInputRecord const& r);
+
+struct ReplayRecorderStats {
+    uint64_t inputs = 0;
+    uint64_t keyframes = 0;
+    uint64_t bytes = 0;
+    bool write_failed = false;
+};
+
+// Tick thread only. Records are buffered and written in REPLAY_FLUSH_BYTES pieces.
+constexpr size_t REPLAY_FLUSH_BYTES = 64u << 10;
+
+class ReplayRecorder {
+public:
+    ReplayRecorder() = default;
+    ~ReplayRecorder();
+
+    ReplayRecorder(ReplayRecorder const&) = delete;
+    ReplayRecorder& operator=(ReplayRecorder const&) = delete;
+
+    bool open(const std::string& path, uint32_t keyframe_interval = REPLAY_KEYFRAME_TICKS);
+    void close(); // flushes
+    bool isOpen() const { return file != nullptr; }
+    uint32_t keyframeInterval() const { return keyframe_interval; }
+
+    void recordInput(ClientInput const& in);
+    void recordTickHash(uint32_t tick, uint64_t state_hash);
+    void recordKeyframe(std::vector<uint8_t> const& state);
+
+    ReplayRecorderStats const& stats() const { return rec_stats; }
+
+private:
+    void append(ReplayRecordType type, const void* payload, size_t size);
+    void flush();
+
+    std::FILE* file = nullptr;
+    uint32_t keyframe_interval = REPLAY_KEYFRAME_TICKS;
+    std::vector<uint8_t> pending;
+    ReplayRecorderStats rec_stats;
+};
+
+struct ReplayKeyframe {
+    uint32_t tick = 0;
+    std::vector<uint8_t> state; // DemoServer::loadKeyframe input
+};
+
+// A whole log in memory; inputs are bucketed by target tick for feeding
+struct ReplayLog {
+    ReplayFileHeader header{};
+    std::vector<ClientInput> inputs;       // sorted by target_tick, record order within a tick
+    std::vector<ReplayKeyframe> keyframes; // ascending tick
+    std::vector<ReplayTickHashRecord> tick_hashes; // ascending tick
+
+    bool load(const std::string& path, std::string& error);
+
+    // latest keyframe at or before `tick` (nullptr: none, start from a fresh match)
+    ReplayKeyframe const* keyframeAtOrBefore(uint32_t tick) const;
+    // first input with target_tick >= tick
+    size_t firstInputAt(uint32_t tick) const;
+    // recorded hash after `tick` ran; false when the log has none
+    bool hashAfter(uint32_t tick, uint64_t& out) const;
+    uint32_t lastTick() const { return tick_hashes.empty() ? 0 : tick_hashes.back().tick; }
+};
@@ -0,0 +1,371 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "entity.h"
+#include "entity_state.h"
+#include "net/bitstream.h"
+
+// ---------- Snapshot / Delta serialization ----------
+// In production we should use proper endian handling.
+
+// change mask bits
+enum ChangeBits : uint8_t {
+    CH_PosX = 1 << 0, // << shifts position to the left n = 0 times
+    CH_PosY = 1 << 1, // << shifts position to the left n = 1 times
+    CH_VelX = 1 << 2, // ...
+    CH_VelY = 1 << 3,
+    CH_Health = 1 << 4,
+    CH_Flags = 1 << 5
+};
+// << changes the bit position
+// all properties are inside a same mask based on their positions
+// 00010101 --> POSX, VELX and HEALTH changed (all are 1, and their positions are respective to the)
+
+constexpr uint8_t CH_All = CH_PosX | CH_PosY | CH_VelX | CH_VelY | CH_Health | CH_Flags;
+constexpr uint32_t NO_BASELINE = 0xFFFFFFFFu; // delta against nothing = every entity sent in full
+
+struct Snapshot {
+    uint32_t server_tick;
+    uint64_t state_hash = 0; // computeStateHash() after the tick (state_hash.h)
+    std::vector<EntityState> entities;
+};
+
+// Compact networked view of one entity (only the fields that go on the wire)
+struct NetEntity {
+    uint32_t id;
+    int32_t pos_x;
+    int32_t pos_y;
+    int32_t vel_x;
+    int32_t vel_y;
+    int32_t health;
+    uint16_t status_flags;
+    EntityType type;
+};
+
+// One authoritative snapshot, entities sorted by ID so two frames diff with a linear merge
+struct SnapshotFrame {
+    uint32_t server_tick = 0;
+    bool valid = false;
+    uint64_t state_hash = 0; // server: full tick hash; client: the 32 bits the fragment carries
+    std::vector<NetEntity> entities;
+
+    const NetEntity* find(uint32_t id) const {
+        auto it = std::lower_bound(entities.begin(), entities.end(), id,
+                                   [](NetEntity const& e, uint32_t v) { return e.id < v; });
+        return (it != entities.end() && it->id == id) ? &*it : nullptr;
+    }
+};
+
+// Ring of the last SNAPSHOT_RING_SIZE authoritative snapshots. Frames keep their vector capacity,
+// so capturing a tick is a straight copy of the compact columns: no map rebuild, no allocation in steady state.
+constexpr uint32_t SNAPSHOT_RING_SIZE = 32; // ~1 s of history at 30 t/s
+
+class SnapshotRing {
+public:
+    SnapshotFrame const& capture(uint32_t tick, EntityStore const& s, uint64_t state_hash = 0) {
+        SnapshotFrame& f = frames[tick % SNAPSHOT_RING_SIZE];
+        f.server_tick = tick;
+        f.valid = true;
+        f.state_hash = state_hash;
+        f.entities.resize(s.size());
+        for (uint32_t i = 0; i < s.size(); ++i) {
+            NetEntity& n = f.entities[i];
+            n.id = s.id[i];
+            n.pos_x = s.pos_x[i];
+            n.pos_y = s.pos_y[i];
+            n.vel_x = s.vel_x[i];
+            n.vel_y = s.vel_y[i];
+            n.health = s.cold[i].health;
+            n.status_flags = s.cold[i].status_flags;
+            n.type = s.type[i];
+        }
+        std::sort(f.entities.begin(), f.entities.end(),
+                  [](NetEntity const& a, NetEntity const& b) { return a.id < b.id; });
+        latest_tick = tick;
+        return f;
+    }
+
+    // nullptr when the tick was never captured or has already been overwritten
+    SnapshotFrame const* find(uint32_t tick) const {
+        SnapshotFrame const& f = frames[tick % SNAPSHOT_RING_SIZE];
+        return (f.valid && f.server_tick == tick) ? &f : nullptr;
+    }
+
+    uint32_t latest() const { return latest_tick; }
+
+private:
+    SnapshotFrame frames[SNAPSHOT_RING_SIZE];
+    uint32_t latest_tick = 0;
+};
+
+// helper endian functions
+inline void write_u8(std::vector<uint8_t>& buf, uint8_t v) { buf.push_back(v); }
+inline void write_u16(std::vector<uint8_t>& buf, uint16_t v) {
+    buf.push_back(static_cast<uint8_t>(v & 0xFF));
+    buf.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
+}
+inline void write_u32(std::vector<uint8_t>& buf, uint32_t v) {
+    buf.push_back(static_cast<uint8_t>(v & 0xFF));
+    buf.push_back(static_cast<uint8_t>((v >> 8) & 0xFF));
+    buf.push_back(static_cast<uint8_t>((v >> 16) & 0xFF));
+    buf.push_back(static_cast<uint8_t>((v >> 24) & 0xFF));
+}
+inline void write_i32(std::vector<uint8_t>& buf, int32_t v) { write_u32(buf, static_cast<uint32_t>(v)); }
+inline void patch_u32(std::vector<uint8_t>& buf, size_t pos, uint32_t v) {
+    buf[pos + 0] = static_cast<uint8_t>(v & 0xFF);
+    buf[pos + 1] = static_cast<uint8_t>((v >> 8) & 0xFF);
+    buf[pos + 2] = static_cast<uint8_t>((v >> 16) & 0xFF);
+    buf[pos + 3] = static_cast<uint8_t>((v >> 24) & 0xFF);
+}
+
+// Serialize full snapshot, example
+[[nodiscard]] inline std::vector<uint8_t> serializeFull(Snapshot const& snap) {
+    std::vector<uint8_t> out;
+    write_u32(out, snap.server_tick);
+    write_u32(out, static_cast<uint32_t>(snap.entities.size()));
+    for (auto const& e : snap.entities) {
+        write_u32(out, e.id);
+        write_i32(out, e.pos_x);
+        write_i32(out, e.pos_y);
+        write_i32(out, e.vel_x);
+        write_i32(out, e.vel_y);
+        write_i32(out, e.health);
+        write_u16(out, e.status_flags);
+    }
+    return out;
+}
+
+// ---------- Bit-packed delta codec ----------
+// Per-field quantization: a field is sent as (value >> shift), so shift 0 is lossless.
+// Deltas are taken between *quantized* values, so the client never accumulates rounding drift.
+struct SnapshotQuantization {
+    uint8_t pos_shift = 2;    // 4 fixed-point units = 0.004 world units
+    uint8_t vel_shift = 0;
+    uint8_t health_shift = 0;
+};
+
+inline int32_t quantize(int32_t v, uint8_t shift) { return v >> shift; } // floor, same on every platform we ship
+inline int32_t dequantize(int32_t q, uint8_t shift) { return static_cast<int32_t>(static_cast<uint32_t>(q) << shift); }
+// wrapping diff/apply, so a delta between any two int32 values round-trips exactly
+inline int32_t wrapSub(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) - static_cast<uint32_t>(b)); }
+inline int32_t wrapAdd(int32_t a, int32_t b) { return static_cast<int32_t>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+
+inline uint8_t changeMask(NetEntity const& e, NetEntity const& prev, SnapshotQuantization const& q) {
+    uint8_t mask = 0;
+    if (quantize(e.pos_x, q.pos_shift) != quantize(prev.pos_x, q.pos_shift)) mask |= CH_PosX;
+    if (quantize(e.pos_y, q.pos_shift) != quantize(prev.pos_y, q.pos_shift)) mask |= CH_PosY;
+    if (quantize(e.vel_x, q.vel_shift) != quantize(prev.vel_x, q.vel_shift)) mask |= CH_VelX;
+    if (quantize(e.vel_y, q.vel_shift) != quantize(prev.vel_y, q.vel_shift)) mask |= CH_VelY;
+    if (quantize(e.health, q.health_shift) != quantize(prev.health, q.health_shift)) mask |= CH_Health;
+    if (e.status_flags != prev.status_flags) mask |= CH_Flags;
+    return mask;
+}
+
+// Upper bound of the encoded size (bytes, multiple of 8) for a delta between frames of these sizes
+inline size_t deltaMaxBytes(size_t cur_entities, size_t base_entities) {
+    // header 13 bytes + counts, per entity: id gap 5 + flag/type/mask 2 + 5 fields * 5 + flags 2
+    size_t bytes = 32 + cur_entities * 34 + base_entities * 5;
+    return (bytes + 7) & ~size_t(7);
+}
+
+inline uint32_t varintBits(uint32_t v) {
+    uint32_t bits = 8;
+    while (v >= 0x80u) { v >>= 7; bits += 8; }
+    return bits;
+}
+inline uint32_t zigzagBits(int32_t v) {
+    return varintBits((static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31));
+}
+
+// One entity record, without its ID: is_new 1, then
+//   new (b == nullptr): type 3 | pos_x pos_y vel_x vel_y health zigzag (quantized absolute) | flags 16
+//   changed:            mask 6 | masked fields as zigzag (quantized cur - quantized baseline), flags 16 raw
+inline void writeEntityRecord(BitWriter& w, NetEntity const& e, NetEntity const* b, uint8_t mask,
+                              SnapshotQuantization const& q) {
+    w.writeBool(b == nullptr);
+    if (!b) {
+        // new entity -> send everything
+        w.writeBits(static_cast<uint32_t>(e.type), 3);
+        w.writeZigzag(quantize(e.pos_x, q.pos_shift));
+        w.writeZigzag(quantize(e.pos_y, q.pos_shift));
+        w.writeZigzag(quantize(e.vel_x, q.vel_shift));
+        w.writeZigzag(quantize(e.vel_y, q.vel_shift));
+        w.writeZigzag(quantize(e.health, q.health_shift));
+        w.writeBits(e.status_flags, 16);
+        return;
+    }
+    w.writeBits(mask, 6);
+    if (mask & CH_PosX) w.writeZigzag(wrapSub(quantize(e.pos_x, q.pos_shift), quantize(b->pos_x, q.pos_shift)));
+    if (mask & CH_PosY) w.writeZigzag(wrapSub(quantize(e.pos_y, q.pos_shift), quantize(b->pos_y, q.pos_shift)));
+    if (mask & CH_VelX) w.writeZigzag(wrapSub(quantize(e.vel_x, q.vel_shift), quantize(b->vel_x, q.vel_shift)));
+    if (mask & CH_VelY) w.writeZigzag(wrapSub(quantize(e.vel_y, q.vel_shift), quantize(b->vel_y, q.vel_shift)));
+    if (mask & CH_Health) w.writeZigzag(wrapSub(quantize(e.health, q.health_shift), quantize(b->health, q.health_shift)));
+    if (mask & CH_Flags) w.writeBits(e.status_flags, 16);
+}
+
+// Exact size in bits of what writeEntityRecord() emits
+inline uint32_t entityRecordBits(NetEntity const& e, NetEntity const* b, uint8_t mask, SnapshotQuantization const& q) {
+    if (!b) {
+        return 1 + 3 + 16 +
+               zigzagBits(quantize(e.pos_x, q.pos_shift)) + zigzagBits(quantize(e.pos_y, q.pos_shift)) +
+               zigzagBits(quantize(e.vel_x, q.vel_shift)) + zigzagBits(quantize(e.vel_y, q.vel_shift)) +
+               zigzagBits(quantize(e.health, q.health_shift));
+    }
+    uint32_t bits = 1 + 6;
+    if (mask & CH_PosX) bits += zigzagBits(wrapSub(quantize(e.pos_x, q.pos_shift), quantize(b->pos_x, q.pos_shift)));
+    if (mask & CH_PosY) bits += zigzagBits(wrapSub(quantize(e.pos_y, q.pos_shift), quantize(b->pos_y, q.pos_shift)));
+    if (mask & CH_VelX) bits += zigzagBits(wrapSub(quantize(e.vel_x, q.vel_shift), quantize(b->vel_x, q.vel_shift)));
+    if (mask & CH_VelY) bits += zigzagBits(wrapSub(quantize(e.vel_y, q.vel_shift), quantize(b->vel_y, q.vel_shift)));
+    if (mask & CH_Health) bits += zigzagBits(wrapSub(quantize(e.health, q.health_shift), quantize(b->health, q.health_shift)));
+    if (mask & CH_Flags) bits += 16;
+    return bits;
+}
+
+// Decode one record for entity `id` into `frame` (ID-sorted, seeded with the baseline).
+// Returns false when the record is a delta for an entity the frame doesn't hold.
+inline bool readEntityRecord(BitReader& r, uint32_t id, SnapshotQuantization const& q, SnapshotFrame& frame) {
+    bool is_new = r.readBool();
+    auto it = std::lower_bound(frame.entities.begin(), frame.entities.end(), id,
+                               [](NetEntity const& e, uint32_t v) { return e.id < v; });
+    if (is_new) {
+        NetEntity e{};
+        e.id = id;
+        e.type = static_cast<EntityType>(r.readBits(3));
+        e.pos_x = dequantize(r.readZigzag(), q.pos_shift);
+        e.pos_y = dequantize(r.readZigzag(), q.pos_shift);
+        e.vel_x = dequantize(r.readZigzag(), q.vel_shift);
+        e.vel_y = dequantize(r.readZigzag(), q.vel_shift);
+        e.health = dequantize(r.readZigzag(), q.health_shift);
+        e.status_flags = static_cast<uint16_t>(r.readBits(16));
+        if (it != frame.entities.end() && it->id == id) *it = e;
+        else frame.entities.insert(it, e);
+        return true;
+    }
+
+    if (it == frame.entities.end() || it->id != id) return false;
+    NetEntity& e = *it;
+    uint8_t mask = static_cast<uint8_t>(r.readBits(6));
+    if (mask & CH_PosX) e.pos_x = dequantize(wrapAdd(quantize(e.pos_x, q.pos_shift), r.readZigzag()), q.pos_shift);
+    if (mask & CH_PosY) e.pos_y = dequantize(wrapAdd(quantize(e.pos_y, q.pos_shift), r.readZigzag()), q.pos_shift);
+    if (mask & CH_VelX) e.vel_x = dequantize(wrapAdd(quantize(e.vel_x, q.vel_shift), r.readZigzag()), q.vel_shift);
+    if (mask & CH_VelY) e.vel_y = dequantize(wrapAdd(quantize(e.vel_y, q.vel_shift), r.readZigzag()), q.vel_shift);
+    if (mask & CH_Health) e.health = dequantize(wrapAdd(quantize(e.health, q.health_shift), r.readZigzag()), q.health_shift);
+    if (mask & CH_Flags) e.status_flags = static_cast<uint16_t>(r.readBits(16));
+    return true;
+}
+
+inline void removeEntity(SnapshotFrame& frame, uint32_t id) {
+    auto it = std::lower_bound(frame.entities.begin(), frame.entities.end(), id,
+                               [](NetEntity const& e, uint32_t v) { return e.id < v; });
+    if (it != frame.entities.end() && it->id == id) frame.entities.erase(it);
+}
+
+// Serialize `cur` as a delta against `baseline` (the snapshot the client last acknowledged).
+// baseline == nullptr means the client has nothing: every entity is sent as new.
+// Bit layout:
+//   tick 32 | baseline_tick 32 | pos/vel/health shift 5+5+5 | changed varint
+//   per changed entity (ascending ID): id gap varint | entity record (see writeEntityRecord)
+//   removed varint | removed id gaps varint
+// Entity IDs are run-length coded as the gap to the previous ID in the list.
+// `out` is resized to the exact byte count; its capacity is reused across ticks.
+// For sends bigger than one datagram see SnapshotPacketBuilder (net/snapshot_builder.h).
+inline void serializeDelta(SnapshotFrame const& cur, SnapshotFrame const* baseline, std::vector<uint8_t>& out,
+                           SnapshotQuantization const& q = SnapshotQuantization{}) {
+    static const SnapshotFrame empty_frame;
+    SnapshotFrame const& base = baseline ? *baseline : empty_frame;
+
+    out.resize(deltaMaxBytes(cur.entities.size(), base.entities.size()));
+    BitWriter w(out.data(), out.size());
+
+    w.writeBits(cur.server_tick, 32);
+    w.writeBits(baseline ? baseline->server_tick : NO_BASELINE, 32);
+    w.writeBits(q.pos_shift, 5);
+    w.writeBits(q.vel_shift, 5);
+    w.writeBits(q.health_shift, 5);
+
+    // both frames are ID-sorted: one linear merge finds new and changed entities.
+    // First pass counts so the count can lead the list (a bitstream can't be patched cheaply).
+    uint32_t changed = 0;
+    size_t bi = 0;
+    for (auto const& e : cur.entities) {
+        while (bi < base.entities.size() && base.entities[bi].id < e.id) ++bi;
+        // a recycled ID on a different entity type is re-sent in full
+        bool known = bi < base.entities.size() && base.entities[bi].id == e.id && base.entities[bi].type == e.type;
+        if (!known || changeMask(e, base.entities[bi], q) != 0) ++changed;
+    }
+    w.writeVarint(changed);
+
+    uint32_t prev_id = 0;
+    bool first = true;
+    bi = 0;
+    for (auto const& e : cur.entities) {
+        while (bi < base.entities.size() && base.entities[bi].id < e.id) ++bi;
+        bool known = bi < base.entities.size() && base.entities[bi].id == e.id && base.entities[bi].type == e.type;
+        uint8_t mask = known ? changeMask(e, base.entities[bi], q) : CH_All;
+        if (known && mask == 0) continue;
+
+        w.writeVarint(first ? e.id : e.id - prev_id - 1);
+        prev_id = e.id;
+        first = false;
+        writeEntityRecord(w, e, known ? &base.entities[bi] : nullptr, mask, q);
+    }
+
+    // entities present in the baseline but gone now
+    uint32_t removed = 0;
+    size_t ci = 0;
+    for (auto const& b : base.entities) {
+        while (ci < cur.entities.size() && cur.entities[ci].id < b.id) ++ci;
+        if (!(ci < cur.entities.size() && cur.entities[ci].id == b.id)) ++removed;
+    }
+    w.writeVarint(removed);
+    first = true;
+    ci = 0;
+    for (auto const& b : base.entities) {
+        while (ci < cur.entities.size() && cur.entities[ci].id < b.id) ++ci;
+        if (ci < cur.entities.size() && cur.entities[ci].id == b.id) continue;
+        w.writeVarint(first ? b.id : b.id - prev_id - 1);
+        prev_id = b.id;
+        first = false;
+    }
+
+    out.resize(w.finish());
+}
+
+// Client side (and tools): rebuild the frame encoded by serializeDelta on top of `baseline`.
+// Values come out dequantized. Returns false on a malformed/truncated packet or baseline mismatch.
+inline bool deserializeDelta(const uint8_t* data, size_t size, SnapshotFrame const* baseline, SnapshotFrame& out) {
+    BitReader r(data, size);
+    uint32_t tick = r.readBits(32);
+    uint32_t base_tick = r.readBits(32);
+    SnapshotQuantization q;
+    q.pos_shift = static_cast<uint8_t>(r.readBits(5));
+    q.vel_shift = static_cast<uint8_t>(r.readBits(5));
+    q.health_shift = static_cast<uint8_t>(r.readBits(5));
+
+    static const SnapshotFrame empty_frame;
+    if (base_tick != NO_BASELINE && (!baseline || baseline->server_tick != base_tick)) return false;
+    SnapshotFrame const& base = base_tick == NO_BASELINE ? empty_frame : *baseline;
+
+    // start from the baseline, apply changes in ID order, then drop removed IDs
+    out.server_tick = tick;
+    out.valid = true;
+    out.entities = base.entities;
+
+    uint32_t changed = r.readVarint();
+    uint32_t id = 0;
+    for (uint32_t k = 0; k < changed && !r.overflowed(); ++k) {
+        uint32_t gap = r.readVarint();
+        id = k == 0 ? gap : id + gap + 1;
+        if (!readEntityRecord(r, id, q, out)) return false; // delta for an entity the baseline lacks
+    }
+
+    uint32_t removed = r.readVarint();
+    for (uint32_t k = 0; k < removed && !r.overflowed(); ++k) {
+        uint32_t gap = r.readVarint();
+        id = k == 0 ? gap : id + gap + 1;
+        removeEntity(out, id);
+    }
+
+    return !r.overflowed();
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <vector>
+#include "entity.h"
+#include "entity_state.h"
+
+// ---------- Deterministic state hash ----------
+// One 64-bit hash of the whole simulation state per tick, cheap enough to run every tick.
+// Every entity hashes all of its state (hot columns, health, flags and the live buffs) into
+// a well-mixed 64-bit word, and the tick hash is the wrapping sum of those words. The sum
+// doesn't depend on order, so it is computed straight over the dense columns (no sort by ID)
+// and equals what hashing in ID order would catch: any differing field in any entity.
+// Two runs (serial vs parallel tick, SIMD vs MOBA_SCALAR_TICK, server vs SimPreview) agree on
+// a tick exactly when their hashes agree; StateDigest then finds the first differing entity.
+
+inline uint64_t stateHashMix(uint64_t h, uint64_t v) {
+    h ^= v * 0x9E3779B97F4A7C15ull;
+    h = (h ^ (h >> 29)) * 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 32);
+}
+
+inline uint64_t stateHashFinish(uint64_t h) {
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return h ^ (h >> 31);
+}
+
+inline uint64_t pack32(int32_t lo, int32_t hi) {
+    return static_cast<uint32_t>(lo) | (static_cast<uint64_t>(static_cast<uint32_t>(hi)) << 32);
+}
+
+// Field by field (never the raw bytes, so padding and the unused buff slots don't count)
+inline uint64_t hashEntity(uint32_t id, EntityType type, int32_t pos_x, int32_t pos_y, int32_t vel_x, int32_t vel_y,
+                           int32_t radius, int32_t lifetime_ticks, uint8_t team, EntityCold const& c) {
+    uint64_t h = 0x243F6A8885A308D3ull;
+    h = stateHashMix(h, id | (static_cast<uint64_t>(type) << 32) | (static_cast<uint64_t>(c.active_buff_count) << 40) |
+                            (static_cast<uint64_t>(c.status_flags) << 48));
+    h = stateHashMix(h, pack32(pos_x, pos_y));
+    h = stateHashMix(h, pack32(vel_x, vel_y));
+    h = stateHashMix(h, pack32(radius, lifetime_ticks));
+    h = stateHashMix(h, static_cast<uint32_t>(c.health) | (static_cast<uint64_t>(team) << 32) | (static_cast<uint64_t>(c.ability_id) << 40));
+    h = stateHashMix(h, c.caster_id);
+    uint32_t buffs = c.active_buff_count < 8 ? c.active_buff_count : 8;
+    for (uint32_t b = 0; b < buffs; ++b) {
+        ActiveBuff const& buff = c.buffs[b];
+        h = stateHashMix(h, buff.source_entity_id | (static_cast<uint64_t>(buff.buff_id) << 32));
+        h = stateHashMix(h, pack32(static_cast<int32_t>(buff.applied_tick), static_cast<int32_t>(buff.expire_tick)));
+    }
+    return stateHashFinish(h);
+}
+
+inline uint64_t hashEntity(EntityStore const& s, uint32_t i) {
+    return hashEntity(s.id[i], s.type[i], s.pos_x[i], s.pos_y[i], s.vel_x[i], s.vel_y[i], s.radius[i], s.lifetime_ticks[i], s.team[i], s.cold[i]);
+}
+
+inline uint64_t hashEntity(EntityState const& e) {
+    EntityCold c;
+    c.health = e.health;
+    c.status_flags = e.status_flags;
+    c.active_buff_count = e.active_buff_count;
+    std::memcpy(c.buffs, e.buffs, sizeof(c.buffs));
+    c.ability_id = e.ability_id;
+    c.caster_id = e.caster_id;
+    return hashEntity(e.id, e.type, e.pos_x, e.pos_y, e.vel_x, e.vel_y, e.radius, e.lifetime_ticks, e.team, c);
+}
+
+inline uint64_t computeStateHash(EntityStore const& s, uint32_t tick) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < s.size(); ++i) sum += hashEntity(s, i);
+    return stateHashFinish(sum ^ stateHashMix(tick, s.size()));
+}
+
+// Per-entity hashes in ID order: for locating a divergence once the tick hashes disagree
+struct EntityDigest {
+    uint32_t id;
+    uint64_t hash;
+};
+
+struct StateDigest {
+    uint32_t tick = 0;
+    uint64_t hash = 0;
+    std::vector<EntityDigest> entities; // sorted by id
+
+    void capture(EntityStore const& s, uint32_t t) {
+        tick = t;
+        hash = computeStateHash(s, t);
+        entities.resize(s.size());
+        for (uint32_t i = 0; i < s.size(); ++i) entities[i] = EntityDigest{s.id[i], hashEntity(s, i)};
+        std::sort(entities.begin(), entities.end(), [](EntityDigest const& a, EntityDigest const& b) { return a.id < b.id; });
+    }
+};
+
+constexpr uint32_t NO_DIVERGENCE = 0xFFFFFFFFu;
+
+// Lowest entity ID that differs (or exists on one side only); NO_DIVERGENCE when identical
+inline uint32_t firstDivergence(StateDigest const& a, StateDigest const& b) {
+    size_t i = 0, j = 0;
+    while (i < a.entities.size() || j < b.entities.size()) {
+        if (i == a.entities.size()) return b.entities[j].id;
+        if (j == b.entities.size()) return a.entities[i].id;
+        EntityDigest const& x = a.entities[i];
+        EntityDigest const& y = b.entities[j];
+        if (x.id != y.id) return x.id < y.id ? x.id : y.id;
+        if (x.hash != y.hash) return x.id;
+        ++i;
+        ++j;
+    }
+    return NO_DIVERGENCE;
+}
+
+// Desync dump: one line with every hashed field
+inline void dumpEntityState(std::ostream& os, EntityState const& e) {
+    os << "id=" << e.id << " type=" << static_cast<int>(e.type) << " pos=(" << e.pos_x << "," << e.pos_y << ") vel=("
+       << e.vel_x << "," << e.vel_y << ") hp=" << e.health << " radius=" << e.radius << " life=" << e.lifetime_ticks
+       << " flags=" << e.status_flags << " team=" << static_cast<int>(e.team) << " buffs=" << static_cast<int>(e.active_buff_count);
+    for (uint32_t b = 0; b < e.active_buff_count && b < 8; ++b) {
+        os << " [" << e.buffs[b].buff_id << " from " << e.buffs[b].source_entity_id << ", " << e.buffs[b].applied_tick << "-" << e.buffs[b].expire_tick << "]";
+    }
+}
@@ -0,0 +1,126 @@
+#include "thread_pool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    lane_count = threads;
+    lanes.reset(new Lane[lane_count]);
+    workers.reserve(lane_count - 1);
+    for (unsigned k = 1; k < lane_count; ++k) workers.emplace_back(&WorkStealingPool::workerLoop, this, k);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(job_m);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+void WorkStealingPool::run(size_t count, CallFn call, void* ctx) {
+    if (count == 0) return;
+
+    {
+        std::lock_guard<std::mutex> lock(job_m);
+        size_t per_lane = count / lane_count, extra = count % lane_count, at = 0;
+        for (unsigned k = 0; k < lane_count; ++k) {
+            std::lock_guard<std::mutex> lane_lock(lanes[k].m);
+            size_t n = per_lane + (k < extra ? 1 : 0);
+            lanes[k].begin = at;
+            lanes[k].end = at + n;
+            at += n;
+        }
+        job_call = call;
+        job_ctx = ctx;
+        remaining.store(count, std::memory_order_relaxed);
+        ++job_generation;
+    }
+    job_cv.notify_all();
+
+    drain(0, call, ctx);
+
+    // a worker that picked this job up may still be between its last item and leaving drain();
+    // the next job must not redistribute the lanes under it
+    std::unique_lock<std::mutex> lock(job_m);
+    done_cv.wait(lock, [this] { return remaining.load(std::memory_order_acquire) == 0 && active_workers == 0; });
+}
+
+void WorkStealingPool::workerLoop(unsigned lane) {
+    uint64_t seen = 0;
+    for (;;) {
+        CallFn call;
+        void* ctx;
+        {
+            std::unique_lock<std::mutex> lock(job_m);
+            job_cv.wait(lock, [&] { return stopping || job_generation != seen; });
+            if (stopping) return;
+            seen = job_generation;
+            call = job_call;
+            ctx = job_ctx;
+            ++active_workers;
+        }
+
+        drain(lane, call, ctx);
+
+        {
+            std::lock_guard<std::mutex> lock(job_m);
+            --active_workers;
+        }
+        done_cv.notify_one();
+    }
+}
+
+void WorkStealingPool::drain(unsigned lane, CallFn call, void* ctx) {
+    size_t i;
+    while (takeOwn(lane, i) || steal(lane, i)) {
+        call(ctx, i);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(job_m); // pairs with the wait in run()
+            done_cv.notify_one();
+        }
+    }
+}
+
+bool WorkStealingPool::takeOwn(unsigned lane, size_t& out) {
+    Lane& l = lanes[lane];
+    std::lock_guard<std::mutex> lock(l.m);
+    if (l.begin == l.end) return false;
+    out = l.begin++;
+    return true;
+}
+
+bool WorkStealingPool::steal(unsigned thief, size_t& out) {
+    for (;;) {
+        // victim = the lane with the most work left (it may shrink before we lock it again)
+        unsigned victim = thief;
+        size_t most = 0;
+        for (unsigned k = 0; k < lane_count; ++k) {
+            if (k == thief) continue;
+            std::lock_guard<std::mutex> lock(lanes[k].m);
+            size_t left = lanes[k].end - lanes[k].begin;
+            if (left > most) { most = left; victim = k; }
+        }
+        if (victim == thief) return false;
+
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(lanes[victim].m);
+            size_t left = lanes[victim].end - lanes[victim].begin;
+            if (left == 0) continue; // drained in between, look again
+            size_t take = (left + 1) / 2;
+            end = lanes[victim].end;
+            begin = end - take;
+            lanes[victim].end = begin;
+        }
+        steal_count.fetch_add(1, std::memory_order_relaxed);
+
+        out = begin;
+        if (begin + 1 < end) {
+            std::lock_guard<std::mutex> lock(lanes[thief].m);
+            lanes[thief].begin = begin + 1;
+            lanes[thief].end = end;
+        }
+        return true;
+    }
+}
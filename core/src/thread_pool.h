@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// ---------- Work-stealing pool ----------
+// parallelFor(count, fn) runs fn(i) for every i in [0, count) and returns when all are done.
+// The range is split evenly into one lane per thread (the caller is lane 0). A thread takes
+// indices from the front of its own lane; once it runs dry it steals the back half of the
+// fullest other lane, so one slow item (a busy match) doesn't leave the other threads idle.
+// Jobs run one at a time; fn must not call parallelFor on the same pool.
+class WorkStealingPool {
+public:
+    // `threads` includes the calling thread (0 = hardware_concurrency)
+    explicit WorkStealingPool(unsigned threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+
+    unsigned size() const { return lane_count; }
+
+    template <class Fn>
+    void parallelFor(size_t count, Fn&& fn) {
+        using F = typename std::remove_reference<Fn>::type;
+        run(count, [](void* ctx, size_t i) { (*static_cast<F*>(ctx))(i); }, const_cast<void*>(static_cast<const void*>(&fn)));
+    }
+
+    uint64_t steals() const { return steal_count.load(std::memory_order_relaxed); }
+
+private:
+    using CallFn = void(*)(void*, size_t);
+
+    struct alignas(64) Lane {
+        std::mutex m;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    void run(size_t count, CallFn call, void* ctx);
+    void workerLoop(unsigned lane);
+    void drain(unsigned lane, CallFn call, void* ctx);
+    bool takeOwn(unsigned lane, size_t& out);
+    bool steal(unsigned thief, size_t& out);
+
+    unsigned lane_count;
+    std::unique_ptr<Lane[]> lanes;
+    std::vector<std::thread> workers;
+
+    std::mutex job_m;
+    std::condition_variable job_cv;  // workers: a new job (or shutdown)
+    std::condition_variable done_cv; // caller: every item ran and no worker is still in drain()
+    uint64_t job_generation = 0;
+    CallFn job_call = nullptr;
+    void* job_ctx = nullptr;
+    unsigned active_workers = 0;
+    bool stopping = false;
+    std::atomic<size_t> remaining{0};
+    std::atomic<uint64_t> steal_count{0};
+};
@@ -0,0 +1,212 @@
+#include "tick.h"
+
+#if !defined(MOBA_SCALAR_TICK)
+    #if defined(__AVX2__)
+        #include <immintrin.h>
+        #define MOBA_TICK_AVX2 1
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define MOBA_TICK_SSE2 1
+    #elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        #include <arm_neon.h>
+        #define MOBA_TICK_NEON 1
+    #endif
+#endif
+
+// ---------- Scalar reference ----------
+
+static void integrateCharactersScalarFrom(MotionColumns c, int32_t friction, uint32_t i) {
+    for (; i < c.count; ++i) {
+        c.pos_x[i] += c.vel_x[i];
+        c.pos_y[i] += c.vel_y[i];
+
+        c.vel_x[i] = approach_zero(c.vel_x[i], friction);
+        c.vel_y[i] = approach_zero(c.vel_y[i], friction);
+
+        if (c.lifetime_ticks[i] > 0) {
+            c.lifetime_ticks[i]--;
+        }
+    }
+}
+
+static void integrateProjectilesScalarFrom(MotionColumns c, uint32_t i) {
+    for (; i < c.count; ++i) {
+        c.pos_x[i] += c.vel_x[i];
+        c.pos_y[i] += c.vel_y[i];
+
+        if (c.lifetime_ticks[i] > 0) {
+            c.lifetime_ticks[i]--;
+        }
+    }
+}
+
+void integrateCharactersScalar(MotionColumns c, int32_t friction) {
+    integrateCharactersScalarFrom(c, friction, 0);
+}
+
+void integrateProjectilesScalar(MotionColumns c) {
+    integrateProjectilesScalarFrom(c, 0);
+}
+
+// ---------- Vector kernels ----------
+// approach_zero(v, a) with a >= 0 is exactly v - clamp(v, -a, a):
+//   v >  a  ->  v - a
+//   v < -a  ->  v + a
+//   else    ->  0
+// lifetime-- when > 0 is lifetime + (lifetime > 0 ? -1 : 0), the compare mask is already -1/0.
+
+#if defined(MOBA_TICK_AVX2)
+
+static inline __m256i approachZero8(__m256i v, __m256i a, __m256i neg_a) {
+    __m256i clamped = _mm256_min_epi32(_mm256_max_epi32(v, neg_a), a);
+    return _mm256_sub_epi32(v, clamped);
+}
+
+void integrateCharacters(MotionColumns c, int32_t friction) {
+    const __m256i a = _mm256_set1_epi32(friction);
+    const __m256i neg_a = _mm256_set1_epi32(-friction);
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 8 <= c.count; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.pos_x + i));
+        __m256i py = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.pos_y + i));
+        __m256i vx = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.vel_x + i));
+        __m256i vy = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.vel_y + i));
+        __m256i lt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.lifetime_ticks + i));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.pos_x + i), _mm256_add_epi32(px, vx));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.pos_y + i), _mm256_add_epi32(py, vy));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.vel_x + i), approachZero8(vx, a, neg_a));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.vel_y + i), approachZero8(vy, a, neg_a));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.lifetime_ticks + i),
+                            _mm256_add_epi32(lt, _mm256_cmpgt_epi32(lt, zero)));
+    }
+    integrateCharactersScalarFrom(c, friction, i);
+}
+
+void integrateProjectiles(MotionColumns c) {
+    const __m256i zero = _mm256_setzero_si256();
+    uint32_t i = 0;
+    for (; i + 8 <= c.count; i += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.pos_x + i));
+        __m256i py = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.pos_y + i));
+        __m256i vx = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.vel_x + i));
+        __m256i vy = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.vel_y + i));
+        __m256i lt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.lifetime_ticks + i));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.pos_x + i), _mm256_add_epi32(px, vx));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.pos_y + i), _mm256_add_epi32(py, vy));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.lifetime_ticks + i),
+                            _mm256_add_epi32(lt, _mm256_cmpgt_epi32(lt, zero)));
+    }
+    integrateProjectilesScalarFrom(c, i);
+}
+
+const char* integratorIsaName() { return "avx2"; }
+
+#elif defined(MOBA_TICK_SSE2)
+
+// SSE2 has no signed 32-bit min/max, so the clamp is done with compare + select
+static inline __m128i approachZero4(__m128i v, __m128i a, __m128i neg_a) {
+    __m128i gt = _mm_cmpgt_epi32(v, a);
+    __m128i lt = _mm_cmplt_epi32(v, neg_a);
+    __m128i inside = _mm_andnot_si128(_mm_or_si128(gt, lt), v);
+    __m128i clamped = _mm_or_si128(_mm_or_si128(_mm_and_si128(gt, a), _mm_and_si128(lt, neg_a)), inside);
+    return _mm_sub_epi32(v, clamped);
+}
+
+void integrateCharacters(MotionColumns c, int32_t friction) {
+    const __m128i a = _mm_set1_epi32(friction);
+    const __m128i neg_a = _mm_set1_epi32(-friction);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 4 <= c.count; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.pos_x + i));
+        __m128i py = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.pos_y + i));
+        __m128i vx = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.vel_x + i));
+        __m128i vy = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.vel_y + i));
+        __m128i lt = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.lifetime_ticks + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.pos_x + i), _mm_add_epi32(px, vx));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.pos_y + i), _mm_add_epi32(py, vy));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.vel_x + i), approachZero4(vx, a, neg_a));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.vel_y + i), approachZero4(vy, a, neg_a));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.lifetime_ticks + i),
+                         _mm_add_epi32(lt, _mm_cmpgt_epi32(lt, zero)));
+    }
+    integrateCharactersScalarFrom(c, friction, i);
+}
+
+void integrateProjectiles(MotionColumns c) {
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t i = 0;
+    for (; i + 4 <= c.count; i += 4) {
+        __m128i px = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.pos_x + i));
+        __m128i py = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.pos_y + i));
+        __m128i vx = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.vel_x + i));
+        __m128i vy = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.vel_y + i));
+        __m128i lt = _mm_loadu_si128(reinterpret_cast<__m128i const*>(c.lifetime_ticks + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.pos_x + i), _mm_add_epi32(px, vx));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.pos_y + i), _mm_add_epi32(py, vy));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(c.lifetime_ticks + i),
+                         _mm_add_epi32(lt, _mm_cmpgt_epi32(lt, zero)));
+    }
+    integrateProjectilesScalarFrom(c, i);
+}
+
+const char* integratorIsaName() { return "sse2"; }
+
+#elif defined(MOBA_TICK_NEON)
+
+static inline int32x4_t approachZero4(int32x4_t v, int32x4_t a, int32x4_t neg_a) {
+    return vsubq_s32(v, vminq_s32(vmaxq_s32(v, neg_a), a));
+}
+
+void integrateCharacters(MotionColumns c, int32_t friction) {
+    const int32x4_t a = vdupq_n_s32(friction);
+    const int32x4_t neg_a = vdupq_n_s32(-friction);
+    const int32x4_t zero = vdupq_n_s32(0);
+    uint32_t i = 0;
+    for (; i + 4 <= c.count; i += 4) {
+        int32x4_t vx = vld1q_s32(c.vel_x + i);
+        int32x4_t vy = vld1q_s32(c.vel_y + i);
+        int32x4_t lt = vld1q_s32(c.lifetime_ticks + i);
+
+        vst1q_s32(c.pos_x + i, vaddq_s32(vld1q_s32(c.pos_x + i), vx));
+        vst1q_s32(c.pos_y + i, vaddq_s32(vld1q_s32(c.pos_y + i), vy));
+        vst1q_s32(c.vel_x + i, approachZero4(vx, a, neg_a));
+        vst1q_s32(c.vel_y + i, approachZero4(vy, a, neg_a));
+        vst1q_s32(c.lifetime_ticks + i, vaddq_s32(lt, vreinterpretq_s32_u32(vcgtq_s32(lt, zero))));
+    }
+    integrateCharactersScalarFrom(c, friction, i);
+}
+
+void integrateProjectiles(MotionColumns c) {
+    const int32x4_t zero = vdupq_n_s32(0);
+    uint32_t i = 0;
+    for (; i + 4 <= c.count; i += 4) {
+        int32x4_t lt = vld1q_s32(c.lifetime_ticks + i);
+
+        vst1q_s32(c.pos_x + i, vaddq_s32(vld1q_s32(c.pos_x + i), vld1q_s32(c.vel_x + i)));
+        vst1q_s32(c.pos_y + i, vaddq_s32(vld1q_s32(c.pos_y + i), vld1q_s32(c.vel_y + i)));
+        vst1q_s32(c.lifetime_ticks + i, vaddq_s32(lt, vreinterpretq_s32_u32(vcgtq_s32(lt, zero))));
+    }
+    integrateProjectilesScalarFrom(c, i);
+}
+
+const char* integratorIsaName() { return "neon"; }
+
+#else
+
+void integrateCharacters(MotionColumns c, int32_t friction) {
+    integrateCharactersScalarFrom(c, friction, 0);
+}
+
+void integrateProjectiles(MotionColumns c) {
+    integrateProjectilesScalarFrom(c, 0);
+}
+
+const char* integratorIsaName() { return "scalar"; }
+
+#endif
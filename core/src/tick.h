@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "entity.h"
+
+// ---------- Batched movement / lifetime integration ----------
+// Kernels run over a whole type partition of the EntityStore columns instead of one entity at a time.
+// All math is plain int32 (add, compare, select), so the SSE2/AVX2/NEON paths are bit-identical
+// to the scalar reference. Define MOBA_SCALAR_TICK to force the scalar path (e.g. to verify).
+
+inline int32_t approach_zero(int32_t current_val, int32_t amount) {
+    if (current_val > amount) return current_val - amount;
+    if (current_val < -amount) return current_val + amount;
+    return 0;
+}
+
+// Contiguous column view over [begin, end) of an EntityStore
+struct MotionColumns {
+    int32_t* pos_x;
+    int32_t* pos_y;
+    int32_t* vel_x;
+    int32_t* vel_y;
+    int32_t* lifetime_ticks;
+    uint32_t count;
+};
+
+inline MotionColumns motionColumns(EntityStore& s, uint32_t begin, uint32_t end) {
+    return MotionColumns{
+        s.pos_x.data() + begin,
+        s.pos_y.data() + begin,
+        s.vel_x.data() + begin,
+        s.vel_y.data() + begin,
+        s.lifetime_ticks.data() + begin,
+        end - begin
+    };
+}
+
+// pos += vel, vel = approach_zero(vel, friction), lifetime-- when > 0
+void integrateCharacters(MotionColumns c, int32_t friction);
+// pos += vel, lifetime-- when > 0
+void integrateProjectiles(MotionColumns c);
+
+// Scalar reference versions (also the tail loop of the vector kernels)
+void integrateCharactersScalar(MotionColumns c, int32_t friction);
+void integrateProjectilesScalar(MotionColumns c);
+
+// Name of the vector ISA compiled in ("avx2", "sse2", "neon" or "scalar")
+const char* integratorIsaName();
@@ -0,0 +1,238 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <iomanip>
+#include <ostream>
+
+// ---------- Tick-phase profiler ----------
+// Times each phase of DemoServer::tick() (plus snapshot serialization, Lua calls and GC) against the
+// TICK_NS budget. Everything stays in fixed arrays: per-phase log-linear histograms for p50/p99,
+// exact max, an overrun counter and a ring of the last PROFILER_RING_TICKS raw samples that
+// tools can copy out (all on the tick thread).
+//
+// Build with MOBA_TICK_PROFILER=0 (CMake option MOBA_TICK_PROFILER=OFF) and the MOBA_PROFILE_*
+// macros expand to nothing: no clock reads, no stores.
+#ifndef MOBA_TICK_PROFILER
+#define MOBA_TICK_PROFILER 0
+#endif
+
+enum class TickPhase : uint8_t {
+    Grid,       // spatial grid clear/insert/build
+    Input,      // inbound drain + per-client input apply
+    Simulate,   // per-type integration kernels
+    Collision,  // projectile queries + destroys
+    Buffs,      // due buff timers (processBuffs)
+    Events,     // processEvents + buff hooks (includes Lua)
+    Snapshot,   // state hash + ring capture
+    Interest,   // per-team visible sets (interest.h)
+    Serialize,  // per-client delta encode (buildClientSnapshots)
+    LuaGc,      // Lua collector step in the slack after the tick (runIdleWork)
+    Count
+};
+constexpr uint32_t TICK_PHASE_COUNT = static_cast<uint32_t>(TickPhase::Count);
+
+inline const char* tickPhaseName(TickPhase p) {
+    switch (p) {
+        case TickPhase::Grid: return "grid";
+        case TickPhase::Input: return "input";
+        case TickPhase::Simulate: return "simulate";
+        case TickPhase::Collision: return "collision";
+        case TickPhase::Buffs: return "buffs";
+        case TickPhase::Events: return "events";
+        case TickPhase::Snapshot: return "snapshot";
+        case TickPhase::Interest: return "interest";
+        case TickPhase::Serialize: return "serialize";
+        case TickPhase::LuaGc: return "lua_gc";
+        default: return "?";
+    }
+}
+
+constexpr uint32_t PROFILER_RING_TICKS = 256; // ~8.5 s at 30 t/s
+
+struct TickSample {
+    uint32_t tick = 0;
+    uint32_t phase_ns[TICK_PHASE_COUNT] = {};
+    uint32_t lua_ns = 0;   // subset of Events spent inside Lua
+    uint32_t total_ns = 0; // beginTick() to the end of the last phase
+    bool overrun = false;  // total_ns > budget
+};
+
+// Log-linear histogram over nanoseconds: 4 sub-buckets per power of two (<= 19% error),
+// 128 buckets cover the whole uint32 range.
+class NsHistogram {
+public:
+    void add(uint32_t ns) {
+        ++buckets[bucketOf(ns)];
+        ++count;
+        if (ns > max_ns) max_ns = ns;
+    }
+
+    // upper bound of the bucket holding the q-quantile (q in [0, 1])
+    uint32_t quantile(double q) const {
+        if (count == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count - 1)) + 1;
+        uint64_t seen = 0;
+        for (uint32_t b = 0; b < BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                uint32_t hi = bucketUpper(b);
+                return hi < max_ns ? hi : max_ns;
+            }
+        }
+        return max_ns;
+    }
+
+    uint32_t max() const { return max_ns; }
+    uint64_t samples() const { return count; }
+
+private:
+    static constexpr uint32_t BUCKETS = 128;
+
+    static uint32_t bucketOf(uint32_t ns) {
+        if (ns < 4) return ns;
+        uint32_t msb = 31;
+        while (!(ns >> msb)) --msb;
+        return msb * 4 + ((ns >> (msb - 2)) & 3u);
+    }
+    static uint32_t bucketUpper(uint32_t b) {
+        if (b < 8) return b; // 0..3 exact, 4..7 unused
+        uint32_t msb = b / 4, sub = b % 4;
+        uint64_t hi = (static_cast<uint64_t>(4 + sub + 1) << (msb - 2)) - 1;
+        return hi > 0xFFFFFFFFull ? 0xFFFFFFFFu : static_cast<uint32_t>(hi);
+    }
+
+    uint32_t buckets[BUCKETS] = {};
+    uint64_t count = 0;
+    uint32_t max_ns = 0;
+};
+
+class TickProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TickProfiler(uint64_t budget_ns = 0) : budget(budget_ns) {}
+
+    void setBudget(uint64_t budget_ns) { budget = budget_ns; }
+
+    // Opens the sample for `tick`. The previous sample is closed here, so work that happens
+    // between two ticks (snapshot serialization) is still charged to the tick it belongs to.
+    void beginTick(uint32_t tick) {
+        close();
+        current = TickSample{};
+        current.tick = tick;
+        tick_start = Clock::now();
+        last_end = tick_start;
+        open = true;
+    }
+
+    void addPhase(TickPhase p, Clock::time_point start, Clock::time_point end) {
+        if (!open) return;
+        current.phase_ns[static_cast<uint32_t>(p)] += toNs(end - start);
+        if (end > last_end) last_end = end;
+    }
+
+    void addLua(Clock::time_point start, Clock::time_point end) {
+        if (open) current.lua_ns += toNs(end - start);
+    }
+
+    // Close the open sample now (end of run, before a dump)
+    void flush() { close(); }
+
+    uint64_t ticks() const { return total_ticks; }
+    uint64_t overruns() const { return overrun_ticks; }
+    NsHistogram const& phase(TickPhase p) const { return phase_hist[static_cast<uint32_t>(p)]; }
+    NsHistogram const& lua() const { return lua_hist; }
+    NsHistogram const& total() const { return total_hist; }
+
+    // Copy up to `max` most recent samples, oldest first. Returns how many were written.
+    size_t copyRecent(TickSample* out, size_t max) const {
+        size_t n = total_ticks < PROFILER_RING_TICKS ? static_cast<size_t>(total_ticks) : PROFILER_RING_TICKS;
+        if (n > max) n = max;
+        for (size_t k = 0; k < n; ++k) out[k] = ring[(total_ticks - n + k) % PROFILER_RING_TICKS];
+        return n;
+    }
+
+    void dump(std::ostream& os) const {
+        os << "[Profiler] " << total_ticks << " ticks, " << overrun_ticks << " over the "
+           << budget / 1000 << " us budget\n";
+        os << "[Profiler] phase       p50(us)   p99(us)   max(us)\n";
+        for (uint32_t p = 0; p < TICK_PHASE_COUNT; ++p) row(os, tickPhaseName(static_cast<TickPhase>(p)), phase_hist[p]);
+        row(os, "lua", lua_hist);
+        row(os, "total", total_hist);
+    }
+
+private:
+    static uint32_t toNs(Clock::duration d) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        return ns <= 0 ? 0u : (ns > 0xFFFFFFFFll ? 0xFFFFFFFFu : static_cast<uint32_t>(ns));
+    }
+
+    static void row(std::ostream& os, const char* name, NsHistogram const& h) {
+        auto us = [](uint32_t ns) { return static_cast<double>(ns) / 1000.0; };
+        os << "[Profiler]   " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+           << std::setw(8) << us(h.quantile(0.50)) << std::setw(10) << us(h.quantile(0.99))
+           << std::setw(10) << us(h.max()) << std::defaultfloat << "\n";
+    }
+
+    void close() {
+        if (!open) return;
+        open = false;
+        current.total_ns = toNs(last_end - tick_start);
+        current.overrun = budget != 0 && current.total_ns > budget;
+
+        for (uint32_t p = 0; p < TICK_PHASE_COUNT; ++p) phase_hist[p].add(current.phase_ns[p]);
+        lua_hist.add(current.lua_ns);
+        total_hist.add(current.total_ns);
+        if (current.overrun) ++overrun_ticks;
+
+        ring[total_ticks % PROFILER_RING_TICKS] = current;
+        ++total_ticks;
+    }
+
+    uint64_t budget;
+    bool open = false;
+    TickSample current;
+    Clock::time_point tick_start;
+    Clock::time_point last_end;
+
+    NsHistogram phase_hist[TICK_PHASE_COUNT];
+    NsHistogram lua_hist;
+    NsHistogram total_hist;
+    uint64_t total_ticks = 0;
+    uint64_t overrun_ticks = 0;
+    TickSample ring[PROFILER_RING_TICKS];
+};
+
+// RAII timers used by the MOBA_PROFILE_* macros
+class TickPhaseScope {
+public:
+    TickPhaseScope(TickProfiler& p, TickPhase ph) : prof(p), phase(ph), start(TickProfiler::Clock::now()) {}
+    ~TickPhaseScope() { prof.addPhase(phase, start, TickProfiler::Clock::now()); }
+private:
+    TickProfiler& prof;
+    TickPhase phase;
+    TickProfiler::Clock::time_point start;
+};
+
+class LuaTimeScope {
+public:
+    explicit LuaTimeScope(TickProfiler& p) : prof(p), start(TickProfiler::Clock::now()) {}
+    ~LuaTimeScope() { prof.addLua(start, TickProfiler::Clock::now()); }
+private:
+    TickProfiler& prof;
+    TickProfiler::Clock::time_point start;
+};
+
+#define MOBA_PROFILE_CONCAT_(a, b) a##b
+#define MOBA_PROFILE_CONCAT(a, b) MOBA_PROFILE_CONCAT_(a, b)
+
+#if MOBA_TICK_PROFILER
+#define MOBA_PROFILE_BEGIN_TICK(prof, tick) (prof).beginTick(tick)
+#define MOBA_PROFILE_PHASE(prof, phase) TickPhaseScope MOBA_PROFILE_CONCAT(tick_phase_scope_, __LINE__)(prof, phase)
+#define MOBA_PROFILE_LUA(prof) LuaTimeScope MOBA_PROFILE_CONCAT(lua_time_scope_, __LINE__)(prof)
+#else
+#define MOBA_PROFILE_BEGIN_TICK(prof, tick) ((void)0)
+#define MOBA_PROFILE_PHASE(prof, phase) ((void)0)
+#define MOBA_PROFILE_LUA(prof) ((void)0)
+#endif
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ---------- Hierarchical timer wheel ----------
+// Timers keyed by the absolute tick they are due on. Level 0 has one slot per tick for the
+// next 256 ticks, levels 1 and 2 have 64 slots of 256 and 16384 ticks; a slot of an upper
+// level is cascaded (its timers re-placed one level down) when the tick counter reaches its
+// span. Scheduling is O(1), and a tick only touches the slot due now plus, every 256 ticks,
+// one upper slot: the cost follows the timers that actually fire, not how many are pending.
+// Timers past the last level's ~9.7 h (at 30 t/s) park in it and are re-placed until due.
+//
+// Nothing is ever cancelled: the owner checks a fired payload against its own state and
+// drops the stale ones. Slots keep their capacity, so a warm wheel doesn't allocate.
+template <class T>
+class TimerWheel {
+public:
+    static constexpr uint32_t L0_BITS = 8;
+    static constexpr uint32_t LN_BITS = 6;
+    static constexpr uint32_t L0_SLOTS = 1u << L0_BITS;
+    static constexpr uint32_t LN_SLOTS = 1u << LN_BITS;
+    static constexpr uint32_t L1_SPAN = 1u << (L0_BITS + LN_BITS); // ticks a level-1 lap covers
+    static constexpr uint32_t HORIZON = 1u << (L0_BITS + 2 * LN_BITS);
+
+    explicit TimerWheel(uint32_t now = 0) { reset(now); }
+
+    // Drop every timer; the next advance() runs tick `now`
+    void reset(uint32_t now) {
+        for (auto& s : level0) s.clear();
+        for (auto& s : level1) s.clear();
+        for (auto& s : level2) s.clear();
+        current = now;
+        pending = 0;
+    }
+
+    // The tick the next advance() runs
+    uint32_t now() const { return current; }
+    size_t size() const { return pending; }
+
+    // A timer due before now() fires on the next advance()
+    void schedule(uint32_t due, T const& payload) {
+        place(Timer{ due < current ? current : due, payload });
+        ++pending;
+    }
+
+    // Append the payloads due on now() to `out` (scheduling order within a slot) and step to
+    // the next tick. Must run once for every tick, in order.
+    void advance(std::vector<T>& out) {
+        uint32_t t = current;
+        if ((t & (L0_SLOTS - 1)) == 0) {
+            if ((t & (L1_SPAN - 1)) == 0) cascade(level2[(t >> (L0_BITS + LN_BITS)) & (LN_SLOTS - 1)]);
+            cascade(level1[(t >> L0_BITS) & (LN_SLOTS - 1)]);
+        }
+        scratch.swap(level0[t & (L0_SLOTS - 1)]);
+        for (Timer const& timer : scratch) {
+            if (timer.due == t) {
+                out.push_back(timer.payload);
+                --pending;
+            } else {
+                place(timer); // not due this lap (only if ticks were skipped): keep it
+            }
+        }
+        scratch.clear();
+        current = t + 1;
+    }
+
+private:
+    struct Timer {
+        uint32_t due;
+        T payload;
+    };
+
+    void place(Timer const& timer) {
+        uint32_t delta = timer.due - current;
+        if (delta < L0_SLOTS) level0[timer.due & (L0_SLOTS - 1)].push_back(timer);
+        else if (delta < L1_SPAN) level1[(timer.due >> L0_BITS) & (LN_SLOTS - 1)].push_back(timer);
+        else if (delta < HORIZON) level2[(timer.due >> (L0_BITS + LN_BITS)) & (LN_SLOTS - 1)].push_back(timer);
+        else level2[((current >> (L0_BITS + LN_BITS)) + LN_SLOTS - 1) & (LN_SLOTS - 1)].push_back(timer); // the last slot of this lap
+    }
+
+    // re-place a slot's timers relative to now (they land on lower levels or, early, back here)
+    void cascade(std::vector<Timer>& slot) {
+        if (slot.empty()) return;
+        moving.swap(slot);
+        for (Timer const& timer : moving) place(timer);
+        moving.clear();
+    }
+
+    std::vector<Timer> level0[L0_SLOTS];
+    std::vector<Timer> level1[LN_SLOTS];
+    std::vector<Timer> level2[LN_SLOTS];
+    std::vector<Timer> scratch;
+    std::vector<Timer> moving;
+    uint32_t current = 0;
+    size_t pending = 0;
+};
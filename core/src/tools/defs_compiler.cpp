@@ -0,0 +1,56 @@
+// moba_defs_compiler <game_defs.json> <game_defs.bin>
+// Build step: compiles the authoring JSON into the blob the server maps at start (game_defs.h).
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "game_defs.h"
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <game_defs.json> <game_defs.bin>\n";
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        std::cerr << "[defs] cannot open " << argv[1] << "\n";
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<uint8_t> blob;
+    std::string error;
+    if (!CompileGameDefs(text, DefsUnits{POS_SCALE, SERVER_TICK_RATE}, blob, error)) {
+        std::cerr << "[defs] " << argv[1] << ": " << error << "\n";
+        return 1;
+    }
+
+    // write next to the target and rename, so a running server never maps a half-written file
+    std::string tmp = std::string(argv[2]) + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+        if (!out) {
+            std::cerr << "[defs] cannot write " << tmp << "\n";
+            return 1;
+        }
+    }
+    std::remove(argv[2]);
+    if (std::rename(tmp.c_str(), argv[2]) != 0) {
+        std::cerr << "[defs] cannot rename " << tmp << " to " << argv[2] << "\n";
+        return 1;
+    }
+
+    GameDefs check;
+    if (!check.mapFile(argv[2], error)) {
+        std::cerr << "[defs] " << error << "\n";
+        return 1;
+    }
+    std::cout << "[defs] " << argv[2] << ": " << check.abilityCount() << " abilities, " << check.characterCount()
+              << " characters, " << check.buffCount() << " buffs, " << blob.size() << " bytes\n";
+    return 0;
+}
@@ -1,5 +1,8 @@
+-- resolved once at load; cast/on_hit only index by id
+local FIREBALL = FindAbility("fireball_test")
+
 function cast(caster_id, target_x, target_y)
-    print(string.format("[Lua] %d casts Fireball at (%.2f, %.2f)", caster_id, target_x, target_y))
+    print(string.format("%d casts Fireball at (%.2f, %.2f)", caster_id, target_x, target_y))
 
     local sx, sy = GetPosition(caster_id)
     if not sx then -- works for both sx and sy
@@ -14,10 +17,9 @@ function cast(caster_id, target_x, target_y)
     if len == 0 then dx, dy = 1, 0; len = 1 end
     dx, dy = dx/len, dy/len
 
-    local getDmg = Engine_GetAbilityStat("fireball_test", "damage")
-    local getSpeed = Engine_GetAbilityStat("fireball_test", "speed")
-    local getRadius = Engine_GetAbilityStat("fireball_test", "radius")
-    local getLifetime = Engine_GetAbilityStat("fireball_test", "lifetime")
+    local getSpeed = GetAbilityStat(FIREBALL, AbilityStat.speed)
+    local getRadius = GetAbilityStat(FIREBALL, AbilityStat.radius)
+    local getLifetime = GetAbilityStat(FIREBALL, AbilityStat.lifetime)
 
     local proj_id, err = SpawnProjectile({
         caster = caster_id, -- req
@@ -30,19 +32,20 @@ function cast(caster_id, target_x, target_y)
     })
 
     if not proj_id then
-        print("[Lua] Failed to spawn projectile:", err)
-        return { ok = false, err = err }
+        print("Failed to spawn projectile:", err)
+        return false, err
     end
 
-    return { ok = true, projectile = proj_id }
+    -- plain return values: no result table allocated per cast
+    return true, proj_id
 end
 
-function OnProjectileHit_Fireball(projectile_id, target_id)
-    local caster = GetProjectileCaster and GetProjectileCaster(projectile_id) or nil
-    if caster == nil then
-        -- best-effort: fallback to 0
-        caster = 0
-    end
-    print(string.format("[Lua] projectile %d hit entity %d -- applying damage %d", projectile_id, target_id, FIREBALL_DAMAGE))
-    ApplyDamage(caster, target_id, FIREBALL_DAMAGE, "magical")
-end
\ No newline at end of file
+-- the projectile is gone by now: the engine passes who cast it
+function OnProjectileHit_Fireball(projectile_id, target_id, caster_id)
+    local damage = math.floor(GetAbilityStat(FIREBALL, AbilityStat.damage) or 0)
+    print(string.format("projectile %d hit entity %d -- applying damage %d", projectile_id, target_id, damage))
+    ApplyDamage(caster_id, target_id, damage, "magical")
+end
+
+-- entry point the engine pins at load time (LuaBridge::loadAbility)
+on_hit = OnProjectileHit_Fireball
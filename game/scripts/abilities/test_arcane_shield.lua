@@ -0,0 +1,24 @@
+-- resolved once at load; cast and the hooks only index by id
+local SHIELD = FindBuff("arcane_shield")
+
+function cast(caster_id, target_x, target_y)
+    if not SHIELD then
+        return false, "arcane_shield buff is not defined"
+    end
+    print(string.format("%d casts Arcane Shield", caster_id))
+    return ApplyBuff(caster_id, caster_id, SHIELD)
+end
+
+-- buff hooks run once per tick with every entity the buff started/ended on (1-based arrays,
+-- entries after n are leftovers from earlier batches)
+function on_apply(n, targets, sources, buffs)
+    for i = 1, n do
+        print(string.format("Arcane Shield up on %d", targets[i]))
+    end
+end
+
+function on_expire(n, targets, sources, buffs)
+    for i = 1, n do
+        print(string.format("Arcane Shield faded from %d", targets[i]))
+    end
+end
@@ -0,0 +1,23 @@
+-- Stone Skin roots the caster in place while it lasts (the Root status comes from the buff def)
+local STONE_SKIN = FindBuff("stone_skin")
+
+function cast(caster_id, target_x, target_y)
+    if not STONE_SKIN then
+        return false, "stone_skin buff is not defined"
+    end
+    print(string.format("%d casts Stone Skin", caster_id))
+    SetMovement(caster_id, 0.0, 0.0)
+    return ApplyBuff(caster_id, caster_id, STONE_SKIN)
+end
+
+function on_apply(n, targets, sources, buffs)
+    for i = 1, n do
+        print(string.format("%d turns to stone", targets[i]))
+    end
+end
+
+function on_expire(n, targets, sources, buffs)
+    for i = 1, n do
+        print(string.format("%d is flesh again", targets[i]))
+    end
+end
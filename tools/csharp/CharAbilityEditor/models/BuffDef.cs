@@ -0,0 +1,19 @@
+using System.Text.Json.Serialization;
+namespace CharAbilityEditor;
+
+public class BuffDef
+{
+    [JsonPropertyName("duration")] // seconds, omitted = until removed
+    [JsonIgnore(Condition = JsonIgnoreCondition.WhenWritingNull)]
+    public float? Duration { get; set; }
+    [JsonPropertyName("period")]
+    public float Period { get; set; }
+    [JsonPropertyName("tickDamage")]
+    public int TickDamage { get; set; }
+    [JsonPropertyName("damageType")]
+    public string DamageType { get; set; } = "";
+    [JsonPropertyName("status")]
+    public List<string> Status { get; set; } = new();
+    [JsonPropertyName("script")]
+    public string ScriptName { get; set; } = "";
+}
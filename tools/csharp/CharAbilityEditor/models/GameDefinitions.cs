@@ -4,4 +4,5 @@ public class GameDefinitions
 {
     public Dictionary<string, CharDef> Characters { get; set; } = new();
     public Dictionary<string, AbilityDef> Abilities { get; set; } = new();
+    public Dictionary<string, BuffDef> Buffs { get; set; } = new();
 }
\ No newline at end of file
@@ -1,5 +1,5 @@
 function OnCast(caster, targetPos)
-    print("[Lua] Blink cast!")
+    print("Blink cast!")
 
     TeleportUnit(caster, targetPos)
     PlayFX("fx/blink_cast", caster.position)
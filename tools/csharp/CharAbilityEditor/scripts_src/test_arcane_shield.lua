@@ -1,5 +1,5 @@
 function OnCast(caster)
-    print("[Lua] Arcane Shield activated")
+    print("Arcane Shield activated")
     ApplyBuff(caster, "ArcaneShield", {duration = 5, shield = 120})
     return true
 end
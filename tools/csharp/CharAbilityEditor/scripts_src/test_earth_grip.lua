@@ -1,5 +1,5 @@
 function OnCast(caster, targetPos)
     RootUnitsInRadius(targetPos, 2.5, 2.0)
-    print("[Lua] Earth Grip used")
+    print("Earth Grip used")
     return true
 end
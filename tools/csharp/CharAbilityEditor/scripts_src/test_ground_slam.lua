@@ -1,5 +1,5 @@
 function OnCast(caster)
-    print("[Lua] Ground Slam!")
+    print("Ground Slam!")
 
     DealAOEDamage(caster.position, 3.0, 100)
     PlayFX("fx/ground_slam", caster.position)
@@ -1,6 +1,6 @@
 function OnCast(caster, targetPos)
     TeleportUnit(caster, targetPos)
     ApplyBuff(caster, "ShadowVeil", {duration = 3})
-    print("[Lua] Shadow Step")
+    print("Shadow Step")
     return true
 end
@@ -7,6 +7,6 @@ function OnCast(caster, targetPos)
         target = targetPos,
         fx = "fx/spark_bolt"
     }
-    print("[Lua] Spark Bolt fired")
+    print("Spark Bolt fired")
     return true
 end
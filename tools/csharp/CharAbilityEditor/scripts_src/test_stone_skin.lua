@@ -1,5 +1,5 @@
 function OnCast(caster)
     ApplyBuff(caster, "StoneSkin", {duration = 10, armor = 40})
-    print("[Lua] Stone Skin applied")
+    print("Stone Skin applied")
     return true
 end
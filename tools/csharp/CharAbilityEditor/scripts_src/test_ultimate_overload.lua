@@ -1,5 +1,5 @@
 function OnCast(caster)
-    print("[Lua] OVERLOAD!")
+    print("OVERLOAD!")
 
     ApplyBuff(caster, "OverloadBuff", {duration = 8, power = 2.0})
 
@@ -0,0 +1,108 @@
+using System;
+using System.Runtime.InteropServices;
+
+namespace SimPreview
+{
+    // The server's own simulation through moba_sim (core/include/engine_api.h). Columns are
+    // spans over the library's state region: nothing is copied until a caller copies it.
+    // Fixed-point like the server: divide positions by PosScale for world units.
+    public sealed unsafe class NativeSim : IDisposable
+    {
+        const string Lib = "moba_sim";
+        public const uint ApiVersion = 1;
+        public const uint Now = 0xFFFFFFFF;
+
+        [StructLayout(LayoutKind.Sequential)]
+        struct Config
+        {
+            public uint ApiVersion;
+            public uint MaxEntities;
+            public IntPtr GameDir;
+            public IntPtr ShmName;
+            public uint Quiet;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct Input
+        {
+            public uint ClientId;
+            public uint TargetTick;
+            public sbyte MoveDx;
+            public sbyte MoveDy;
+            public byte ActionFlags;
+            public byte Reserved;
+            public ushort AbilityId;
+            public ushort Reserved2;
+            public int TargetX;
+            public int TargetY;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        struct StateHeader
+        {
+            public uint Magic, Version, HeaderBytes, TotalBytes, Sequence, Tick;
+            public ulong StateHash;
+            public uint Capacity, Count, Dropped, PosScale, TickRate;
+            public uint IdOffset, TypeOffset, TeamOffset, PosXOffset, PosYOffset, VelXOffset, VelYOffset;
+            public uint RadiusOffset, LifetimeOffset, HealthOffset, StatusOffset;
+            public fixed uint Reserved[8];
+        }
+
+        [DllImport(Lib)] static extern IntPtr sim_create(ref Config config);
+        [DllImport(Lib)] static extern void sim_destroy(IntPtr sim);
+        [DllImport(Lib)] static extern uint sim_spawn_character(IntPtr sim, int x, int y, byte team);
+        [DllImport(Lib)] static extern int sim_push_input(IntPtr sim, ref Input input);
+        [DllImport(Lib)] static extern uint sim_step(IntPtr sim, uint ticks);
+        [DllImport(Lib)] static extern StateHeader* sim_read_state(IntPtr sim);
+
+        IntPtr sim;
+        readonly StateHeader* state;
+
+        // gameDir ends in '/' (game_defs, map_defs.json, scripts/)
+        public NativeSim(string gameDir, uint maxEntities = 0)
+        {
+            IntPtr dir = Marshal.StringToHGlobalAnsi(gameDir);
+            try
+            {
+                var config = new Config { ApiVersion = ApiVersion, MaxEntities = maxEntities, GameDir = dir, Quiet = 1 };
+                sim = sim_create(ref config);
+            }
+            finally
+            {
+                Marshal.FreeHGlobal(dir);
+            }
+            if (sim == IntPtr.Zero) throw new InvalidOperationException("sim_create failed (see the engine log)");
+            state = sim_read_state(sim);
+        }
+
+        public uint Tick => state->Tick;
+        public ulong StateHash => state->StateHash;
+        public int Count => (int)state->Count;
+        public int PosScale => (int)state->PosScale;
+
+        public uint SpawnCharacter(int x, int y, byte team = 0) => sim_spawn_character(sim, x, y, team);
+        public bool PushInput(Input input) => sim_push_input(sim, ref input) == 0;
+        public uint Step(uint ticks) => sim_step(sim, ticks);
+
+        ReadOnlySpan<T> Column<T>(uint offset) where T : unmanaged => new((byte*)state + offset, Count);
+
+        public ReadOnlySpan<uint> Id => Column<uint>(state->IdOffset);
+        public ReadOnlySpan<byte> Type => Column<byte>(state->TypeOffset);
+        public ReadOnlySpan<byte> Team => Column<byte>(state->TeamOffset);
+        public ReadOnlySpan<int> PosX => Column<int>(state->PosXOffset);
+        public ReadOnlySpan<int> PosY => Column<int>(state->PosYOffset);
+        public ReadOnlySpan<int> VelX => Column<int>(state->VelXOffset);
+        public ReadOnlySpan<int> VelY => Column<int>(state->VelYOffset);
+        public ReadOnlySpan<int> Radius => Column<int>(state->RadiusOffset);
+        public ReadOnlySpan<int> Lifetime => Column<int>(state->LifetimeOffset);
+        public ReadOnlySpan<int> Health => Column<int>(state->HealthOffset);
+        public ReadOnlySpan<ushort> Status => Column<ushort>(state->StatusOffset);
+
+        public void Dispose()
+        {
+            if (sim == IntPtr.Zero) return;
+            sim_destroy(sim);
+            sim = IntPtr.Zero;
+        }
+    }
+}